@@ -0,0 +1,218 @@
+/**
+ * @file bench_async.cpp
+ * @brief Hundreds of BluetoothManager operations in flight from one thread
+ *
+ * Issues connect/trust/disconnect/pair calls for every device, plus a few
+ * scans, first one by one through the blocking API and then all at once
+ * through the *Async() API, with every completion delivered to the main
+ * thread's EventLoop. Checks that each operation completes exactly once,
+ * on the loop thread; that cancelled ones end cleanly; and that destroying
+ * the manager with operations still queued completes all of them. Runs
+ * offline against the fake:
+ *   ./bench/bench_async [operations] [fake-bluetoothctl path]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/BluetoothManager.h"
+#include "include/EventLoop.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double millisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+constexpr int KINDS = 4;
+
+bool runSync(BluetoothManager &manager, int kind, const std::string &mac) {
+  switch (kind) {
+  case 0:
+    return manager.connectDevice(mac);
+  case 1:
+    return manager.trustDevice(mac);
+  case 2:
+    return manager.disconnectDevice(mac);
+  default:
+    return manager.pairDevice(mac);
+  }
+}
+
+Operation<bool> runAsync(BluetoothManager &manager, int kind,
+                         const std::string &mac) {
+  switch (kind) {
+  case 0:
+    return manager.connectAsync(mac);
+  case 1:
+    return manager.trustAsync(mac);
+  case 2:
+    return manager.disconnectAsync(mac);
+  default:
+    return manager.pairAsync(mac);
+  }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int operations = argc > 1 ? std::stoi(argv[1]) : 600;
+  const char *fake = argc > 2 ? argv[2] : "bench/fake-bluetoothctl.sh";
+  setenv("TOOTHDROID_BLUETOOTHCTL", fake, 1);
+  setenv("TOOTHDROID_BACKEND", "bluetoothctl", 1);
+  setenv("TOOTHDROID_STORE", "", 1);
+  setenv("FAKE_BT_DEVICES", "50", 0);
+  setenv("FAKE_BT_DELAY", "0.001", 0);
+
+  int failures = 0;
+  auto check = [&failures](bool ok, const char *what) {
+    if (!ok) {
+      std::fprintf(stderr, "FAILED: %s\n", what);
+      failures++;
+    }
+  };
+
+  std::vector<std::string> macs;
+  {
+    BluetoothManager manager;
+    manager.setVerbose(false);
+    std::cout.setstate(std::ios::failbit); // Mute per-operation UI lines
+    for (const auto &d : manager.scanDevices(1))
+      macs.push_back(d.macAddress.toString());
+    std::cout.clear();
+  }
+  if (macs.empty()) {
+    std::fprintf(stderr, "no devices found; is %s runnable?\n", fake);
+    return 1;
+  }
+  std::printf("%d operations over %zu devices, delay %s s per command\n",
+              operations, macs.size(), std::getenv("FAKE_BT_DELAY"));
+
+  // Baseline: the blocking API, one call at a time
+  {
+    BluetoothManager manager;
+    manager.setVerbose(false);
+    std::cout.setstate(std::ios::failbit);
+    auto start = Clock::now();
+    int ok = 0;
+    for (int i = 0; i < operations; i++)
+      ok += runSync(manager, i % KINDS, macs[i % macs.size()]);
+    double ms = millisSince(start);
+    std::cout.clear();
+    std::printf("  %-28s %9.2f ms  %4d ok  1 in flight\n", "blocking, serial",
+                ms, ok);
+  }
+
+  // All at once; completions come back on this thread's loop
+  {
+    BluetoothManager manager;
+    manager.setVerbose(false);
+    std::cout.setstate(std::ios::failbit);
+
+    EventLoop loop;
+    auto loopThread = std::this_thread::get_id();
+    std::vector<int> completions(operations + 3, 0);
+    int completed = 0, succeeded = 0, cancelled = 0, offLoop = 0;
+    int opsLeft = operations;
+    double opsMs = 0;
+
+    auto start = Clock::now();
+    std::vector<Operation<bool>> pending;
+    pending.reserve(operations);
+    for (int i = 0; i < operations; i++) {
+      auto op = runAsync(manager, i % KINDS, macs[i % macs.size()]);
+      // Every tenth caller changes its mind straight away
+      if (i % 10 == 9)
+        op.cancel();
+      op.then(loop, [&, i](const Operation<bool> &done) {
+        completions[i]++;
+        completed++;
+        offLoop += std::this_thread::get_id() != loopThread;
+        if (--opsLeft == 0)
+          opsMs = millisSince(start);
+        try {
+          succeeded += done.get();
+        } catch (const OperationCancelled &) {
+          cancelled++;
+        }
+      });
+      pending.push_back(op);
+    }
+    for (int i = 0; i < 3; i++) {
+      manager.scanAsync(1).then(
+          loop, [&, i](const Operation<std::vector<BluetoothDevice>> &done) {
+            completions[operations + i]++;
+            completed++;
+            succeeded += !done.get().empty();
+          });
+    }
+    double issued = millisSince(start);
+    bool drained = loop.runUntil(
+        [&] { return completed == operations + 3; }, std::chrono::seconds(60));
+    double ms = millisSince(start);
+    std::cout.clear();
+
+    auto stats = manager.getAsyncStats();
+    std::printf("  %-28s %9.2f ms  %4d ok  %zu in flight (issued in %.2f "
+                "ms)\n",
+                "async, one event loop", opsMs, succeeded, stats.maxQueued,
+                issued);
+    std::printf("  %-28s %9.2f ms  with the 3 scans\n", "", ms);
+    std::printf("  %-28s %d cancelled, %zu tasks run by the executor\n", "",
+                cancelled, stats.completed);
+
+    check(drained, "every operation completed");
+    bool once = true;
+    for (int c : completions)
+      once &= c == 1;
+    check(once, "each operation completed exactly once");
+    check(offLoop == 0, "completions ran on the loop thread");
+    check(succeeded + cancelled == operations + 3,
+          "operations either succeeded or were cancelled");
+    for (int i = 0; i < operations; i++) {
+      if (i % 10 != 9 && !pending[i].get()) {
+        check(false, "uncancelled operations succeeded");
+        break;
+      }
+    }
+  }
+
+  // Tear down with work still queued: nothing may be left hanging
+  {
+    std::vector<Operation<bool>> pending;
+    {
+      BluetoothManager manager;
+      manager.setVerbose(false);
+      std::cout.setstate(std::ios::failbit);
+      for (int i = 0; i < operations; i++)
+        pending.push_back(runAsync(manager, i % KINDS, macs[i % macs.size()]));
+    }
+    std::cout.clear();
+    size_t ready = 0, dropped = 0;
+    for (auto &op : pending) {
+      if (!op.isReady())
+        continue;
+      ready++;
+      try {
+        op.get();
+      } catch (const OperationCancelled &) {
+        dropped++;
+      }
+    }
+    std::printf("  %-28s %zu/%zu completed, %zu of them cancelled\n",
+                "manager destroyed early", ready, pending.size(), dropped);
+    check(ready == pending.size(), "destroying the manager completes all");
+  }
+
+  return failures == 0 ? 0 : 1;
+}
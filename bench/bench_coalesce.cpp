@@ -0,0 +1,86 @@
+/**
+ * @file bench_coalesce.cpp
+ * @brief Sink calls per second with and without ScanCoalescer
+ *
+ * A producer thread fires discovery events for a few hundred devices as
+ * fast as it can, mostly RSSI updates, with some devices coming and
+ * going. A consumer drains the coalescer once per frame, like the GUI's
+ * frame timer.
+ *   ./bench/bench_coalesce [devices] [seconds] [frame_ms]
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include "include/ScanCoalescer.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+struct CountingSink : ScanObserver {
+  size_t calls = 0;
+  void onDeviceAdded(const BluetoothDevice &) override { calls++; }
+  void onDeviceUpdated(const BluetoothDevice &) override { calls++; }
+  void onDeviceRemoved(MacAddress) override { calls++; }
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int devices = argc > 1 ? std::atoi(argv[1]) : 500;
+  int seconds = argc > 2 ? std::atoi(argv[2]) : 2;
+  auto frame =
+      std::chrono::milliseconds(argc > 3 ? std::atoi(argv[3]) : 16);
+
+  CountingSink sink;
+  ScanCoalescer coalescer(sink, frame);
+  std::atomic<bool> done{false};
+
+  std::thread producer([&] {
+    BluetoothDevice device;
+    unsigned long n = 0;
+    while (!done.load(std::memory_order_relaxed)) {
+      int i = static_cast<int>(n % devices);
+      device.macAddress = MacAddress(0xAABBCC000000ull + i);
+      device.name = "Device " + std::to_string(i);
+      device.rssi = static_cast<int16_t>(-40 - n % 50);
+      if (n < static_cast<unsigned long>(devices))
+        coalescer.onDeviceAdded(device);
+      else if (n % 97 == 0)
+        coalescer.onDeviceRemoved(device.macAddress);
+      else
+        coalescer.onDeviceUpdated(device);
+      n++;
+    }
+  });
+
+  auto end = Clock::now() + std::chrono::seconds(seconds);
+  while (Clock::now() < end) {
+    std::this_thread::sleep_for(frame);
+    coalescer.flush();
+  }
+  done = true;
+  producer.join();
+  coalescer.flush();
+
+  auto stats = coalescer.getStats();
+  std::printf("%d devices, %d s, %lld ms frames\n", devices, seconds,
+              static_cast<long long>(frame.count()));
+  std::printf("  events received        %10zu (%.0f/s)\n", stats.received,
+              stats.received / static_cast<double>(seconds));
+  std::printf("  merged                 %10zu\n", stats.merged);
+  std::printf("  dropped                %10zu\n", stats.dropped);
+  std::printf("  sink calls             %10zu (%.0f/s)\n", sink.calls,
+              sink.calls / static_cast<double>(seconds));
+  std::printf("  flushes                %10zu (%.1f/s)\n", stats.flushes,
+              stats.flushes / static_cast<double>(seconds));
+  std::printf("  reduction              %10.1fx\n",
+              stats.received / static_cast<double>(sink.calls ? sink.calls : 1));
+  return 0;
+}
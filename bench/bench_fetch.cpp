@@ -0,0 +1,54 @@
+/**
+ * @file bench_fetch.cpp
+ * @brief Post-scan info fetch without a session: serial vs worker pool
+ *
+ * Every device costs one bluetoothctl process here, so this measures how
+ * well the bounded pool hides spawn time. Runs offline against the fake:
+ *   ./bench/bench_fetch [devices] [fake-bluetoothctl path]
+ *
+ * FAKE_BT_DELAY (default 0.02 s here) stands in for bluetoothctl's startup
+ * and D-Bus handshake.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "include/SubprocessBackend.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+int main(int argc, char *argv[]) {
+  int devices = argc > 1 ? std::stoi(argv[1]) : 32;
+  const char *fake = argc > 2 ? argv[2] : "bench/fake-bluetoothctl.sh";
+  setenv("TOOTHDROID_BLUETOOTHCTL", fake, 1);
+  setenv("FAKE_BT_DEVICES", std::to_string(devices).c_str(), 1);
+  setenv("FAKE_BT_DELAY", "0.02", 0);
+
+  std::printf("%d devices, one-shot bluetoothctl per info, delay %s s\n",
+              devices, std::getenv("FAKE_BT_DELAY"));
+
+  SubprocessBackend backend(false);
+  double serialMs = 0;
+  for (size_t jobs : {1, 2, 4, 8, 16}) {
+    backend.setFetchParallelism(jobs);
+    auto start = Clock::now();
+    auto result = backend.snapshotDevices(false);
+    double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    if (jobs == 1)
+      serialMs = ms;
+
+    // Order must match the `devices` listing no matter who finished first
+    bool ordered = true;
+    for (size_t i = 1; i < result.size(); i++)
+      ordered &= result[i - 1].macAddress < result[i].macAddress;
+
+    std::printf("  jobs %2zu   %8.1f ms   %5.2fx   %zu devices%s\n", jobs, ms,
+                serialMs / ms, result.size(), ordered ? "" : "  (ORDER!)");
+  }
+  return 0;
+}
@@ -0,0 +1,193 @@
+/**
+ * @file bench_gui_list.cpp
+ * @brief Device list cost: QListWidget + per-row widgets vs model/delegate
+ *
+ * Populates each list with synthetic devices, then scrolls it from top to
+ * bottom one page at a time, painting every page. The model is also
+ * refreshed from a snapshot that differs in a few rows.
+ *   make bench-gui
+ *   ./bench/bench_gui_list [devices]
+ * Without a display it runs on the offscreen platform.
+ */
+
+#include <QApplication>
+#include <QFile>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QListView>
+#include <QListWidget>
+#include <QPushButton>
+#include <QScrollBar>
+#include <QVBoxLayout>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "qt-gui/DeviceItemDelegate.h"
+#include "qt-gui/DeviceListModel.h"
+
+using namespace ToothDroid;
+using namespace ToothDroid::GUI;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// What MainWindow built per device before DeviceListModel: an icon, name,
+// MAC and profile label and a button, in nested layouts
+QWidget *legacyRow(const BluetoothDevice &device) {
+  auto *row = new QWidget;
+  auto *mainLayout = new QHBoxLayout(row);
+  mainLayout->setContentsMargins(16, 14, 16, 14);
+  mainLayout->setSpacing(12);
+
+  auto *icon = new QLabel(device.isConnected ? "🟢" : "⚪", row);
+  icon->setFixedSize(24, 24);
+  mainLayout->addWidget(icon);
+
+  auto *infoLayout = new QVBoxLayout();
+  auto *nameRow = new QHBoxLayout();
+  auto *name = new QLabel(QString::fromStdString(device.getDisplayName()), row);
+  name->setObjectName("deviceName");
+  nameRow->addWidget(name);
+  nameRow->addStretch();
+  infoLayout->addLayout(nameRow);
+
+  auto *detailsRow = new QHBoxLayout();
+  auto *mac =
+      new QLabel(QString::fromStdString(device.macAddress.toString()), row);
+  mac->setObjectName("deviceMac");
+  detailsRow->addWidget(mac);
+  if (device.hasAudioSupport()) {
+    auto *profile = new QLabel("A2DP HSP", row);
+    profile->setObjectName("deviceProfile");
+    detailsRow->addWidget(profile);
+  }
+  detailsRow->addStretch();
+  infoLayout->addLayout(detailsRow);
+  mainLayout->addLayout(infoLayout, 1);
+
+  auto *button =
+      new QPushButton(device.isConnected ? "Disconnect" : "Connect", row);
+  button->setFixedWidth(100);
+  button->setProperty("success", !device.isConnected);
+  mainLayout->addWidget(button);
+  return row;
+}
+
+std::vector<BluetoothDevice> syntheticDevices(int count) {
+  std::vector<BluetoothDevice> devices(count);
+  for (int i = 0; i < count; i++) {
+    auto &d = devices[i];
+    d.macAddress = MacAddress(0xAABBCC000000ull + i);
+    d.name = "Device " + std::to_string(i);
+    d.isPaired = i % 3 == 0;
+    d.isConnected = i % 17 == 0;
+    d.supportsA2DP = d.supportsHSP = i % 4 == 0;
+  }
+  return devices;
+}
+
+double millisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// Page through the whole list, painting each page synchronously
+double scrollAll(QAbstractItemView *view, int &pages) {
+  QScrollBar *bar = view->verticalScrollBar();
+  auto start = Clock::now();
+  pages = 0;
+  for (int y = 0; y <= bar->maximum(); y += bar->pageStep()) {
+    bar->setValue(y);
+    view->viewport()->repaint();
+    pages++;
+  }
+  return millisSince(start);
+}
+
+void report(const char *label, double populateMs, double scrollMs, int pages) {
+  std::printf("  %-24s populate %9.1f ms   scroll %9.1f ms (%.2f ms/page)\n",
+              label, populateMs, scrollMs, pages ? scrollMs / pages : 0.0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int count = argc > 1 ? std::atoi(argv[1]) : 5000;
+  if (qEnvironmentVariableIsEmpty("DISPLAY") &&
+      qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+  QApplication app(argc, argv);
+
+  // Stylesheet resolution is part of what per-row widgets cost
+  QFile styleFile("qt-gui/style.qss");
+  if (styleFile.open(QFile::ReadOnly))
+    app.setStyleSheet(QLatin1String(styleFile.readAll()));
+
+  auto devices = syntheticDevices(count);
+  std::printf("%d devices, 420x680 window\n\n", count);
+
+  {
+    QListWidget list;
+    list.resize(420, 680);
+    list.setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    list.show();
+    auto start = Clock::now();
+    for (const auto &device : devices) {
+      auto *item = new QListWidgetItem(&list);
+      item->setSizeHint(QSize(0, DeviceItemDelegate::ROW_HEIGHT));
+      list.setItemWidget(item, legacyRow(device));
+    }
+    app.processEvents();
+    double populateMs = millisSince(start);
+    int pages = 0;
+    double scrollMs = scrollAll(&list, pages);
+    report("item widgets (before)", populateMs, scrollMs, pages);
+  }
+
+  {
+    DeviceListModel model;
+    DeviceItemDelegate delegate;
+    QListView list;
+    list.setModel(&model);
+    list.setItemDelegate(&delegate);
+    list.setUniformItemSizes(true);
+    list.resize(420, 680);
+    list.setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
+    list.show();
+    auto start = Clock::now();
+    model.setDevices(devices);
+    app.processEvents();
+    double populateMs = millisSince(start);
+    int pages = 0;
+    double scrollMs = scrollAll(&list, pages);
+    report("model/delegate (after)", populateMs, scrollMs, pages);
+
+    // The streaming scan path: one upsert per discovery event
+    model.setDevices({});
+    start = Clock::now();
+    for (const auto &device : devices)
+      model.upsert(device);
+    app.processEvents();
+    std::printf("  %-24s populate %9.1f ms\n", "model upsert x N",
+                millisSince(start));
+
+    // A rescan that changed 1% of the devices and found 1% new ones
+    auto rescanned = devices;
+    for (int i = 0; i < count; i += 100) {
+      rescanned[i].isConnected = !rescanned[i].isConnected;
+      BluetoothDevice fresh;
+      fresh.macAddress = MacAddress(0xAABBCC000000ull + count + i);
+      fresh.name = "New device " + std::to_string(i);
+      rescanned.push_back(fresh);
+    }
+    start = Clock::now();
+    model.setDevices(rescanned);
+    app.processEvents();
+    std::printf("  %-24s refresh  %9.1f ms\n", "model diff (1% changed)",
+                millisSince(start));
+  }
+  return 0;
+}
@@ -0,0 +1,115 @@
+/**
+ * @file bench_history.cpp
+ * @brief DeviceHistory add / find / evict at 1k, 10k and 100k entries
+ *
+ * Compares the hash-indexed LRU history with the linear vector it
+ * replaced (reproduced below). The linear version is skipped at 100k,
+ * where filling it alone takes minutes:
+ *   ./bench/bench_history
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "include/BluetoothDevice.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// The previous DeviceHistory: linear search, erase(begin()) to evict
+class LinearHistory {
+private:
+  std::vector<BluetoothDevice> knownDevices;
+  size_t maxHistorySize;
+
+public:
+  explicit LinearHistory(size_t capacity) : maxHistorySize(capacity) {}
+
+  void addDevice(const BluetoothDevice &device) {
+    for (auto &d : knownDevices) {
+      if (d.macAddress == device.macAddress) {
+        d = device;
+        return;
+      }
+    }
+    if (knownDevices.size() >= maxHistorySize)
+      knownDevices.erase(knownDevices.begin());
+    knownDevices.push_back(device);
+  }
+
+  BluetoothDevice *findDevice(MacAddress mac) {
+    for (auto &d : knownDevices) {
+      if (d.macAddress == mac)
+        return &d;
+    }
+    return nullptr;
+  }
+};
+
+std::vector<BluetoothDevice> makeDevices(size_t count, uint64_t base) {
+  std::vector<BluetoothDevice> devices(count);
+  for (size_t i = 0; i < count; i++) {
+    devices[i].macAddress = MacAddress(base + i * 0x9E3779B1ull);
+    devices[i].name = "Device-" + std::to_string(i);
+  }
+  return devices;
+}
+
+double nanosPerOp(Clock::time_point start, size_t ops) {
+  return std::chrono::duration<double, std::nano>(Clock::now() - start)
+             .count() /
+         static_cast<double>(ops);
+}
+
+volatile size_t sink;
+
+template <typename History> void run(const char *label, size_t capacity) {
+  auto first = makeDevices(capacity, 0x001A7D000000ull);
+  auto second = makeDevices(capacity, 0x5C0000000000ull);
+
+  std::vector<MacAddress> lookups(capacity);
+  std::mt19937 rng(42);
+  for (auto &mac : lookups)
+    mac = first[rng() % capacity].macAddress;
+
+  History history(capacity);
+
+  auto start = Clock::now();
+  for (const auto &d : first)
+    history.addDevice(d);
+  double add = nanosPerOp(start, capacity);
+
+  start = Clock::now();
+  size_t hits = 0;
+  for (MacAddress mac : lookups)
+    hits += history.findDevice(mac) != nullptr;
+  double find = nanosPerOp(start, capacity);
+  sink = hits;
+
+  // History is full: every new device evicts the oldest one
+  start = Clock::now();
+  for (const auto &d : second)
+    history.addDevice(d);
+  double evict = nanosPerOp(start, capacity);
+
+  std::printf("  %-8s %7zu   add %10.1f ns   find %10.1f ns   "
+              "add+evict %10.1f ns%s\n",
+              label, capacity, add, find, evict,
+              hits == capacity ? "" : "  (MISSES!)");
+}
+
+} // namespace
+
+int main() {
+  std::printf("Per-operation cost, N operations at capacity N\n");
+  for (size_t capacity : {1000, 10000, 100000}) {
+    run<DeviceHistory>("lru", capacity);
+    if (capacity <= 10000)
+      run<LinearHistory>("linear", capacity);
+  }
+  return 0;
+}
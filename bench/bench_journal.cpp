@@ -0,0 +1,135 @@
+/**
+ * @file bench_journal.cpp
+ * @brief DeviceJournal: fsync per change vs group commit, and kill -9 replay
+ *
+ * Appends the same number of state changes with an fdatasync after every
+ * one (what saving each change durably costs) and through the journal's
+ * background group commit. Then forks a child that appends and is killed
+ * with SIGKILL mid-stream, and checks that replay returns every entry the
+ * child had acknowledged. Last, two journals share one file and one
+ * checkpoints, which must leave the other's entries in place:
+ *   ./bench/bench_journal [changes] [dir]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "include/DeviceJournal.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double millisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+DeviceJournal::Entry changeFor(size_t i) {
+  return DeviceJournal::makeEntry(MacAddress(0xAABBCC000000ull + i % 64),
+                                  i % 2 ? DeviceJournal::Change::Connected
+                                        : DeviceJournal::Change::Disconnected);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t changes = argc > 1 ? std::stoul(argv[1]) : 2000;
+  std::string dir = argc > 2 ? argv[2] : "/tmp";
+  std::string path = dir + "/bench_journal." + std::to_string(getpid());
+
+  std::printf("%zu changes in %s\n", changes, dir.c_str());
+
+  // Baseline: one fdatasync per change
+  {
+    unlink(path.c_str());
+    DeviceJournal journal(path);
+    journal.replay();
+    auto start = Clock::now();
+    for (size_t i = 0; i < changes; i++) {
+      journal.append(changeFor(i));
+      journal.sync();
+    }
+    double ms = millisSince(start);
+    auto stats = journal.getStats();
+    std::printf("  %-26s %9.2f ms  %8.1f us/change  %6zu syncs\n",
+                "fdatasync per change", ms, ms * 1e3 / changes, stats.syncs);
+  }
+
+  // Group commit: appends return after write(), syncs run behind them
+  {
+    unlink(path.c_str());
+    DeviceJournal journal(path);
+    journal.replay();
+    auto start = Clock::now();
+    for (size_t i = 0; i < changes; i++)
+      journal.append(changeFor(i));
+    double ms = millisSince(start);
+    journal.sync();
+    auto stats = journal.getStats();
+    std::printf("  %-26s %9.2f ms  %8.1f us/change  %6zu syncs\n",
+                "group commit (200 ms)", ms, ms * 1e3 / changes, stats.syncs);
+  }
+
+  // SIGKILL the writer; everything it acknowledged must replay
+  unlink(path.c_str());
+  int report[2];
+  if (pipe(report) != 0)
+    return 1;
+  pid_t child = fork();
+  if (child == 0) {
+    close(report[0]);
+    DeviceJournal journal(path);
+    journal.replay();
+    for (uint32_t i = 1;; i++) {
+      if (!journal.append(changeFor(i)))
+        _exit(1);
+      if (write(report[1], &i, sizeof(i)) != sizeof(i))
+        _exit(1);
+    }
+  }
+  close(report[1]);
+  uint32_t acknowledged = 0, value = 0;
+  while (acknowledged < changes &&
+         read(report[0], &value, sizeof(value)) == sizeof(value))
+    acknowledged = value;
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  while (read(report[0], &value, sizeof(value)) == sizeof(value))
+    acknowledged = value;
+  close(report[0]);
+
+  size_t replayed;
+  {
+    DeviceJournal recovered(path);
+    replayed = recovered.replay().size();
+  }
+  std::printf("  kill -9 after %u acknowledged changes: %zu replayed\n",
+              acknowledged, replayed);
+
+  // CLI and GUI sharing the journal: a checkpoint drops only its own
+  unlink(path.c_str());
+  size_t survived;
+  {
+    DeviceJournal cli(path), gui(path);
+    cli.replay();
+    gui.replay();
+    for (size_t i = 0; i < 10; i++) {
+      cli.append(changeFor(i));
+      gui.append(changeFor(i));
+    }
+    cli.checkpoint();
+    survived = gui.replay().size();
+  }
+  std::printf("  shared journal, one side checkpointed: %zu of 10 kept\n",
+              survived);
+  unlink(path.c_str());
+  return replayed >= acknowledged && survived == 10 ? 0 : 1;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file bench_parse.cpp
+ * @brief bluetoothctl output parsing: std::regex / substr vs string_view
+ *
+ * Builds 10k-line transcripts of `devices` and pipelined `info` output in
+ * the exact format bluetoothctl 5.7x prints, then parses them with the old
+ * regex/substr code (kept here as the baseline) and with the
+ * Bluetoothctl:: tokenizers the backend now uses:
+ *   ./bench/bench_parse [lines] [rounds]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "include/BluetoothctlParser.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+std::string macFor(size_t i) {
+  char mac[18];
+  std::snprintf(mac, sizeof(mac), "AA:BB:CC:%02X:%02X:%02X",
+                static_cast<unsigned>(i >> 16 & 255),
+                static_cast<unsigned>(i >> 8 & 255),
+                static_cast<unsigned>(i & 255));
+  return mac;
+}
+
+std::string devicesTranscript(size_t lines) {
+  std::string out;
+  for (size_t i = 0; i < lines; i++)
+    out += "Device " + macFor(i) + " WH-1000XM4 #" + std::to_string(i) + "\n";
+  return out;
+}
+
+// One `info` reply is 20 lines; repeat until `lines` is reached
+std::string infoTranscript(size_t lines, size_t &devices) {
+  std::string out;
+  devices = 0;
+  size_t written = 0;
+  while (written < lines) {
+    std::string mac = macFor(devices);
+    std::string n = std::to_string(devices);
+    out += "Device " + mac + " (public)\n"
+           "\tName: WH-1000XM4 #" + n + "\n"
+           "\tAlias: WH-1000XM4 #" + n + "\n"
+           "\tClass: 0x00240404\n"
+           "\tIcon: audio-headset\n"
+           "\tPaired: yes\n"
+           "\tBonded: yes\n"
+           "\tTrusted: yes\n"
+           "\tBlocked: no\n"
+           "\tConnected: " + std::string(devices % 7 ? "no" : "yes") + "\n"
+           "\tLegacyPairing: no\n"
+           "\tUUID: Vendor specific           (00000000-deca-fade-deca-deafdecacaff)\n"
+           "\tUUID: Headset                   (00001108-0000-1000-8000-00805f9b34fb)\n"
+           "\tUUID: Audio Sink                (0000110b-0000-1000-8000-00805f9b34fb)\n"
+           "\tUUID: A/V Remote Control Target (0000110c-0000-1000-8000-00805f9b34fb)\n"
+           "\tUUID: Handsfree                 (0000111e-0000-1000-8000-00805f9b34fb)\n"
+           "\tModalias: usb:v054Cp0D58d0100\n"
+           "\tManufacturerData Key: 0x012d\n"
+           "\tManufacturerData Value:\n"
+           "\tRSSI: 0xffffffc4 (-" + std::to_string(40 + devices % 50) + ")\n";
+    written += 20;
+    devices++;
+  }
+  return out;
+}
+
+// --- Baseline: the parsing code SubprocessBackend used before -------------
+
+std::vector<std::pair<std::string, std::string>>
+regexDevices(const std::string &output) {
+  std::vector<std::pair<std::string, std::string>> devices;
+  std::istringstream stream(output);
+  std::string line;
+  std::regex deviceRegex(R"(Device\s+([0-9A-Fa-f:]{17})\s+(.+))");
+  std::smatch match;
+  while (std::getline(stream, line)) {
+    if (std::regex_search(line, match, deviceRegex))
+      devices.emplace_back(match[1], match[2]);
+  }
+  return devices;
+}
+
+BluetoothDevice substrInfo(const std::string &mac, const std::string &info) {
+  BluetoothDevice device;
+  device.macAddress = MacAddress::fromString(mac);
+  std::istringstream stream(info);
+  std::string line;
+  while (std::getline(stream, line)) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos)
+      continue;
+    line = line.substr(start);
+    if (line.find("Name:") == 0) {
+      device.name = line.substr(6);
+    } else if (line.find("Alias:") == 0) {
+      device.alias = line.substr(7);
+    } else if (line.find("Paired:") == 0) {
+      device.isPaired = (line.find("yes") != std::string::npos);
+    } else if (line.find("Connected:") == 0) {
+      device.isConnected = (line.find("yes") != std::string::npos);
+    } else if (line.find("Trusted:") == 0) {
+      device.isTrusted = (line.find("yes") != std::string::npos);
+    } else if (line.find("Blocked:") == 0) {
+      device.isBlocked = (line.find("yes") != std::string::npos);
+    } else if (line.find("Icon:") == 0) {
+      device.icon = line.substr(6);
+    } else if (line.find("RSSI:") == 0) {
+      size_t paren = line.find('(');
+      device.rssi = static_cast<int16_t>(std::atoi(
+          line.c_str() + (paren != std::string::npos ? paren + 1 : 5)));
+    } else if (line.find("UUID: Audio Sink") != std::string::npos) {
+      device.supportsA2DP = true;
+    } else if (line.find("UUID: Headset") != std::string::npos) {
+      device.supportsHSP = true;
+    } else if (line.find("UUID: Handsfree") != std::string::npos) {
+      device.supportsHFP = true;
+    }
+  }
+  return device;
+}
+
+std::vector<BluetoothDevice> substrInfoBatch(const std::string &output) {
+  std::vector<std::pair<std::string, std::string>> blocks;
+  std::istringstream stream(output);
+  std::string line;
+  while (std::getline(stream, line)) {
+    if (line.rfind("Device ", 0) == 0 && line.size() >= 24) {
+      blocks.emplace_back(line.substr(7, 17), "");
+      continue;
+    }
+    if (!blocks.empty()) {
+      blocks.back().second += line;
+      blocks.back().second += '\n';
+    }
+  }
+  std::vector<BluetoothDevice> devices;
+  for (const auto &b : blocks)
+    devices.push_back(substrInfo(b.first, b.second));
+  return devices;
+}
+
+// --- Tokenizer path -------------------------------------------------------
+
+std::vector<std::pair<std::string, std::string>>
+viewDevices(const std::string &output) {
+  std::vector<std::pair<std::string, std::string>> devices;
+  Bluetoothctl::forEachDevice(output,
+                              [&](std::string_view mac, std::string_view name) {
+                                devices.emplace_back(std::string(mac),
+                                                     std::string(name));
+                              });
+  return devices;
+}
+
+std::vector<BluetoothDevice> viewInfoBatch(const std::string &output) {
+  std::vector<BluetoothDevice> devices;
+  Bluetoothctl::forEachInfoBlock(
+      output, [&](std::string_view mac, std::string_view body) {
+        devices.emplace_back();
+        devices.back().macAddress = MacAddress::fromString(mac);
+        Bluetoothctl::parseInfo(body, devices.back());
+      });
+  return devices;
+}
+
+// Tokenizer alone, no result copies: what the parsing itself costs
+size_t viewDevicesCount(const std::string &output) {
+  size_t count = 0;
+  Bluetoothctl::forEachDevice(
+      output, [&](std::string_view, std::string_view) { count++; });
+  return count;
+}
+
+// Keeps results observable so the optimizer cannot drop the work
+volatile size_t sink;
+
+template <typename Fn> double bestMillis(int rounds, Fn fn) {
+  double best = 1e300;
+  for (int r = 0; r < rounds; r++) {
+    auto start = Clock::now();
+    fn();
+    double ms =
+        std::chrono::duration<double, std::milli>(Clock::now() - start)
+            .count();
+    if (ms < best)
+      best = ms;
+  }
+  return best;
+}
+
+void report(const char *label, double ms, size_t lines, size_t bytes,
+            double baseline) {
+  std::printf("  %-28s %8.2f ms  %7.1f Mlines/s  %7.1f MB/s  %6.1fx\n", label,
+              ms, lines / ms / 1e3, bytes / ms / 1e3, baseline / ms);
+}
+
+bool sameDevice(const BluetoothDevice &a, const BluetoothDevice &b) {
+  return a.macAddress == b.macAddress && a.name == b.name &&
+         a.alias == b.alias && a.icon == b.icon && a.rssi == b.rssi &&
+         a.isPaired == b.isPaired && a.isConnected == b.isConnected &&
+         a.isTrusted == b.isTrusted && a.isBlocked == b.isBlocked &&
+         a.supportsA2DP == b.supportsA2DP && a.supportsHSP == b.supportsHSP &&
+         a.supportsHFP == b.supportsHFP;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  size_t lines = argc > 1 ? std::stoul(argv[1]) : 10000;
+  int rounds = argc > 2 ? std::atoi(argv[2]) : 20;
+
+  std::string devices = devicesTranscript(lines);
+  size_t infoDevices = 0;
+  std::string info = infoTranscript(lines, infoDevices);
+
+  // Both paths must agree before their timings mean anything
+  if (regexDevices(devices) != viewDevices(devices)) {
+    std::printf("devices: tokenizer and regex disagree\n");
+    return 1;
+  }
+  auto expected = substrInfoBatch(info);
+  auto actual = viewInfoBatch(info);
+  if (expected.size() != actual.size()) {
+    std::printf("info: %zu vs %zu devices\n", expected.size(), actual.size());
+    return 1;
+  }
+  for (size_t i = 0; i < expected.size(); i++) {
+    if (!sameDevice(expected[i], actual[i])) {
+      std::printf("info: device %zu differs\n", i);
+      return 1;
+    }
+  }
+
+  std::printf("`devices`: %zu lines, %zu bytes, best of %d\n", lines,
+              devices.size(), rounds);
+  double base = bestMillis(rounds, [&] { sink = regexDevices(devices).size(); });
+  report("std::regex", base, lines, devices.size(), base);
+  report("string_view tokenizer",
+         bestMillis(rounds, [&] { sink = viewDevices(devices).size(); }), lines,
+         devices.size(), base);
+  report("  (tokenize only)",
+         bestMillis(rounds, [&] { sink = viewDevicesCount(devices); }), lines,
+         devices.size(), base);
+
+  std::printf("`info` x %zu: %zu lines, %zu bytes, best of %d\n", infoDevices,
+              lines, info.size(), rounds);
+  base = bestMillis(rounds, [&] { sink = substrInfoBatch(info).size(); });
+  report("getline + substr", base, lines, info.size(), base);
+  report("string_view tokenizer",
+         bestMillis(rounds, [&] { sink = viewInfoBatch(info).size(); }), lines, info.size(),
+         base);
+  return 0;
+}
@@ -0,0 +1,97 @@
+/**
+ * @file bench_session.cpp
+ * @brief Per-command latency: one-shot popen vs persistent bluetoothctl
+ *
+ * Run against real hardware:
+ *   ./bench/bench_session [iterations]
+ * or offline against the fake:
+ *   TOOTHDROID_BLUETOOTHCTL=bench/fake-bluetoothctl.sh ./bench/bench_session
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/BluetoothctlSession.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Same code path as BluetoothManager::executeCommand before the session
+std::string popenCommand(const std::string &args) {
+  std::array<char, 128> buffer;
+  std::string result;
+  std::string cmd = bluetoothctlPath() + " " + args + " 2>&1";
+  FILE *pipe = popen(cmd.c_str(), "r");
+  if (!pipe)
+    return result;
+  while (fgets(buffer.data(), buffer.size(), pipe) != nullptr)
+    result += buffer.data();
+  pclose(pipe);
+  return result;
+}
+
+struct Stats {
+  double mean, p50, p95;
+};
+
+Stats measure(int iterations, const std::function<void()> &fn) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; i++) {
+    auto start = Clock::now();
+    fn();
+    samples.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double s : samples)
+    sum += s;
+  return {sum / samples.size(), samples[samples.size() / 2],
+          samples[samples.size() * 95 / 100]};
+}
+
+void report(const std::string &label, const Stats &s) {
+  std::printf("  %-24s mean %9.1f us   p50 %9.1f us   p95 %9.1f us\n",
+              label.c_str(), s.mean, s.p50, s.p95);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 100;
+  std::vector<std::string> commands = {"show", "info AA:BB:CC:00:00:01"};
+
+  BluetoothctlSession session;
+  auto startBegin = Clock::now();
+  if (!session.start()) {
+    std::cerr << "Could not start " << bluetoothctlPath() << std::endl;
+    return 1;
+  }
+  double startupUs =
+      std::chrono::duration<double, std::micro>(Clock::now() - startBegin)
+          .count();
+
+  std::printf("bluetoothctl: %s, %d iterations\n", bluetoothctlPath().c_str(),
+              iterations);
+  std::printf("  session startup          %9.1f us (paid once)\n", startupUs);
+
+  for (const auto &cmd : commands) {
+    std::printf("\n%s\n", cmd.c_str());
+    Stats before = measure(iterations, [&] { popenCommand(cmd); });
+    Stats after = measure(iterations, [&] { session.command(cmd); });
+    report("popen (before)", before);
+    report("session (after)", after);
+    std::printf("  speedup                  %9.1fx\n", before.mean / after.mean);
+  }
+  return 0;
+}
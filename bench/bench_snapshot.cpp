@@ -0,0 +1,90 @@
+/**
+ * @file bench_snapshot.cpp
+ * @brief Post-scan device fetch: N+1 `info` calls vs one bulk snapshot
+ *
+ * Uses bench/fake-bluetoothctl.sh with 10, 100 and 1000 synthetic devices:
+ *   ./bench/bench_snapshot [fake-bluetoothctl path]
+ *
+ * The fake answers instantly, which leaves only the parsing both paths
+ * share. The second set of rows gives every exchange 1 ms of turnaround
+ * (FAKE_BT_LATENCY), which N+1 pays per device and the pipelined snapshot
+ * pays once.
+ *
+ * When built with libsystemd and TOOTHDROID_DBUS_BUS is set, the D-Bus
+ * backend is measured as well against whatever org.bluez is on that bus.
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "include/DBusBackend.h"
+#include "include/SubprocessBackend.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+double millisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+// The pre-snapshot path: list, then one info exchange per row
+size_t fetchOneByOne(BluetoothBackend &backend) {
+  size_t count = 0;
+  for (const auto &entry : backend.listDevices(false)) {
+    BluetoothDevice device = backend.deviceInfo(entry.first);
+    count += device.macAddress.isNull() ? 0 : 1;
+  }
+  return count;
+}
+
+void run(BluetoothBackend &backend, const std::string &label) {
+  auto start = Clock::now();
+  size_t serial = fetchOneByOne(backend);
+  double serialMs = millisSince(start);
+
+  start = Clock::now();
+  size_t bulk = backend.snapshotDevices(false).size();
+  double bulkMs = millisSince(start);
+
+  std::printf("%-22s %6zu devices   N+1 %9.1f ms   snapshot %9.1f ms   "
+              "%6.1fx\n",
+              label.c_str(), serial, serialMs, bulkMs,
+              bulkMs > 0 ? serialMs / bulkMs : 0.0);
+  if (serial != bulk)
+    std::printf("  warning: snapshot returned %zu devices\n", bulk);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  const char *fake = argc > 1 ? argv[1] : "bench/fake-bluetoothctl.sh";
+  setenv("TOOTHDROID_BLUETOOTHCTL", fake, 1);
+
+  struct Latency {
+    const char *seconds;
+    const char *label;
+  };
+  for (const Latency &latency : {Latency{"0", "bluetoothctl, 0 ms rtt"},
+                                 Latency{"0.001", "bluetoothctl, 1 ms rtt"}}) {
+    setenv("FAKE_BT_LATENCY", latency.seconds, 1);
+    for (int count : {10, 100, 1000}) {
+      setenv("FAKE_BT_DEVICES", std::to_string(count).c_str(), 1);
+      SubprocessBackend backend;
+      run(backend, latency.label);
+    }
+  }
+
+#ifdef TOOTHDROID_HAVE_SDBUS
+  if (std::getenv("TOOTHDROID_DBUS_BUS")) {
+    DBusBackend backend;
+    run(backend, "dbus");
+  }
+#endif
+  return 0;
+}
@@ -0,0 +1,106 @@
+/**
+ * @file bench_spawn.cpp
+ * @brief Spawn+read latency: popen through /bin/sh vs runProcess()
+ *
+ * Run against the real tools:
+ *   ./bench/bench_spawn [iterations]
+ * or offline against the fake, with a large `devices` listing:
+ *   TOOTHDROID_BLUETOOTHCTL=bench/fake-bluetoothctl.sh FAKE_BT_DEVICES=2000 \
+ *     ./bench/bench_spawn
+ *
+ * Commands whose program cannot be started (e.g. no pactl) are skipped.
+ */
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "include/BluetoothctlSession.h"
+#include "include/Subprocess.h"
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Same code path as executeCommand before runProcess()
+std::string popenCommand(const std::string &cmd) {
+  std::array<char, 128> buffer;
+  std::string result;
+  FILE *pipe = popen((cmd + " 2>&1").c_str(), "r");
+  if (!pipe)
+    return result;
+  while (fgets(buffer.data(), buffer.size(), pipe) != nullptr)
+    result += buffer.data();
+  pclose(pipe);
+  return result;
+}
+
+std::string joinArgv(const std::vector<std::string> &argv) {
+  std::string cmd;
+  for (const auto &a : argv)
+    cmd += (cmd.empty() ? "" : " ") + a;
+  return cmd;
+}
+
+struct Stats {
+  double mean, p50, p95;
+};
+
+Stats measure(int iterations, const std::function<void()> &fn) {
+  std::vector<double> samples;
+  samples.reserve(iterations);
+  for (int i = 0; i < iterations; i++) {
+    auto start = Clock::now();
+    fn();
+    samples.push_back(
+        std::chrono::duration<double, std::micro>(Clock::now() - start)
+            .count());
+  }
+  std::sort(samples.begin(), samples.end());
+  double sum = 0;
+  for (double s : samples)
+    sum += s;
+  return {sum / samples.size(), samples[samples.size() / 2],
+          samples[samples.size() * 95 / 100]};
+}
+
+void report(const std::string &label, const Stats &s) {
+  std::printf("  %-24s mean %9.1f us   p50 %9.1f us   p95 %9.1f us\n",
+              label.c_str(), s.mean, s.p50, s.p95);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  int iterations = argc > 1 ? std::stoi(argv[1]) : 100;
+  std::vector<std::vector<std::string>> commands = {
+      {bluetoothctlPath(), "info", "AA:BB:CC:00:00:01"},
+      {bluetoothctlPath(), "devices"},
+      {"pactl", "list"},
+  };
+
+  std::printf("%d iterations\n", iterations);
+  for (const auto &cmd : commands) {
+    std::string line = joinArgv(cmd);
+    CommandResult probe = runProcess(cmd, Deadline::TOOL);
+    if (!probe.started) {
+      std::printf("\n%s\n  skipped: could not start %s\n", line.c_str(),
+                  cmd[0].c_str());
+      continue;
+    }
+    std::printf("\n%s (%zu bytes)\n", line.c_str(), probe.output.size());
+    Stats before = measure(iterations, [&] { popenCommand(line); });
+    Stats after =
+        measure(iterations, [&] { runProcess(cmd, Deadline::TOOL); });
+    report("popen + sh (before)", before);
+    report("runProcess (after)", after);
+    std::printf("  speedup                  %9.1fx\n", before.mean / after.mean);
+  }
+  return 0;
+}
@@ -0,0 +1,235 @@
+#!/usr/bin/env bash
+#
+# Minimal bluetoothctl stand-in for offline benchmarks.
+#
+# Usage:
+#   TOOTHDROID_BLUETOOTHCTL=bench/fake-bluetoothctl.sh ./bench/bench_session
+#
+# Environment:
+#   FAKE_BT_DEVICES   Number of synthetic devices (default 30)
+#   FAKE_BT_DELAY     Seconds to sleep per command, e.g. 0.005 (default 0)
+#   FAKE_BT_LATENCY   Seconds to sleep whenever the interactive loop had to
+#                     wait for its next command (default 0). Models the
+#                     turnaround of one request/reply exchange: commands
+#                     written back to back pay it once, one at a time pay
+#                     it every time.
+#   FAKE_BT_SCAN_INTERVAL
+#                     Seconds between [NEW] Device events after `scan on`;
+#                     0 reports all devices at once (default 0)
+#   FAKE_BT_LOG       File to append every received command to
+#   FAKE_BT_ADAPTERS  Number of controllers for `list` / `select` (default
+#                     1). With more than one, each controller misses a
+#                     different third of the devices and hears the rest at
+#                     a different RSSI.
+#   FAKE_BT_HANG      Commands that never report a result, e.g. "pair
+#                     connect", like a device that stopped answering. The
+#                     interactive loop keeps serving other commands; a
+#                     one-shot call blocks until it is killed.
+#
+# With arguments it behaves like one-shot `bluetoothctl [--timeout N] <cmd>`;
+# without arguments it runs an interactive loop that prints a prompt after
+# each response, like the real tool does on a pipe.
+
+DEVICES=${FAKE_BT_DEVICES:-30}
+DELAY=${FAKE_BT_DELAY:-0}
+LATENCY=${FAKE_BT_LATENCY:-0}
+ADAPTERS=${FAKE_BT_ADAPTERS:-1}
+SCAN_INTERVAL=${FAKE_BT_SCAN_INTERVAL:-0}
+HANG=" ${FAKE_BT_HANG:-} "
+ONESHOT=0
+TIMEOUT=
+PROMPT='[bluetooth]# '
+CONTROLLER=00:1A:7D:DA:71:13
+ADAPTER=0 # Index of the selected controller
+POWERED=yes
+
+# Helpers assign to globals instead of echoing so no subshell is forked per
+# device; otherwise the fake itself would dominate large benchmarks.
+mac_for() {
+  printf -v MAC 'AA:BB:CC:%02X:%02X:%02X' $(($1 >> 16 & 255)) $(($1 >> 8 & 255)) $(($1 & 255))
+}
+
+controller_for() {
+  printf -v CONTROLLER_MAC '00:1A:7D:DA:71:%02X' $((0x13 + $1))
+}
+
+# Sets SEES=1 if the selected controller hears device $1
+sees() {
+  SEES=1
+  if ((ADAPTERS > 1 && $1 % ADAPTERS == (ADAPTER + 1) % ADAPTERS)); then
+    SEES=0
+  fi
+}
+
+# Succeeds if command $1 should hang; a one-shot call never returns
+hang() {
+  [[ $HANG == *" $1 "* ]] || return 1
+  ((ONESHOT)) && sleep 3600
+  return 0
+}
+
+index_for() {
+  local mac=$1
+  INDEX=$((16#${mac:9:2} << 16 | 16#${mac:12:2} << 8 | 16#${mac:15:2}))
+}
+
+list_devices() {
+  local only_paired=$1 i
+  for ((i = 0; i < DEVICES; i++)); do
+    if [[ $only_paired == 1 && $((i % 4)) != 0 ]]; then
+      continue
+    fi
+    sees $i
+    ((SEES)) || continue
+    mac_for $i
+    printf 'Device %s Device-%d\n' "$MAC" "$i"
+  done
+}
+
+yes_no() {
+  if (($1)); then YN=yes; else YN=no; fi
+}
+
+device_info() {
+  local mac=$1 i paired connected icon=phone
+  if [[ ! $mac =~ ^AA:BB:CC:[0-9A-F]{2}:[0-9A-F]{2}:[0-9A-F]{2}$ ]]; then
+    printf 'Device %s not available\n' "$mac"
+    return
+  fi
+  index_for "$mac"
+  i=$INDEX
+  sees $i
+  if ((i >= DEVICES || !SEES)); then
+    printf 'Device %s not available\n' "$mac"
+    return
+  fi
+  ((i % 2 == 0)) && icon=audio-headset
+  yes_no $((i % 4 == 0))
+  paired=$YN
+  yes_no $((i == 0))
+  connected=$YN
+  printf 'Device %s (public)\n' "$mac"
+  printf '\tName: Device-%d\n\tAlias: Device-%d\n' "$i" "$i"
+  printf '\tClass: 0x00240404\n\tIcon: %s\n' "$icon"
+  printf '\tPaired: %s\n\tBonded: no\n\tTrusted: %s\n' "$paired" "$paired"
+  printf '\tBlocked: no\n\tConnected: %s\n\tLegacyPairing: no\n' "$connected"
+  if ((i % 2 == 0)); then
+    printf '\tUUID: Audio Sink                (0000110b-0000-1000-8000-00805f9b34fb)\n'
+    printf '\tUUID: Headset                   (00001108-0000-1000-8000-00805f9b34fb)\n'
+    printf '\tUUID: Handsfree                 (0000111e-0000-1000-8000-00805f9b34fb)\n'
+  fi
+  printf '\tRSSI: -%d\n' $((40 + (i + 7 * ADAPTER) % 50))
+}
+
+handle() {
+  local cmd=$1 arg=$2 i
+  if [[ $DELAY != 0 ]]; then sleep "$DELAY"; fi
+  if [[ -n $FAKE_BT_LOG ]]; then echo "$cmd${arg:+ $arg}" >>"$FAKE_BT_LOG"; fi
+  case $cmd in
+  --version | version) echo 'bluetoothctl: 5.72' ;;
+  show)
+    printf 'Controller %s (public)\n' "$CONTROLLER"
+    printf '\tName: fakehost\n\tAlias: fakehost\n\tPowered: %s\n' "$POWERED"
+    printf '\tDiscoverable: no\n\tPairable: yes\n\tDiscovering: no\n'
+    ;;
+  list)
+    for ((i = 0; i < ADAPTERS; i++)); do
+      controller_for $i
+      printf 'Controller %s fakehost #%d%s\n' "$CONTROLLER_MAC" "$i" \
+        "$( ((i == 0)) && echo ' [default]')"
+    done
+    ;;
+  select)
+    for ((i = 0; i < ADAPTERS; i++)); do
+      controller_for $i
+      if [[ ${arg^^} == "$CONTROLLER_MAC" ]]; then
+        ADAPTER=$i
+        CONTROLLER=$CONTROLLER_MAC
+        return
+      fi
+    done
+    echo "Controller $arg not available"
+    ;;
+  power)
+    local was=$POWERED
+    [[ $arg == on ]] && POWERED=yes || POWERED=no
+    [[ $was != "$POWERED" ]] && echo "[CHG] Controller $CONTROLLER Powered: $POWERED"
+    echo "Changing power $arg succeeded"
+    ;;
+  scan)
+    if [[ $arg == on ]]; then
+      echo 'Discovery started'
+      if [[ $SCAN_INTERVAL == 0 ]]; then
+        for ((i = 0; i < DEVICES; i++)); do
+          sees $i
+          ((SEES)) || continue
+          mac_for $i
+          printf '[NEW] Device %s Device-%d\n' "$MAC" "$i"
+        done
+      else
+        # Trickle devices in asynchronously, like a real scan
+        (
+          for ((i = 0; i < DEVICES; i++)); do
+            sleep "$SCAN_INTERVAL"
+            sees $i
+            ((SEES)) || continue
+            mac_for $i
+            printf '[NEW] Device %s Device-%d\n%s' "$MAC" "$i" "$PROMPT"
+          done
+        ) &
+        SCAN_PID=$!
+      fi
+    else
+      [[ -n $SCAN_PID ]] && kill "$SCAN_PID" 2>/dev/null
+      SCAN_PID=
+      echo 'Discovery stopped'
+    fi
+    ;;
+  devices) list_devices "$([[ $arg == Paired ]] && echo 1 || echo 0)" ;;
+  paired-devices) list_devices 1 ;;
+  info) device_info "$arg" ;;
+  pair)
+    echo "Attempting to pair with $arg"
+    hang pair || echo 'Pairing successful'
+    ;;
+  connect)
+    echo "Attempting to connect to $arg"
+    hang connect || echo 'Connection successful'
+    ;;
+  disconnect) echo "Attempting to disconnect from $arg" && echo 'Successful disconnected' ;;
+  trust) echo "Changing $arg trust succeeded" ;;
+  block) echo "Changing $arg block succeeded" ;;
+  unblock) echo "Changing $arg unblock succeeded" ;;
+  remove) echo 'Device has been removed' ;;
+  *) echo "Invalid command in menu main: $cmd" ;;
+  esac
+}
+
+if [[ $1 == --timeout ]]; then
+  TIMEOUT=$2
+  shift 2
+fi
+
+if [[ $# -gt 0 ]]; then
+  ONESHOT=1
+  handle "$1" "$2"
+  # Like the real tool, --timeout keeps it running (and scanning) that long
+  [[ -n $TIMEOUT ]] && sleep "$TIMEOUT"
+  exit 0
+fi
+
+printf '%s' "$PROMPT"
+while true; do
+  # read -t 0 succeeds if the next command is already waiting
+  idle=0
+  [[ $LATENCY != 0 ]] && ! read -t 0 && idle=1
+  IFS= read -r line || break
+  ((idle)) && sleep "$LATENCY"
+  read -r cmd arg _ <<<"$line"
+  case $cmd in
+  quit | exit) exit 0 ;;
+  '') ;;
+  *) handle "$cmd" "$arg" ;;
+  esac
+  printf '%s' "$PROMPT"
+done
@@ -0,0 +1,141 @@
+#ifndef TOOTHDROID_ADAPTER_H
+#define TOOTHDROID_ADAPTER_H
+
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include "BluetoothBackend.h"
+#include "BluetoothctlParser.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Cached state of the local adapter
+ *
+ * Filled once from `bluetoothctl show` style text and then kept current by
+ * the backend's adapter change notifications, so checking whether the
+ * adapter is powered costs no round-trip. Only trusted while the backend
+ * actually reports changes (see BluetoothBackend::watchAdapter()).
+ */
+class Adapter {
+private:
+  mutable std::mutex mutex;
+  AdapterState state;
+  bool loaded = false;
+  bool live = false;
+
+  void applyLocked(std::string_view property, std::string_view value) {
+    bool yes = Bluetoothctl::startsWith(value, "yes");
+    switch (property.front()) {
+    case 'A':
+      if (property == "Alias")
+        state.name.assign(value.data(), value.size());
+      break;
+    case 'D':
+      if (property == "Discovering")
+        state.discovering = yes;
+      else if (property == "Discoverable")
+        state.discoverable = yes;
+      break;
+    case 'N':
+      // The alias is what other devices see; the name is only a fallback
+      if (property == "Name" && state.name.empty())
+        state.name.assign(value.data(), value.size());
+      break;
+    case 'P':
+      if (property == "Powered")
+        state.powered = yes;
+      else if (property == "Pairable")
+        state.pairable = yes;
+      break;
+    default:
+      break;
+    }
+  }
+
+public:
+  /**
+   * @brief Replace the state with `show` output
+   * @return false if the text did not describe a controller
+   */
+  bool load(std::string_view show) {
+    static constexpr std::string_view header = "Controller ";
+    Bluetoothctl::LineReader reader(show);
+    std::string_view line;
+    AdapterState parsed;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::swap(state, parsed);
+    bool found = false;
+    while (reader.next(line)) {
+      if (Bluetoothctl::startsWith(line, header) &&
+          Bluetoothctl::startsWithMac(line.substr(header.size()))) {
+        state.address = MacAddress::fromString(line.substr(header.size(), 17));
+        found = true;
+        continue;
+      }
+      line = Bluetoothctl::trimLeft(line);
+      size_t colon = line.find(':');
+      if (colon == std::string_view::npos || colon == 0)
+        continue;
+      applyLocked(line.substr(0, colon),
+                  Bluetoothctl::trimLeft(line.substr(colon + 1)));
+    }
+    if (!found) {
+      std::swap(state, parsed);
+      return false;
+    }
+    loaded = true;
+    return true;
+  }
+
+  /**
+   * @brief Apply one change notification, e.g. ("Powered", "no")
+   */
+  void apply(std::string_view property, std::string_view value) {
+    if (property.empty())
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    applyLocked(property, value);
+  }
+
+  /**
+   * @brief Record the outcome of our own power change
+   */
+  void setPowered(bool on) {
+    std::lock_guard<std::mutex> lock(mutex);
+    state.powered = on;
+  }
+
+  /**
+   * @brief Whether change notifications keep this state up to date
+   */
+  void setLive(bool value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    live = value;
+  }
+
+  /**
+   * @brief Loaded and kept current, so it can stand in for a round-trip
+   */
+  bool isCurrent() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return loaded && live;
+  }
+
+  bool isLive() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return live;
+  }
+
+  AdapterState get() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_ADAPTER_H
@@ -0,0 +1,141 @@
+#ifndef TOOTHDROID_ADAPTER_GROUP_H
+#define TOOTHDROID_ADAPTER_GROUP_H
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BluetoothManager.h"
+#include "WorkerPool.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief RSSI of one device as heard by one adapter
+ */
+struct AdapterRssi {
+  MacAddress adapter;
+  int16_t rssi = 0; // 0 if the adapter knows the device but had no reading
+};
+
+/**
+ * @brief One row of a multi-adapter scan
+ */
+struct MergedDevice {
+  BluetoothDevice device; // As reported by the adapter that hears it best
+  MacAddress bestAdapter;
+  std::vector<AdapterRssi> rssi; // One entry per adapter that saw it
+};
+
+/**
+ * @brief One BluetoothManager per adapter, scanned in parallel
+ *
+ * Every adapter runs discovery at the same time on its own worker; the
+ * results are merged into one table keyed by device address, keeping the
+ * RSSI each adapter measured. The per-adapter managers are members with no
+ * store, journal or agent; merged results are kept by the primary manager.
+ */
+class AdapterGroup {
+private:
+  BluetoothManager &primary;
+  std::vector<std::unique_ptr<BluetoothManager>> managers;
+  std::unique_ptr<WorkerPool> pool;
+
+  // Treat "no reading" as weaker than any real one
+  static int strength(int16_t rssi) { return rssi != 0 ? rssi : -1000; }
+
+public:
+  /**
+   * @param primary     Manager that keeps the results; must outlive the
+   *                    group
+   * @param controllers Adapters to drive, e.g. from listControllers()
+   * @throws BluetoothException if any of them cannot be opened
+   */
+  AdapterGroup(BluetoothManager &primary,
+               const std::vector<ControllerInfo> &controllers)
+      : primary(primary) {
+    for (const auto &controller : controllers) {
+      auto manager = std::make_unique<BluetoothManager>(controller.address,
+                                                        ManagerRole::Member);
+      manager->setVerbose(false);
+      managers.push_back(std::move(manager));
+    }
+    if (!managers.empty())
+      pool = std::make_unique<WorkerPool>(managers.size());
+  }
+
+  size_t size() const { return managers.size(); }
+
+  BluetoothManager &manager(size_t i) { return *managers[i]; }
+
+  /**
+   * @brief Scan on every adapter at once and merge the results
+   *
+   * The merged devices are saved through the primary manager.
+   * @param duration Seconds; all adapters scan for the same window
+   * @return Devices by best RSSI, strongest first
+   */
+  std::vector<MergedDevice> scan(int duration) {
+    if (managers.empty())
+      return {};
+    auto perAdapter = pool->map(
+        managers, [duration](const std::unique_ptr<BluetoothManager> &m) {
+          return std::make_pair(m->getController(), m->scanDevices(duration));
+        });
+    std::vector<MergedDevice> merged = merge(perAdapter);
+    std::vector<BluetoothDevice> devices;
+    devices.reserve(merged.size());
+    for (const auto &row : merged)
+      devices.push_back(row.device);
+    primary.rememberDevices(std::move(devices));
+    return merged;
+  }
+
+  /**
+   * @brief De-duplicate per-adapter device lists by address
+   *
+   * Pairing and connection state are per adapter in BlueZ; a device counts
+   * as paired or connected if it is on any adapter.
+   */
+  static std::vector<MergedDevice>
+  merge(const std::vector<std::pair<MacAddress, std::vector<BluetoothDevice>>>
+            &perAdapter) {
+    std::vector<MergedDevice> merged;
+    std::unordered_map<MacAddress, size_t> index;
+
+    for (const auto &entry : perAdapter) {
+      for (const auto &device : entry.second) {
+        auto it = index.find(device.macAddress);
+        if (it == index.end()) {
+          index.emplace(device.macAddress, merged.size());
+          merged.push_back({device, entry.first, {{entry.first, device.rssi}}});
+          continue;
+        }
+
+        MergedDevice &row = merged[it->second];
+        row.rssi.push_back({entry.first, device.rssi});
+        bool paired = row.device.isPaired || device.isPaired;
+        bool connected = row.device.isConnected || device.isConnected;
+        if (strength(device.rssi) > strength(row.device.rssi)) {
+          row.device = device;
+          row.bestAdapter = entry.first;
+        }
+        row.device.isPaired = paired;
+        row.device.isConnected = connected;
+      }
+    }
+
+    std::stable_sort(merged.begin(), merged.end(),
+                     [](const MergedDevice &a, const MergedDevice &b) {
+                       return strength(a.device.rssi) >
+                              strength(b.device.rssi);
+                     });
+    return merged;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_ADAPTER_GROUP_H
@@ -1,12 +1,11 @@
 #ifndef TOOTHDROID_AUDIO_PROFILE_H
 #define TOOTHDROID_AUDIO_PROFILE_H
 
-#include <array>
-#include <cstdio>
 #include <sstream>
 #include <string>
 #include <vector>
 
+#include "Subprocess.h"
 #include "UI.h"
 
 namespace ToothDroid {
@@ -28,23 +27,16 @@ class AudioManager {
 private:
   bool usePipeWire = false;
 
-  std::string executeCommand(const std::string &cmd) const {
-    std::array<char, 128> buffer;
-    std::string result;
-    FILE *pipe = popen(cmd.c_str(), "r");
-    if (!pipe)
-      return "";
-    while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-      result += buffer.data();
-    }
-    pclose(pipe);
-    return result;
+  // pactl can hang when the sound server is wedged
+  std::string executeCommand(const std::vector<std::string> &argv,
+                             StderrMode stderrMode = StderrMode::Merge) const {
+    return runProcess(argv, Deadline::TOOL, CancelToken(), stderrMode).output;
   }
 
 public:
   AudioManager() {
     // Detect if we're using PipeWire or PulseAudio
-    std::string result = executeCommand("pactl info 2>&1");
+    std::string result = executeCommand({"pactl", "info"});
     usePipeWire = (result.find("PipeWire") != std::string::npos);
   }
 
@@ -65,7 +57,8 @@ public:
    */
   std::vector<std::string> getAudioSinks() {
     std::vector<std::string> sinks;
-    std::string output = executeCommand("pactl list sinks short");
+    std::string output = executeCommand({"pactl", "list", "sinks", "short"},
+                                        StderrMode::Inherit);
     std::istringstream stream(output);
     std::string line;
 
@@ -82,7 +75,8 @@ public:
    */
   std::vector<std::string> getAudioSources() {
     std::vector<std::string> sources;
-    std::string output = executeCommand("pactl list sources short");
+    std::string output = executeCommand(
+        {"pactl", "list", "sources", "short"}, StderrMode::Inherit);
     std::istringstream stream(output);
     std::string line;
 
@@ -98,8 +92,8 @@ public:
    * @brief Set default audio sink to Bluetooth device
    */
   bool setBluetoothAsSink(const std::string &sinkName) {
-    std::string cmd = "pactl set-default-sink \"" + sinkName + "\"";
-    std::string result = executeCommand(cmd + " 2>&1");
+    std::string result =
+        executeCommand({"pactl", "set-default-sink", sinkName});
     return result.empty(); // Empty output means success
   }
 
@@ -107,8 +101,8 @@ public:
    * @brief Set default audio source to Bluetooth device
    */
   bool setBluetoothAsSource(const std::string &sourceName) {
-    std::string cmd = "pactl set-default-source \"" + sourceName + "\"";
-    std::string result = executeCommand(cmd + " 2>&1");
+    std::string result =
+        executeCommand({"pactl", "set-default-source", sourceName});
     return result.empty();
   }
 
@@ -146,9 +140,9 @@ public:
     if (percent > 150)
       percent = 150;
 
-    std::string cmd = "pactl set-sink-volume \"" + sinkName + "\" " +
-                      std::to_string(percent) + "%";
-    executeCommand(cmd);
+    executeCommand({"pactl", "set-sink-volume", sinkName,
+                    std::to_string(percent) + "%"},
+                   StderrMode::Inherit);
     return true;
   }
 
@@ -156,9 +150,8 @@ public:
    * @brief Mute/unmute a sink
    */
   bool setMute(const std::string &sinkName, bool mute) {
-    std::string cmd =
-        "pactl set-sink-mute \"" + sinkName + "\" " + (mute ? "1" : "0");
-    executeCommand(cmd);
+    executeCommand({"pactl", "set-sink-mute", sinkName, mute ? "1" : "0"},
+                   StderrMode::Inherit);
     return true;
   }
 
@@ -174,7 +167,8 @@ public:
     }
 
     // Find the card
-    std::string cards = executeCommand("pactl list cards short");
+    std::string cards = executeCommand({"pactl", "list", "cards", "short"},
+                                        StderrMode::Inherit);
     std::istringstream stream(cards);
     std::string line;
     std::string cardName;
@@ -193,8 +187,8 @@ public:
       return false;
     }
 
-    std::string cmd = "pactl set-card-profile \"" + cardName + "\" " + profile;
-    std::string result = executeCommand(cmd + " 2>&1");
+    std::string result =
+        executeCommand({"pactl", "set-card-profile", cardName, profile});
     return result.empty();
   }
 
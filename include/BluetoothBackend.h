@@ -0,0 +1,223 @@
+#ifndef TOOTHDROID_BLUETOOTH_BACKEND_H
+#define TOOTHDROID_BLUETOOTH_BACKEND_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "BluetoothDevice.h"
+#include "CancelToken.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Exception class for Bluetooth operations
+ */
+class BluetoothException : public std::runtime_error {
+public:
+  explicit BluetoothException(const std::string &msg)
+      : std::runtime_error(msg) {}
+};
+
+/**
+ * @brief Outcome of a backend operation
+ *
+ * `message` carries the raw bluetoothctl output or the D-Bus error text so
+ * the manager can show it when an operation fails.
+ */
+struct BackendResult {
+  bool ok = false;
+  std::string message;
+};
+
+/**
+ * @brief A device appearing, changing or vanishing
+ *
+ * Sent during discovery, and through watchDevices() outside it.
+ */
+struct DiscoveryEvent {
+  enum class Type { Added, Changed, Removed };
+
+  Type type = Type::Added;
+  MacAddress mac;
+  std::string name; // Empty if the event did not carry one
+  int16_t rssi = 0; // 0 if the event did not carry one
+  std::optional<bool> connected; // Empty if the event did not carry them
+  std::optional<bool> paired;
+};
+
+using DiscoveryCallback = std::function<void(const DiscoveryEvent &)>;
+
+/**
+ * @brief One local adapter (controller) as listed by BlueZ
+ */
+struct ControllerInfo {
+  MacAddress address;
+  std::string name;
+  bool isDefault = false;
+};
+
+/**
+ * @brief Properties of the local adapter
+ */
+struct AdapterState {
+  MacAddress address;
+  std::string name; // Alias if set, otherwise the system name
+  bool powered = false;
+  bool discovering = false;
+  bool discoverable = false;
+  bool pairable = false;
+};
+
+/**
+ * @brief An adapter property changed, in `bluetoothctl show` terms
+ *        (e.g. "Powered", "no")
+ */
+using AdapterCallback =
+    std::function<void(std::string_view property, std::string_view value)>;
+
+/**
+ * @brief Transport used by BluetoothManager to talk to BlueZ
+ *
+ * Implementations:
+ *  - SubprocessBackend: drives bluetoothctl (always available)
+ *  - DBusBackend: native org.bluez calls over sd-bus (when built with
+ *    libsystemd)
+ *
+ * A backend drives one adapter, chosen when it is constructed (the default
+ * one unless told otherwise). Methods may be called from several threads;
+ * implementations serialize access to their transport internally.
+ */
+class BluetoothBackend {
+public:
+  virtual ~BluetoothBackend() = default;
+
+  /**
+   * @brief Short name for logs ("bluetoothctl", "dbus")
+   */
+  virtual std::string name() const = 0;
+
+  // Adapter
+  virtual BackendResult setPowered(bool on) = 0;
+  virtual bool isPowered() = 0;
+  virtual std::string adapterInfo() = 0;
+
+  /**
+   * @brief Every adapter on the system, not just the one in use
+   */
+  virtual std::vector<ControllerInfo> listControllers() = 0;
+
+  /**
+   * @brief Report adapter property changes as the backend notices them
+   *
+   * Call once, before other methods; the callback may run on any thread
+   * that talks to the backend.
+   * @return false if this backend cannot see changes, so a cached
+   *         adapterInfo() must not be trusted
+   */
+  virtual bool watchAdapter(AdapterCallback onChange) {
+    (void)onChange;
+    return false;
+  }
+
+  /**
+   * @brief Report device changes seen outside discovery
+   *
+   * Between startDiscovery() and stopDiscovery() events go to
+   * waitForEvents() instead. Same threading rules as watchAdapter().
+   * @return false if this backend cannot see them
+   */
+  virtual bool watchDevices(DiscoveryCallback onEvent) {
+    (void)onEvent;
+    return false;
+  }
+  virtual BackendResult startDiscovery() = 0;
+  virtual BackendResult stopDiscovery() = 0;
+
+  /**
+   * @brief Only report devices matching this address during discovery
+   *
+   * Applies to the next startDiscovery(). Callers must still check the MAC
+   * of every event, since not every backend can filter.
+   * @param address Empty clears the filter
+   * @return ok=false if the backend cannot filter
+   */
+  virtual BackendResult setDiscoveryFilter(const std::string &address) {
+    (void)address;
+    return {false, "Discovery filter not supported"};
+  }
+
+  /**
+   * @brief Deliver discovery events as they arrive
+   *
+   * Blocks until at least one event has been delivered or `timeout` has
+   * elapsed. Only meaningful between startDiscovery() and stopDiscovery().
+   *
+   * @return false if this backend cannot stream events; it then just waits
+   *         out the timeout and the caller has to poll listDevices()
+   */
+  virtual bool waitForEvents(std::chrono::milliseconds timeout,
+                             const DiscoveryCallback &onEvent) = 0;
+
+  /**
+   * @brief Known devices as (MAC, name) pairs
+   * @param pairedOnly Only return paired devices
+   */
+  virtual std::vector<std::pair<std::string, std::string>>
+  listDevices(bool pairedOnly) = 0;
+
+  /**
+   * @brief Full properties of one device
+   * @return A null MAC address if BlueZ does not know the device or the
+   *         request failed
+   */
+  virtual BluetoothDevice deviceInfo(const std::string &mac) = 0;
+
+  /**
+   * @brief Full properties of every known device in one request
+   *
+   * Replaces listDevices() followed by deviceInfo() per row. Over D-Bus
+   * that is a single GetManagedObjects call. bluetoothctl still answers one
+   * `info` at a time, but the commands are pipelined, so the turnaround of
+   * an exchange is paid once instead of once per device.
+   * @param pairedOnly Only return paired devices
+   */
+  virtual std::vector<BluetoothDevice> snapshotDevices(bool pairedOnly) = 0;
+
+  /**
+   * @brief Upper bound on concurrent per-device fetches
+   *
+   * Only matters for backends that still need one request per device
+   * (bluetoothctl without a persistent session); others ignore it.
+   */
+  virtual void setFetchParallelism(size_t jobs) { (void)jobs; }
+
+  // Device operations
+
+  /**
+   * @brief Pair with a device
+   *
+   * Pair and connect last as long as the remote device lets them; both
+   * give up with ok = false at Deadline::PAIR / Deadline::CONNECT, or as
+   * soon as `cancel` fires.
+   */
+  virtual BackendResult pair(const std::string &mac,
+                             const CancelToken &cancel = CancelToken()) = 0;
+  virtual BackendResult connect(const std::string &mac,
+                                const CancelToken &cancel = CancelToken()) = 0;
+  /** @param mac Empty disconnects every connected device */
+  virtual BackendResult disconnect(const std::string &mac) = 0;
+  virtual BackendResult remove(const std::string &mac) = 0;
+  virtual BackendResult setTrusted(const std::string &mac, bool trusted) = 0;
+  virtual BackendResult setBlocked(const std::string &mac, bool blocked) = 0;
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_BLUETOOTH_BACKEND_H
@@ -1,10 +1,18 @@
 #ifndef TOOTHDROID_BLUETOOTH_DEVICE_H
 #define TOOTHDROID_BLUETOOTH_DEVICE_H
 
+#include <algorithm>
+#include <cstdint>
 #include <ctime>
+#include <deque>
+#include <initializer_list>
 #include <string>
+#include <string_view>
+#include <unordered_map>
 #include <vector>
 
+#include "MacAddress.h"
+
 namespace ToothDroid {
 
 /**
@@ -12,7 +20,7 @@ namespace ToothDroid {
  */
 struct BluetoothDevice {
   std::string name;              // Device friendly name
-  std::string macAddress;        // MAC address (XX:XX:XX:XX:XX:XX format)
+  MacAddress macAddress;         // Device address (packed, see MacAddress)
   std::string alias;             // Custom alias set by user
   bool isPaired = false;         // Whether device is paired
   bool isConnected = false;      // Current connection status
@@ -52,7 +60,16 @@ struct BluetoothDevice {
       return alias;
     if (!name.empty())
       return name;
-    return macAddress;
+    return macAddress.toString();
+  }
+
+  // Alias or name without copying; `fallback` if the device has neither
+  std::string_view getDisplayName(std::string_view fallback) const {
+    if (!alias.empty())
+      return alias;
+    if (!name.empty())
+      return name;
+    return fallback;
   }
 
   // Get status icon
@@ -67,79 +84,269 @@ struct BluetoothDevice {
 
 /**
  * @brief In-memory device history storage
+ *
+ * Devices are indexed by address and kept on an intrusive LRU list, so
+ * add, find and evicting the least recently used entry are all O(1).
+ * Entries live in a deque, so pointers from findDevice() stay valid until
+ * that entry is evicted.
+ *
+ * The entries double as a slot map: a Handle names a slot plus the
+ * generation it was issued for, and resolves to nothing once that slot is
+ * reused. Favorites are kept as handles and are never evicted, so reading
+ * them always sees the live device without copying it.
  */
 class DeviceHistory {
 private:
-  std::vector<BluetoothDevice> knownDevices;
-  std::vector<BluetoothDevice> favoriteDevices;
-  size_t maxHistorySize = 50;
+  static constexpr uint32_t NONE = UINT32_MAX;
+
+public:
+  /**
+   * @brief Stable reference to a history entry
+   */
+  struct Handle {
+    uint32_t slot = NONE;
+    uint32_t generation = 0;
+
+    bool isNull() const { return slot == NONE; }
+    bool operator==(const Handle &other) const {
+      return slot == other.slot && generation == other.generation;
+    }
+    bool operator!=(const Handle &other) const { return !(*this == other); }
+  };
+
+private:
+  struct Entry {
+    BluetoothDevice device;
+    uint32_t prev = NONE;    // Towards most recently used
+    uint32_t next = NONE;    // Towards least recently used
+    uint32_t generation = 0; // Bumped whenever the slot is freed
+    bool favorite = false;   // Pinned: never evicted
+  };
+
+  std::deque<Entry> entries;
+  std::vector<uint32_t> freeSlots;
+  std::unordered_map<MacAddress, uint32_t> index;
+  uint32_t head = NONE; // Most recently used
+  uint32_t tail = NONE; // Least recently used
+  size_t capacity;
+  std::vector<Handle> favorites;
+
+  void unlink(uint32_t slot) {
+    Entry &e = entries[slot];
+    if (e.prev != NONE)
+      entries[e.prev].next = e.next;
+    else
+      head = e.next;
+    if (e.next != NONE)
+      entries[e.next].prev = e.prev;
+    else
+      tail = e.prev;
+    e.prev = e.next = NONE;
+  }
+
+  void pushFront(uint32_t slot) {
+    Entry &e = entries[slot];
+    e.prev = NONE;
+    e.next = head;
+    if (head != NONE)
+      entries[head].prev = slot;
+    head = slot;
+    if (tail == NONE)
+      tail = slot;
+  }
+
+  void touch(uint32_t slot) {
+    if (slot != head) {
+      unlink(slot);
+      pushFront(slot);
+    }
+  }
+
+  void release(uint32_t slot) {
+    Entry &e = entries[slot];
+    e.device = BluetoothDevice();
+    e.prev = e.next = NONE;
+    e.generation++;
+    e.favorite = false;
+    freeSlots.push_back(slot);
+  }
+
+  // Evict the least recently used non-favorite; false if all are favorites
+  bool evictOldest() {
+    uint32_t slot = tail;
+    while (slot != NONE && entries[slot].favorite)
+      slot = entries[slot].prev;
+    if (slot == NONE)
+      return false;
+    unlink(slot);
+    index.erase(entries[slot].device.macAddress);
+    release(slot);
+    return true;
+  }
 
 public:
-  // Add or update a device in history
+  static constexpr size_t DEFAULT_CAPACITY = 50;
+
+  explicit DeviceHistory(size_t maxDevices = DEFAULT_CAPACITY)
+      : capacity(maxDevices > 0 ? maxDevices : 1) {}
+
+  /**
+   * @brief Change how many devices are kept, evicting the oldest if needed
+   *
+   * Favorites are kept even when they alone exceed the capacity.
+   */
+  void setCapacity(size_t maxDevices) {
+    capacity = maxDevices > 0 ? maxDevices : 1;
+    while (index.size() > capacity && evictOldest()) {
+    }
+  }
+
+  size_t getCapacity() const { return capacity; }
+
+  // Add or update a device in history; it becomes the most recent entry
   void addDevice(const BluetoothDevice &device) {
-    for (auto &d : knownDevices) {
-      if (d.macAddress == device.macAddress) {
-        // Update existing
-        d = device;
-        return;
-      }
+    auto it = index.find(device.macAddress);
+    if (it != index.end()) {
+      entries[it->second].device = device;
+      touch(it->second);
+      return;
     }
-    // Add new
-    if (knownDevices.size() >= maxHistorySize) {
-      knownDevices.erase(knownDevices.begin());
+
+    if (index.size() >= capacity)
+      evictOldest();
+
+    uint32_t slot;
+    if (!freeSlots.empty()) {
+      slot = freeSlots.back();
+      freeSlots.pop_back();
+    } else {
+      slot = static_cast<uint32_t>(entries.size());
+      entries.emplace_back();
     }
-    knownDevices.push_back(device);
+    entries[slot].device = device;
+    index.emplace(device.macAddress, slot);
+    pushFront(slot);
   }
 
-  // Get device by MAC
-  BluetoothDevice *findDevice(const std::string &mac) {
-    for (auto &d : knownDevices) {
-      if (d.macAddress == mac)
-        return &d;
+  /**
+   * @brief Fold a fresh view of a device, e.g. from a scan, into history
+   *
+   * Live state comes from `seen`. What only history knows (lastConnected)
+   * and text fields `seen` left empty keep their stored values.
+   * @return The merged entry, now the most recent
+   */
+  const BluetoothDevice &mergeDevice(const BluetoothDevice &seen) {
+    auto it = index.find(seen.macAddress);
+    if (it == index.end()) {
+      addDevice(seen);
+      return entries[head].device;
+    }
+
+    BluetoothDevice &known = entries[it->second].device;
+    BluetoothDevice merged = seen;
+    for (auto field : {&BluetoothDevice::name, &BluetoothDevice::alias,
+                       &BluetoothDevice::icon, &BluetoothDevice::deviceClass}) {
+      if ((merged.*field).empty())
+        merged.*field = known.*field;
     }
-    return nullptr;
+    merged.lastSeen = std::max(merged.lastSeen, known.lastSeen);
+    merged.lastConnected = std::max(merged.lastConnected, known.lastConnected);
+    known = std::move(merged);
+    touch(it->second);
+    return known;
   }
 
-  // Get all known devices
-  const std::vector<BluetoothDevice> &getKnownDevices() const {
-    return knownDevices;
+  // Get device by MAC; counts as a use for eviction order
+  BluetoothDevice *findDevice(MacAddress mac) {
+    auto it = index.find(mac);
+    if (it == index.end())
+      return nullptr;
+    touch(it->second);
+    return &entries[it->second].device;
+  }
+
+  // Get device by MAC without changing eviction order
+  const BluetoothDevice *peekDevice(MacAddress mac) const {
+    auto it = index.find(mac);
+    return it != index.end() ? &entries[it->second].device : nullptr;
+  }
+
+  // Handle for a known device; null if the MAC is not in history
+  Handle handleOf(MacAddress mac) const {
+    auto it = index.find(mac);
+    if (it == index.end())
+      return Handle();
+    return Handle{it->second, entries[it->second].generation};
+  }
+
+  // Live device behind a handle; nullptr once its entry was evicted
+  const BluetoothDevice *resolve(Handle handle) const {
+    if (handle.slot >= entries.size() ||
+        entries[handle.slot].generation != handle.generation)
+      return nullptr;
+    return &entries[handle.slot].device;
+  }
+
+  // Visit known devices, most recently used first
+  template <typename Fn> void forEach(Fn fn) const {
+    for (uint32_t slot = head; slot != NONE; slot = entries[slot].next)
+      fn(entries[slot].device);
+  }
+
+  // Get all known devices, most recently used first
+  std::vector<BluetoothDevice> getKnownDevices() const {
+    std::vector<BluetoothDevice> result;
+    result.reserve(index.size());
+    forEach([&](const BluetoothDevice &d) { result.push_back(d); });
+    return result;
   }
 
   // Get paired devices only
   std::vector<BluetoothDevice> getPairedDevices() const {
     std::vector<BluetoothDevice> result;
-    for (const auto &d : knownDevices) {
+    forEach([&](const BluetoothDevice &d) {
       if (d.isPaired)
         result.push_back(d);
-    }
+    });
     return result;
   }
 
-  // Add to favorites
-  void addFavorite(const std::string &mac) {
-    auto *device = findDevice(mac);
-    if (device) {
-      for (const auto &f : favoriteDevices) {
-        if (f.macAddress == mac)
-          return; // Already favorite
-      }
-      favoriteDevices.push_back(*device);
+  // Add to favorites; null handle if the device is not in history
+  Handle addFavorite(MacAddress mac) {
+    Handle handle = handleOf(mac);
+    if (handle.isNull())
+      return handle;
+    Entry &e = entries[handle.slot];
+    if (!e.favorite) {
+      e.favorite = true;
+      favorites.push_back(handle);
     }
+    return handle;
   }
 
-  // Get favorites
-  const std::vector<BluetoothDevice> &getFavorites() const {
-    return favoriteDevices;
+  // Get favorites, in the order they were added
+  const std::vector<Handle> &getFavorites() const { return favorites; }
+
+  // Visit the live state of every favorite, in the order they were added
+  template <typename Fn> void forEachFavorite(Fn fn) const {
+    for (Handle handle : favorites) {
+      if (const BluetoothDevice *device = resolve(handle))
+        fn(handle, *device);
+    }
   }
 
-  // Clear all history
+  // Clear all history; outstanding handles stop resolving
   void clear() {
-    knownDevices.clear();
-    favoriteDevices.clear();
+    freeSlots.clear();
+    for (uint32_t slot = static_cast<uint32_t>(entries.size()); slot-- > 0;)
+      release(slot);
+    index.clear();
+    head = tail = NONE;
+    favorites.clear();
   }
 
   // Get history size
-  size_t size() const { return knownDevices.size(); }
+  size_t size() const { return index.size(); }
 };
 
 } // namespace ToothDroid
@@ -2,205 +2,671 @@
 #define TOOTHDROID_BLUETOOTH_MANAGER_H
 
 #include <algorithm>
-#include <array>
-#include <cstdio>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
 #include <functional>
 #include <memory>
-#include <regex>
-#include <sstream>
-#include <stdexcept>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "Adapter.h"
+#include "BluetoothBackend.h"
 #include "BluetoothDevice.h"
+#include "DBusBackend.h"
+#include "DeviceInfoCache.h"
+#include "DeviceJournal.h"
+#include "DeviceStore.h"
+#include "Operation.h"
+#include "ScanCoalescer.h"
+#include "SubprocessBackend.h"
+#include "TaskExecutor.h"
 #include "UI.h"
 
 namespace ToothDroid {
 
 /**
- * @brief Exception class for Bluetooth operations
+ * @brief Timing metrics for one scan
  */
-class BluetoothException : public std::runtime_error {
+struct ScanStats {
+  // Start of discovery until the first device event; -1 if none arrived
+  std::chrono::milliseconds timeToFirstDevice{-1};
+  std::chrono::milliseconds duration{0};
+  size_t devicesSeen = 0;
+  bool streamed = true; // false if the backend could not stream events
+  // Devices that advertised during the scan, as opposed to ones BlueZ
+  // merely still remembers
+  std::vector<MacAddress> heard;
+};
+
+/**
+ * @brief End of a running scan, which another thread may push out
+ *
+ * Copies share the end time, like copies of a CancelToken share its flag.
+ */
+class ScanWindow {
+private:
+  using Clock = std::chrono::steady_clock;
+  std::shared_ptr<std::atomic<Clock::rep>> end;
+
 public:
-  explicit BluetoothException(const std::string &msg)
-      : std::runtime_error(msg) {}
+  explicit ScanWindow(std::chrono::milliseconds length)
+      : end(std::make_shared<std::atomic<Clock::rep>>(
+            (Clock::now() + length).time_since_epoch().count())) {}
+
+  Clock::time_point getEnd() const {
+    return Clock::time_point(Clock::duration(end->load()));
+  }
+
+  /**
+   * @brief Scan `more` past the current end, or past now if that is later
+   */
+  void extend(std::chrono::milliseconds more) {
+    Clock::rep current = end->load();
+    Clock::rep wanted;
+    do {
+      auto from = std::max(Clock::time_point(Clock::duration(current)),
+                           Clock::now());
+      wanted = (from + more).time_since_epoch().count();
+    } while (!end->compare_exchange_weak(current, wanted));
+  }
+};
+
+/**
+ * @brief Timing metrics for one connectByAddress() call
+ */
+struct ConnectStats {
+  // Call until the target showed up in discovery; -1 if never seen
+  std::chrono::milliseconds timeToSeen{-1};
+  // Call until the connection was up; -1 if it failed
+  std::chrono::milliseconds timeToConnected{-1};
+  bool scanned = false; // false if it was already connected
+};
+
+/**
+ * @brief What a BluetoothManager sets up besides its backend
+ */
+enum class ManagerRole {
+  Primary, // Device store, journal and (over D-Bus) the pairing agent
+  Member,  // None of them; an AdapterGroup keeps results in the primary
 };
 
 /**
- * @brief Manages Bluetooth operations using bluetoothctl
+ * @brief Manages Bluetooth operations through a pluggable BlueZ backend
  *
- * Uses subprocess communication with bluetoothctl for D-Bus operations.
- * This is safer than raw system() calls as we capture and parse output.
+ * Uses the native D-Bus backend when it was compiled in and bluetoothd is
+ * reachable, otherwise falls back to scraping bluetoothctl. Set
+ * TOOTHDROID_BACKEND=bluetoothctl or =dbus to force one.
  */
 class BluetoothManager {
 private:
   DeviceHistory history;
-  std::string currentAdapter;
+  std::unique_ptr<DeviceStore> store; // Loaded before the backend starts
+  std::unique_ptr<DeviceJournal> journal; // Changes since the last checkpoint
+  std::unordered_set<MacAddress> journaled;
+  MacAddress controller; // Adapter this manager drives; null for the default
+  bool verbose = true; // Print scan progress
+  // Least time between two redraws of the scan progress in the terminal
+  std::chrono::milliseconds renderFrame = ScanCoalescer::frameFromEnvironment();
+  Adapter adapter; // Outlives the backend that updates it
+  DeviceInfoCache infoCache; // Likewise
+  std::unique_ptr<BluetoothBackend> backend;
+  ConnectStats lastConnectStats;
+  // The last scan's results, published once it ends: scanAsync() runs
+  // scans on a worker while the UI reads them
   std::vector<BluetoothDevice> discoveredDevices;
-  BluetoothDevice *selectedDevice = nullptr;
-  bool isScanning = false;
+  std::optional<BluetoothDevice> selectedDevice;
+  ScanStats lastScanStats;
+  ScanCoalescer::Stats lastRenderStats;
+  mutable std::mutex resultsMutex;
+  std::vector<ScanObserver *> observers;
+  std::mutex observerMutex;
+  // Guards history, store and journaled: device actions run on GUI workers
+  // while a scan updates the same devices
+  std::mutex historyMutex;
+  // Runs the *Async() calls; created on first use, stopped first
+  std::unique_ptr<TaskExecutor> asyncTasks;
+  std::mutex asyncMutex;
+
+  static constexpr size_t ASYNC_THREADS = 4;
+  static constexpr size_t ASYNC_QUEUE = 1024;
+  // Orders scans among themselves; no device has the broadcast address
+  static constexpr MacAddress SCAN_KEY = MacAddress(0xFFFFFFFFFFFFull);
 
   /**
-   * @brief Execute a command and capture its output
+   * @brief Prints each newly seen device as a line of scan progress
    */
-  std::string executeCommand(const std::string &cmd) const {
-    std::array<char, 128> buffer;
-    std::string result;
+  class ScanPrinter : public ScanObserver {
+    int printed = 0;
+
+  public:
+    void onDeviceAdded(const BluetoothDevice &device) override {
+      UI::clearLine();
+      UI::printDeviceEntry(++printed, device.getDisplayName(),
+                           device.macAddress.toString());
+    }
+  };
 
-    FILE *pipe = popen(cmd.c_str(), "r");
-    if (!pipe) {
-      throw BluetoothException("Failed to execute command: " + cmd);
+  /**
+   * @brief Call fn on every registered observer
+   */
+  template <typename Fn> void notifyObservers(Fn fn) {
+    std::vector<ScanObserver *> current;
+    {
+      std::lock_guard<std::mutex> lock(observerMutex);
+      current = observers;
     }
+    for (auto *o : current)
+      fn(*o);
+  }
 
-    while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-      result += buffer.data();
+  /**
+   * @brief Open the device store and load it into `into`
+   * @return nullptr if persistence is disabled or the file is unusable
+   */
+  static std::unique_ptr<DeviceStore> openStore(DeviceHistory &into) {
+    std::string path = DeviceStore::defaultPath();
+    if (path.empty())
+      return nullptr;
+    auto opened = std::make_unique<DeviceStore>(path);
+    if (!opened->isOpen())
+      return nullptr;
+    opened->setCapacity(into.getCapacity());
+    opened->load(into);
+    return opened;
+  }
+
+  /**
+   * @brief Open the journal next to the store and replay it into `into`
+   *
+   * Replayed changes are written to the store, which is synced before the
+   * journal is truncated.
+   */
+  static std::unique_ptr<DeviceJournal> openJournal(DeviceStore *store,
+                                                    DeviceHistory &into) {
+    if (!store)
+      return nullptr;
+    auto opened =
+        std::make_unique<DeviceJournal>(store->getPath() + ".journal");
+    if (!opened->isOpen())
+      return nullptr;
+
+    std::unordered_set<MacAddress> touched;
+    std::vector<DeviceJournal::Entry> replayed = opened->replay();
+    for (const auto &entry : replayed) {
+      MacAddress mac(entry.mac);
+      BluetoothDevice *device = into.findDevice(mac);
+      if (!device) {
+        BluetoothDevice added;
+        added.macAddress = mac;
+        into.addDevice(added);
+        device = into.findDevice(mac);
+      }
+      DeviceJournal::apply(entry, *device);
+      touched.insert(mac);
     }
+    if (!touched.empty() &&
+        checkpoint(*store, *opened, into, touched, replayed))
+      UI::printInfo("Recovered " + std::to_string(touched.size()) +
+                    " device(s) from the journal");
+    return opened;
+  }
 
-    int exitCode = pclose(pipe);
-    if (exitCode != 0) {
-      // Not always an error - some commands return non-zero on normal
-      // conditions
+  /**
+   * @brief Write `changed` devices to the store, then drop our own and the
+   *        `replayed` entries from the journal
+   *
+   * The journal is trimmed even when none of `changed` is in history any
+   * more, so it cannot grow without bound.
+   */
+  static bool
+  checkpoint(DeviceStore &store, DeviceJournal &journal,
+             const DeviceHistory &from,
+             const std::unordered_set<MacAddress> &changed,
+             const std::vector<DeviceJournal::Entry> &replayed = {}) {
+    std::vector<BluetoothDevice> devices;
+    for (MacAddress mac : changed) {
+      if (const BluetoothDevice *device = from.peekDevice(mac))
+        devices.push_back(*device);
     }
+    if (!devices.empty() && (!store.saveAll(devices) || !store.sync()))
+      return false;
+    journal.checkpoint(replayed);
+    return true;
+  }
 
-    return result;
+  /**
+   * @brief Devices a scan heard, filled in from history instead of a
+   *        backend round-trip
+   */
+  std::vector<BluetoothDevice>
+  heardSoFar(const std::unordered_map<MacAddress, BluetoothDevice> &seen) {
+    std::vector<BluetoothDevice> devices;
+    devices.reserve(seen.size());
+    std::lock_guard<std::mutex> lock(historyMutex);
+    for (const auto &entry : seen) {
+      const BluetoothDevice &heard = entry.second;
+      const BluetoothDevice *known = history.peekDevice(entry.first);
+      if (!known) {
+        devices.push_back(heard);
+        continue;
+      }
+      BluetoothDevice device = *known;
+      if (!heard.name.empty())
+        device.name = heard.name;
+      device.rssi = heard.rssi;
+      device.lastSeen = heard.lastSeen;
+      devices.push_back(std::move(device));
+    }
+    return devices;
   }
 
   /**
-   * @brief Execute bluetoothctl command
+   * @brief Apply a state change to the history and journal it
    */
-  std::string bluetoothctl(const std::string &args) const {
-    return executeCommand("bluetoothctl " + args + " 2>&1");
+  void record(const std::string &mac, DeviceJournal::Change change) {
+    MacAddress address = MacAddress::fromString(mac);
+    auto entry = DeviceJournal::makeEntry(address, change);
+    {
+      std::lock_guard<std::mutex> lock(historyMutex);
+      if (BluetoothDevice *device = history.findDevice(address))
+        DeviceJournal::apply(entry, *device);
+      if (journal && journal->append(entry)) {
+        journaled.insert(address);
+        if (store && journal->needsCheckpoint() &&
+            checkpoint(*store, *journal, history, journaled))
+          journaled.clear();
+      }
+    }
+    infoCache.invalidate(address, DeviceInfoCache::PAIRING |
+                                      DeviceInfoCache::CONNECTION);
   }
 
   /**
-   * @brief Parse device info from bluetoothctl output
+   * @brief Device info from the cache if `fields` are fresh, else BlueZ
+   *
+   * Failed lookups (null MAC) are not cached, so the next call asks again.
    */
-  BluetoothDevice parseDeviceInfo(const std::string &mac) const {
+  BluetoothDevice cachedInfo(const std::string &mac, unsigned fields) {
     BluetoothDevice device;
-    device.macAddress = mac;
+    if (infoCache.lookup(MacAddress::fromString(mac), fields, device))
+      return device;
+    device = backend->deviceInfo(mac);
+    if (!device.macAddress.isNull())
+      infoCache.put(device);
+    return device;
+  }
+
+  /**
+   * @brief Queue fn(token) for `device` and return its future result
+   *
+   * Operations on one device run in call order, on different devices in
+   * parallel. If too many are queued the operation fails at once.
+   */
+  template <typename T, typename Fn>
+  Operation<T> runAsync(MacAddress device, Fn fn) {
+    TaskExecutor *tasks;
+    {
+      std::lock_guard<std::mutex> lock(asyncMutex);
+      if (!asyncTasks)
+        asyncTasks = std::make_unique<TaskExecutor>(ASYNC_THREADS, ASYNC_QUEUE);
+      tasks = asyncTasks.get();
+    }
+    auto promise = std::make_shared<Promise<T>>();
+    Operation<T> operation = promise->operation();
+    auto id = tasks->submit(
+        device,
+        [promise, fn](const CancelToken &) mutable { promise->run(fn); },
+        promise->token());
+    if (id == 0) {
+      promise->setError(std::make_exception_ptr(
+          BluetoothException("Too many Bluetooth operations queued")));
+    }
+    return operation;
+  }
 
-    std::string info = bluetoothctl("info " + mac);
-    std::istringstream stream(info);
-    std::string line;
+  template <typename Fn>
+  Operation<bool> deviceAsync(const std::string &mac, Fn fn) {
+    return runAsync<bool>(MacAddress::fromString(mac), std::move(fn));
+  }
 
-    while (std::getline(stream, line)) {
-      // Trim leading whitespace
-      size_t start = line.find_first_not_of(" \t");
-      if (start == std::string::npos)
-        continue;
-      line = line.substr(start);
-
-      if (line.find("Name:") == 0) {
-        device.name = line.substr(6);
-      } else if (line.find("Alias:") == 0) {
-        device.alias = line.substr(7);
-      } else if (line.find("Paired:") == 0) {
-        device.isPaired = (line.find("yes") != std::string::npos);
-      } else if (line.find("Connected:") == 0) {
-        device.isConnected = (line.find("yes") != std::string::npos);
-      } else if (line.find("Trusted:") == 0) {
-        device.isTrusted = (line.find("yes") != std::string::npos);
-      } else if (line.find("Blocked:") == 0) {
-        device.isBlocked = (line.find("yes") != std::string::npos);
-      } else if (line.find("Icon:") == 0) {
-        device.icon = line.substr(6);
-      } else if (line.find("UUID: Audio Sink") != std::string::npos) {
-        device.supportsA2DP = true;
-      } else if (line.find("UUID: Headset") != std::string::npos) {
-        device.supportsHSP = true;
-      } else if (line.find("UUID: Handsfree") != std::string::npos) {
-        device.supportsHFP = true;
+  void watchBackend() {
+    adapter.setLive(backend->watchAdapter(
+        [this](std::string_view property, std::string_view value) {
+          adapter.apply(property, value);
+        }));
+    // Connects and pairings made elsewhere reach the cache between scans
+    backend->watchDevices(
+        [this](const DiscoveryEvent &event) { infoCache.apply(event); });
+  }
+
+  static std::unique_ptr<BluetoothBackend>
+  createBackend(MacAddress controller, ManagerRole role) {
+    const char *env = std::getenv("TOOTHDROID_BACKEND");
+    std::string choice = env ? env : "";
+
+#ifdef TOOTHDROID_HAVE_SDBUS
+    if (choice != "bluetoothctl") {
+      try {
+        return std::make_unique<DBusBackend>(controller,
+                                             role == ManagerRole::Primary);
+      } catch (const BluetoothException &) {
+        if (choice == "dbus")
+          throw;
       }
     }
+#else
+    (void)role;
+    if (choice == "dbus") {
+      throw BluetoothException("Built without D-Bus support (libsystemd)");
+    }
+#endif
 
-    device.lastSeen = std::time(nullptr);
-    return device;
+    return std::make_unique<SubprocessBackend>(true, controller);
   }
 
 public:
-  BluetoothManager() {
-    // Check if bluetoothctl is available
-    std::string version = executeCommand("bluetoothctl --version 2>&1");
-    if (version.find("bluetoothctl") == std::string::npos) {
-      throw BluetoothException("bluetoothctl not found. Please install bluez.");
+  /**
+   * @param adapter Controller to drive (see listControllers()); null for
+   *                the system default
+   * @param role    Member skips the store, journal and agent, which only
+   *                one manager per process should own
+   * @throws BluetoothException if no backend can reach BlueZ or the
+   *         adapter
+   */
+  explicit BluetoothManager(MacAddress adapter = MacAddress(),
+                            ManagerRole role = ManagerRole::Primary)
+      : store(role == ManagerRole::Primary ? openStore(history) : nullptr),
+        journal(openJournal(store.get(), history)), controller(adapter),
+        backend(createBackend(adapter, role)) {
+    watchBackend();
+  }
+
+  /**
+   * @brief Use a specific backend (e.g. one pointed at a test bus)
+   */
+  explicit BluetoothManager(std::unique_ptr<BluetoothBackend> customBackend)
+      : store(openStore(history)), journal(openJournal(store.get(), history)),
+        backend(std::move(customBackend)) {
+    if (!backend) {
+      throw BluetoothException("No Bluetooth backend given");
     }
+    watchBackend();
+  }
+
+  /**
+   * @brief Fold journaled changes into the store
+   *
+   * Skipped on a crash; the journal is replayed on the next start instead.
+   */
+  ~BluetoothManager() {
+    // Let running async operations finish; queued ones complete cancelled
+    if (asyncTasks) {
+      asyncTasks->cancelAll();
+      asyncTasks.reset();
+    }
+    if (store && journal && !journaled.empty())
+      checkpoint(*store, *journal, history, journaled);
+  }
+
+  BluetoothManager(const BluetoothManager &) = delete;
+  BluetoothManager &operator=(const BluetoothManager &) = delete;
+
+  /**
+   * @brief Name of the active backend ("dbus" or "bluetoothctl")
+   */
+  std::string getBackendName() const { return backend->name(); }
+
+  /**
+   * @brief Adapter chosen at construction; null means the system default
+   */
+  MacAddress getController() const { return controller; }
+
+  /**
+   * @brief Every adapter on the system, e.g. to build an AdapterGroup
+   */
+  std::vector<ControllerInfo> listControllers() {
+    return backend->listControllers();
   }
 
+  /**
+   * @brief Print scan progress to the terminal (on by default)
+   */
+  void setVerbose(bool value) { verbose = value; }
+
+  /**
+   * @brief Least time between two terminal redraws during a scan
+   *
+   * Devices found within one frame are printed together.
+   */
+  void setRenderFrame(std::chrono::milliseconds frame) { renderFrame = frame; }
+
+  /**
+   * @brief How the last verbose scan's terminal output was coalesced
+   */
+  ScanCoalescer::Stats getLastRenderStats() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    return lastRenderStats;
+  }
+
+  /**
+   * @brief Max concurrent device-info fetches after a scan
+   */
+  void setFetchParallelism(size_t jobs) { backend->setFetchParallelism(jobs); }
+
   /**
    * @brief Unblock Bluetooth adapter
+   *
+   * Needs no manager, so it can run while one is still being set up.
    */
-  bool unblockAdapter() {
-    std::string result = executeCommand("rfkill unblock bluetooth 2>&1");
+  static bool unblockAdapter() {
+    runProcess({"rfkill", "unblock", "bluetooth"}, Deadline::TOOL);
     return true;
   }
 
   /**
-   * @brief Power on the Bluetooth adapter
+   * @brief Power the adapter on or off, skipping the call if it already is
+   *
+   * Without change notifications the adapter state cannot be trusted, so
+   * the request is always sent.
    */
-  bool powerOn() {
-    std::string result = bluetoothctl("power on");
-    return result.find("succeeded") != std::string::npos;
+  bool setPowered(bool on) {
+    if (adapter.isLive() && getAdapterState().powered == on)
+      return true;
+    if (!backend->setPowered(on).ok)
+      return false;
+    adapter.setPowered(on);
+    return true;
   }
 
+  /**
+   * @brief Power on the Bluetooth adapter
+   */
+  bool powerOn() { return setPowered(true); }
+
   /**
    * @brief Power off the Bluetooth adapter
    */
-  bool powerOff() {
-    std::string result = bluetoothctl("power off");
-    return result.find("succeeded") != std::string::npos;
-  }
+  bool powerOff() { return setPowered(false); }
 
   /**
    * @brief Start scanning for devices
+   *
+   * Registered ScanObservers are told about devices while the scan runs.
+   * Events come from the scanning thread.
+   *
    * @param duration Scan duration in seconds
+   * @param cancel   Ends the scan early (within Deadline::CANCEL_POLL). The
+   *                 devices heard so far are returned as scan events and
+   *                 history describe them; the closing snapshot and store
+   *                 write are skipped, leaving only stopDiscovery()
    * @return Vector of discovered devices
    */
-  std::vector<BluetoothDevice> scanDevices(int duration = 10) {
-    discoveredDevices.clear();
+  std::vector<BluetoothDevice>
+  scanDevices(int duration = 10, const CancelToken &cancel = CancelToken()) {
+    return scanDevices(ScanWindow(std::chrono::seconds(duration)), cancel);
+  }
 
-    UI::printStep("Starting Bluetooth scan...");
+  /**
+   * @brief Scan until `window` ends; it may be extended while the scan runs
+   */
+  std::vector<BluetoothDevice> scanDevices(const ScanWindow &window,
+                                           const CancelToken &cancel) {
+    if (verbose)
+      UI::printStep("Starting Bluetooth scan...");
 
     // Power on adapter
     powerOn();
 
     // Start scan
-    bluetoothctl("scan on &");
-
-    // Wait for scan duration with progress
-    for (int i = 0; i < duration; i++) {
-      UI::printProgress(i + 1, duration, "Scanning");
-      std::this_thread::sleep_for(std::chrono::seconds(1));
-    }
-
-    // Stop scan
-    bluetoothctl("scan off");
-
-    // Get list of devices
-    std::string output = bluetoothctl("devices");
-    std::istringstream stream(output);
-    std::string line;
+    auto started = std::chrono::steady_clock::now();
+    ScanStats stats;
+    ScanCoalescer::Stats renderStats;
+    std::unordered_map<MacAddress, BluetoothDevice> seen;
+    // Terminal output is redrawn at most once per frame however fast
+    // events come
+    ScanPrinter printer;
+    ScanCoalescer render(printer, renderFrame);
+    backend->startDiscovery();
+
+    // Report devices the moment the backend sees them
+    auto onEvent = [&](const DiscoveryEvent &event) {
+      infoCache.apply(event);
+      auto it = seen.find(event.mac);
+
+      if (event.type == DiscoveryEvent::Type::Removed) {
+        if (it != seen.end()) {
+          seen.erase(it);
+          if (verbose)
+            render.onDeviceRemoved(event.mac);
+          notifyObservers(
+              [&](ScanObserver &o) { o.onDeviceRemoved(event.mac); });
+        }
+        return;
+      }
 
-    // Parse "Device XX:XX:XX:XX:XX:XX Name" format
-    std::regex deviceRegex(R"(Device\s+([0-9A-Fa-f:]{17})\s+(.+))");
-    std::smatch match;
+      if (it != seen.end()) {
+        // Merge whatever the event carried into what we know
+        BluetoothDevice &device = it->second;
+        bool changed = false;
+        if (!event.name.empty() && event.name != device.name) {
+          device.name = event.name;
+          changed = true;
+        }
+        if (event.rssi != 0 && event.rssi != device.rssi) {
+          device.rssi = event.rssi;
+          changed = true;
+        }
+        device.lastSeen = std::time(nullptr);
+        if (changed) {
+          if (verbose)
+            render.onDeviceUpdated(device);
+          notifyObservers([&](ScanObserver &o) { o.onDeviceUpdated(device); });
+        }
+        return;
+      }
 
-    while (std::getline(stream, line)) {
-      if (std::regex_search(line, match, deviceRegex)) {
-        std::string mac = match[1];
-        std::string name = match[2];
+      if (seen.empty()) {
+        stats.timeToFirstDevice =
+            std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - started);
+      }
 
-        BluetoothDevice device = parseDeviceInfo(mac);
-        if (device.name.empty()) {
-          device.name = name;
+      BluetoothDevice &device = seen[event.mac];
+      device.macAddress = event.mac;
+      device.name = event.name;
+      device.rssi = event.rssi;
+      device.lastSeen = std::time(nullptr);
+      stats.devicesSeen++;
+
+      if (verbose)
+        render.onDeviceAdded(device);
+      notifyObservers([&](ScanObserver &o) { o.onDeviceAdded(device); });
+    };
+
+    // Wait for the window to end with progress each second, handling
+    // events in between
+    int elapsed = 0;
+    auto now = std::chrono::steady_clock::now();
+    while (now < window.getEnd() && !cancel.isCancelled()) {
+      auto sliceEnd = std::min(window.getEnd(),
+                               started + std::chrono::seconds(elapsed + 1));
+      while (now < sliceEnd && !cancel.isCancelled()) {
+        auto remaining =
+            std::chrono::duration_cast<std::chrono::milliseconds>(sliceEnd -
+                                                                  now);
+        if (cancel.canBeCancelled())
+          remaining = std::min(remaining, Deadline::CANCEL_POLL);
+        if (verbose) {
+          // Wake up in time for devices waiting on their frame
+          render.flushIfDue();
+          auto due = render.untilDue();
+          if (due < remaining)
+            remaining = std::chrono::ceil<std::chrono::milliseconds>(due);
         }
+        if (!backend->waitForEvents(remaining, onEvent))
+          stats.streamed = false;
+        now = std::chrono::steady_clock::now();
+      }
+      if (now < started + std::chrono::seconds(elapsed + 1))
+        continue;
+      elapsed++;
+      if (verbose) {
+        render.flush();
+        auto total = std::chrono::ceil<std::chrono::seconds>(window.getEnd() -
+                                                             started);
+        UI::printProgress(elapsed, static_cast<int>(total.count()),
+                          "Scanning");
+      }
+    }
+    if (verbose) {
+      render.flush();
+      renderStats = render.getStats();
+    }
 
-        discoveredDevices.push_back(device);
-        history.addDevice(device);
+    // Stop scan
+    backend->stopDiscovery();
+    for (const auto &entry : seen)
+      stats.heard.push_back(entry.first);
+    stats.duration =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - started);
+
+    std::vector<BluetoothDevice> found;
+    if (cancel.isCancelled()) {
+      // Whoever cancelled is waiting (a stop, or shutdown); skip the
+      // snapshot and the store write
+      found = heardSoFar(seen);
+    } else {
+      // Fetch every device's full info in one request, not one per device
+      found = backend->snapshotDevices(false);
+      infoCache.putSnapshot(false, found);
+      {
+        // Merged, so a scan does not wipe lastConnected and the like
+        std::lock_guard<std::mutex> lock(historyMutex);
+        for (auto &device : found)
+          device = history.mergeDevice(device);
+        if (store)
+          store->saveAll(found);
+      }
+      for (const auto &device : found) {
+        // Observers get the full info for rows they already have
+        bool known = seen.count(device.macAddress) > 0;
+        notifyObservers([&](ScanObserver &o) {
+          if (known)
+            o.onDeviceUpdated(device);
+          else
+            o.onDeviceAdded(device);
+        });
       }
     }
 
     // Sort by signal strength / paired status
-    std::sort(discoveredDevices.begin(), discoveredDevices.end(),
+    std::sort(found.begin(), found.end(),
               [](const BluetoothDevice &a, const BluetoothDevice &b) {
                 if (a.isConnected != b.isConnected)
                   return a.isConnected;
@@ -209,10 +675,50 @@ public:
                 return a.name < b.name;
               });
 
-    UI::printSuccess("Found " + std::to_string(discoveredDevices.size()) +
+    {
+      std::lock_guard<std::mutex> lock(resultsMutex);
+      discoveredDevices = found;
+      selectedDevice.reset();
+      lastScanStats = stats;
+      if (verbose)
+        lastRenderStats = renderStats;
+    }
+
+    if (!verbose)
+      return found;
+    UI::printSuccess("Found " + std::to_string(found.size()) +
                      " device(s)");
+    if (stats.timeToFirstDevice.count() >= 0) {
+      UI::printInfo("First device after " +
+                    std::to_string(stats.timeToFirstDevice.count()) +
+                    " ms");
+    }
 
-    return discoveredDevices;
+    return found;
+  }
+
+  /**
+   * @brief Register for device events during scans (not owned)
+   */
+  void addObserver(ScanObserver *observer) {
+    std::lock_guard<std::mutex> lock(observerMutex);
+    if (std::find(observers.begin(), observers.end(), observer) ==
+        observers.end())
+      observers.push_back(observer);
+  }
+
+  void removeObserver(ScanObserver *observer) {
+    std::lock_guard<std::mutex> lock(observerMutex);
+    observers.erase(std::remove(observers.begin(), observers.end(), observer),
+                    observers.end());
+  }
+
+  /**
+   * @brief Timing of the most recent scanDevices() call
+   */
+  ScanStats getLastScanStats() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    return lastScanStats;
   }
 
   /**
@@ -220,74 +726,193 @@ public:
    */
   std::vector<BluetoothDevice> getPairedDevices() {
     std::vector<BluetoothDevice> devices;
-    std::string output = bluetoothctl("paired-devices");
-    std::istringstream stream(output);
-    std::string line;
-
-    std::regex deviceRegex(R"(Device\s+([0-9A-Fa-f:]{17})\s+(.+))");
-    std::smatch match;
-
-    while (std::getline(stream, line)) {
-      if (std::regex_search(line, match, deviceRegex)) {
-        BluetoothDevice device = parseDeviceInfo(match[1]);
-        if (device.name.empty()) {
-          device.name = match[2];
-        }
-        devices.push_back(device);
-      }
-    }
-
+    if (infoCache.lookupSnapshot(true,
+                                 DeviceInfoCache::IDENTITY |
+                                     DeviceInfoCache::PAIRING |
+                                     DeviceInfoCache::CONNECTION,
+                                 devices))
+      return devices;
+    devices = backend->snapshotDevices(true);
+    infoCache.putSnapshot(true, devices);
     return devices;
   }
 
+  /**
+   * @brief Hit/miss counters of the device info cache
+   */
+  DeviceInfoCache::Stats getInfoCacheStats() const {
+    return infoCache.getStats();
+  }
+
   /**
    * @brief Pair with a device
+   *
+   * Gives up after Deadline::PAIR, or as soon as `cancel` fires.
    */
-  bool pairDevice(const std::string &mac) {
+  bool pairDevice(const std::string &mac,
+                  const CancelToken &cancel = CancelToken()) {
     UI::printStep("Pairing with " + mac + "...");
 
-    std::string result = bluetoothctl("pair " + mac);
+    BackendResult result = backend->pair(mac, cancel);
 
-    if (result.find("Pairing successful") != std::string::npos ||
-        result.find("already paired") != std::string::npos) {
+    if (result.ok) {
       UI::printSuccess("Paired successfully!");
+      record(mac, DeviceJournal::Change::Paired);
 
       // Auto-trust for convenience
-      bluetoothctl("trust " + mac);
+      if (backend->setTrusted(mac, true).ok)
+        record(mac, DeviceJournal::Change::Trusted);
 
       return true;
     }
 
-    UI::printError("Pairing failed: " + result);
+    UI::printError("Pairing failed: " + result.message);
     return false;
   }
 
   /**
    * @brief Connect to a device
+   *
+   * Gives up after Deadline::CONNECT, or as soon as `cancel` fires.
    */
-  bool connectDevice(const std::string &mac) {
+  bool connectDevice(const std::string &mac,
+                     const CancelToken &cancel = CancelToken()) {
     UI::printStep("Connecting to " + mac + "...");
 
-    std::string result = bluetoothctl("connect " + mac);
+    BackendResult result = backend->connect(mac, cancel);
 
-    if (result.find("Connection successful") != std::string::npos ||
-        result.find("already connected") != std::string::npos) {
+    if (result.ok) {
       UI::printSuccess("Connected successfully!");
 
-      // Update device in history
-      BluetoothDevice *dev = history.findDevice(mac);
-      if (dev) {
-        dev->isConnected = true;
-        dev->lastConnected = std::time(nullptr);
+      // Update device in history, remembering it if it was never scanned
+      MacAddress address = MacAddress::fromString(mac);
+      bool known;
+      {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        known = history.findDevice(address) != nullptr;
+      }
+      // Fetched outside the lock; it may be a round-trip
+      BluetoothDevice info;
+      if (!known)
+        info = cachedInfo(mac, DeviceInfoCache::ALL_FIELDS);
+      info.macAddress = address; // Remembered even if the lookup failed
+      {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        BluetoothDevice *dev = history.findDevice(address);
+        if (!dev) {
+          history.addDevice(info);
+          dev = history.findDevice(address);
+          if (dev && store)
+            store->save(*dev);
+        }
+        if (dev)
+          dev->isConnected = true;
       }
+      record(mac, DeviceJournal::Change::Connected);
 
       return true;
     }
 
-    UI::printError("Connection failed: " + result);
+    UI::printError("Connection failed: " + result.message);
     return false;
   }
 
+  /**
+   * @brief Scan for one device and connect the moment it shows up
+   *
+   * Discovery is filtered to `mac` where the backend supports it and stops
+   * as soon as the device is seen, instead of waiting out a scan window.
+   * Pairs first if needed. Timings land in getLastConnectStats().
+   *
+   * @param timeout Seconds to look for the device before giving up
+   */
+  bool connectByAddress(const std::string &mac, int timeout = 20) {
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+    auto elapsed = [&] {
+      return std::chrono::duration_cast<std::chrono::milliseconds>(
+          Clock::now() - started);
+    };
+    lastConnectStats = ConnectStats();
+
+    MacAddress address;
+    if (!MacAddress::parse(mac, address)) {
+      UI::printError("Invalid MAC address: " + mac);
+      return false;
+    }
+    std::string target = address.toString();
+
+    BluetoothDevice known = cachedInfo(
+        target, DeviceInfoCache::PAIRING | DeviceInfoCache::CONNECTION);
+    if (known.isConnected) {
+      lastConnectStats.timeToSeen = lastConnectStats.timeToConnected =
+          elapsed();
+      UI::printSuccess("Already connected to " + known.getDisplayName());
+      return true;
+    }
+
+    UI::printStep("Looking for " + target + "...");
+    powerOn();
+    backend->setDiscoveryFilter(target);
+    backend->startDiscovery();
+    lastConnectStats.scanned = true;
+
+    // A cached device only reports an RSSI change when it is heard again
+    bool found = false;
+    auto onEvent = [&](const DiscoveryEvent &event) {
+      if (event.mac != address)
+        return;
+      if (event.type == DiscoveryEvent::Type::Added ||
+          (event.type == DiscoveryEvent::Type::Changed && event.rssi != 0))
+        found = true;
+    };
+
+    auto deadline = started + std::chrono::seconds(timeout);
+    while (!found && Clock::now() < deadline) {
+      auto slice = std::min<Clock::duration>(deadline - Clock::now(),
+                                             std::chrono::milliseconds(500));
+      if (!backend->waitForEvents(
+              std::chrono::duration_cast<std::chrono::milliseconds>(slice),
+              onEvent)) {
+        // No event stream; fall back to polling the device list
+        for (const auto &entry : backend->listDevices(false)) {
+          if (MacAddress::fromString(entry.first) == address)
+            found = true;
+        }
+      }
+    }
+
+    backend->stopDiscovery();
+    backend->setDiscoveryFilter("");
+
+    if (!found) {
+      UI::printError("Device " + target + " not found within " +
+                     std::to_string(timeout) + " s");
+      return false;
+    }
+    lastConnectStats.timeToSeen = elapsed();
+    UI::printInfo("Found after " +
+                  std::to_string(lastConnectStats.timeToSeen.count()) + " ms");
+
+    if (!known.isPaired && !pairDevice(target)) {
+      return false;
+    }
+    if (!connectDevice(target)) {
+      return false;
+    }
+
+    lastConnectStats.timeToConnected = elapsed();
+    UI::printInfo("Time to connected: " +
+                  std::to_string(lastConnectStats.timeToConnected.count()) +
+                  " ms");
+    return true;
+  }
+
+  /**
+   * @brief Timing of the most recent connectByAddress() call
+   */
+  const ConnectStats &getLastConnectStats() const { return lastConnectStats; }
+
   /**
    * @brief Disconnect from a device
    */
@@ -297,10 +922,40 @@ public:
     if (target.empty()) {
       // Disconnect all
       UI::printStep("Disconnecting all devices...");
-      bluetoothctl("disconnect");
     } else {
       UI::printStep("Disconnecting " + target + "...");
-      bluetoothctl("disconnect " + target);
+    }
+    BackendResult result = backend->disconnect(target);
+    if (!result.ok) {
+      // Some may have gone all the same; the next lookup asks BlueZ
+      if (target.empty())
+        infoCache.invalidateAll(DeviceInfoCache::CONNECTION);
+      else
+        infoCache.invalidate(MacAddress::fromString(target),
+                             DeviceInfoCache::CONNECTION);
+      UI::printError("Disconnect failed: " + result.message);
+      return false;
+    }
+
+    std::vector<std::string> disconnected;
+    if (target.empty()) {
+      infoCache.invalidateAll(DeviceInfoCache::CONNECTION);
+      std::lock_guard<std::mutex> lock(historyMutex);
+      history.forEach([&](const BluetoothDevice &device) {
+        if (device.isConnected)
+          disconnected.push_back(device.macAddress.toString());
+      });
+    } else {
+      disconnected.push_back(target);
+    }
+    for (const auto &address : disconnected) {
+      {
+        std::lock_guard<std::mutex> lock(historyMutex);
+        MacAddress key = MacAddress::fromString(address);
+        if (BluetoothDevice *dev = history.findDevice(key))
+          dev->isConnected = false;
+      }
+      record(address, DeviceJournal::Change::Disconnected);
     }
 
     UI::printSuccess("Disconnected");
@@ -313,9 +968,8 @@ public:
   bool removeDevice(const std::string &mac) {
     UI::printStep("Removing " + mac + "...");
 
-    std::string result = bluetoothctl("remove " + mac);
-
-    if (result.find("Device has been removed") != std::string::npos) {
+    if (backend->remove(mac).ok) {
+      record(mac, DeviceJournal::Change::Unpaired);
       UI::printSuccess("Device removed");
       return true;
     }
@@ -328,73 +982,226 @@ public:
    * @brief Trust a device (allows auto-connect)
    */
   bool trustDevice(const std::string &mac) {
-    std::string result = bluetoothctl("trust " + mac);
-    return result.find("succeeded") != std::string::npos ||
-           result.find("already trusted") != std::string::npos;
+    if (!backend->setTrusted(mac, true).ok)
+      return false;
+    record(mac, DeviceJournal::Change::Trusted);
+    return true;
   }
 
   /**
    * @brief Block a device
    */
   bool blockDevice(const std::string &mac) {
-    std::string result = bluetoothctl("block " + mac);
-    return result.find("succeeded") != std::string::npos;
+    if (!backend->setBlocked(mac, true).ok)
+      return false;
+    record(mac, DeviceJournal::Change::Blocked);
+    return true;
   }
 
   /**
    * @brief Unblock a device
    */
   bool unblockDevice(const std::string &mac) {
-    std::string result = bluetoothctl("unblock " + mac);
-    return result.find("succeeded") != std::string::npos;
+    if (!backend->setBlocked(mac, false).ok)
+      return false;
+    record(mac, DeviceJournal::Change::Unblocked);
+    return true;
+  }
+
+  // Asynchronous variants. Each returns at once; the work runs on a small
+  // shared pool, so hundreds can be in flight without a thread apiece.
+  // Deliver results to one thread with Operation::then(EventLoop &, ...).
+  // Operation::cancel() reaches the pair/connect/scan deadline checks.
+
+  Operation<bool> connectAsync(const std::string &mac) {
+    return deviceAsync(mac, [this, mac](const CancelToken &cancel) {
+      return connectDevice(mac, cancel);
+    });
+  }
+
+  Operation<bool> pairAsync(const std::string &mac) {
+    return deviceAsync(mac, [this, mac](const CancelToken &cancel) {
+      return pairDevice(mac, cancel);
+    });
+  }
+
+  Operation<bool> disconnectAsync(const std::string &mac) {
+    return deviceAsync(mac, [this, mac](const CancelToken &) {
+      return disconnectDevice(mac);
+    });
+  }
+
+  Operation<bool> removeAsync(const std::string &mac) {
+    return deviceAsync(
+        mac, [this, mac](const CancelToken &) { return removeDevice(mac); });
+  }
+
+  Operation<bool> trustAsync(const std::string &mac) {
+    return deviceAsync(
+        mac, [this, mac](const CancelToken &) { return trustDevice(mac); });
+  }
+
+  Operation<bool> blockAsync(const std::string &mac) {
+    return deviceAsync(
+        mac, [this, mac](const CancelToken &) { return blockDevice(mac); });
+  }
+
+  Operation<bool> unblockAsync(const std::string &mac) {
+    return deviceAsync(
+        mac, [this, mac](const CancelToken &) { return unblockDevice(mac); });
   }
 
   /**
-   * @brief Get adapter info
+   * @brief scanDevices() in the background; scans queue behind each other
    */
-  std::string getAdapterInfo() { return bluetoothctl("show"); }
+  Operation<std::vector<BluetoothDevice>> scanAsync(int duration = 10) {
+    return runAsync<std::vector<BluetoothDevice>>(
+        SCAN_KEY, [this, duration](const CancelToken &cancel) {
+          return scanDevices(duration, cancel);
+        });
+  }
+
+  /**
+   * @brief Queue depth and counters of the async pool
+   */
+  TaskExecutor::Stats getAsyncStats() {
+    std::lock_guard<std::mutex> lock(asyncMutex);
+    return asyncTasks ? asyncTasks->getStats() : TaskExecutor::Stats();
+  }
+
+  /**
+   * @brief Raw adapter info from BlueZ; also refreshes the cached state
+   */
+  std::string getAdapterInfo() {
+    std::string info = backend->adapterInfo();
+    adapter.load(info);
+    return info;
+  }
+
+  /**
+   * @brief Adapter state, read from BlueZ only if no current copy is held
+   */
+  AdapterState getAdapterState() {
+    if (!adapter.isCurrent())
+      getAdapterInfo();
+    return adapter.get();
+  }
 
   /**
    * @brief Check if Bluetooth is powered on
    */
   bool isBluetoothOn() {
-    std::string info = getAdapterInfo();
-    return info.find("Powered: yes") != std::string::npos;
+    if (!adapter.isLive())
+      return backend->isPowered();
+    return getAdapterState().powered;
   }
 
   /**
    * @brief Get discovered devices (from last scan)
    */
-  const std::vector<BluetoothDevice> &getDiscoveredDevices() const {
+  std::vector<BluetoothDevice> getDiscoveredDevices() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
     return discoveredDevices;
   }
 
+  /**
+   * @brief Show the remembered devices as the current device list
+   *
+   * Lets a connect start from the persisted history without scanning.
+   * @return false if nothing is remembered
+   */
+  bool loadKnownDevices() {
+    std::vector<BluetoothDevice> known;
+    {
+      std::lock_guard<std::mutex> lock(historyMutex);
+      known = history.getKnownDevices();
+    }
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    discoveredDevices = std::move(known);
+    selectedDevice.reset();
+    return !discoveredDevices.empty();
+  }
+
+  /**
+   * @brief Add a remembered device to favorites (persisted)
+   */
+  bool addFavorite(MacAddress mac) {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    history.addFavorite(mac);
+    const BluetoothDevice *device = history.peekDevice(mac);
+    if (!device)
+      return false;
+    if (store)
+      store->setFavorite(*device);
+    return true;
+  }
+
+  /**
+   * @brief Keep devices another manager found, as if this one had scanned
+   *        them
+   *
+   * How an AdapterGroup's member managers, which have no store, get their
+   * results saved.
+   */
+  void rememberDevices(std::vector<BluetoothDevice> devices) {
+    std::lock_guard<std::mutex> lock(historyMutex);
+    for (auto &device : devices)
+      device = history.mergeDevice(device);
+    if (store)
+      store->saveAll(devices);
+  }
+
+  /**
+   * @brief Persistent store, or nullptr if persistence is off
+   */
+  DeviceStore *getStore() { return store.get(); }
+
   /**
    * @brief Get device history
+   *
+   * Not synchronized; only read it while no device action or scan runs.
    */
   DeviceHistory &getHistory() { return history; }
 
+  /**
+   * @brief Devices saved by earlier runs, without starting a backend
+   *
+   * One read of the mapped store, cheap enough for a UI thread to show
+   * before a manager exists. Changes still only in the journal are
+   * missing until the manager replays it.
+   */
+  static std::vector<BluetoothDevice> loadRememberedDevices() {
+    DeviceHistory saved;
+    openStore(saved);
+    return saved.getKnownDevices();
+  }
+
   /**
    * @brief Select a device by index (from discovered list)
+   * @return A copy of the device, or nothing if `index` is out of range
    */
-  BluetoothDevice *selectDevice(int index) {
-    if (index >= 0 && index < static_cast<int>(discoveredDevices.size())) {
-      selectedDevice = &discoveredDevices[index];
-      return selectedDevice;
-    }
-    return nullptr;
+  std::optional<BluetoothDevice> selectDevice(int index) {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    if (index < 0 || index >= static_cast<int>(discoveredDevices.size()))
+      return std::nullopt;
+    selectedDevice = discoveredDevices[index];
+    return selectedDevice;
   }
 
   /**
    * @brief Get currently selected device
    */
-  BluetoothDevice *getSelectedDevice() { return selectedDevice; }
+  std::optional<BluetoothDevice> getSelectedDevice() const {
+    std::lock_guard<std::mutex> lock(resultsMutex);
+    return selectedDevice;
+  }
 
   /**
    * @brief Display discovered devices in a formatted list
    */
   void displayDevices() {
-    if (discoveredDevices.empty()) {
+    std::vector<BluetoothDevice> devices = getDiscoveredDevices();
+    if (devices.empty()) {
       UI::printWarning("No devices found. Try scanning first.");
       return;
     }
@@ -403,9 +1210,9 @@ public:
     UI::printInfo("Available Devices:");
     UI::printDivider();
 
-    for (size_t i = 0; i < discoveredDevices.size(); i++) {
-      const auto &d = discoveredDevices[i];
-      UI::printDeviceEntry(i + 1, d.getDisplayName(), d.macAddress,
+    for (size_t i = 0; i < devices.size(); i++) {
+      const auto &d = devices[i];
+      UI::printDeviceEntry(i + 1, d.getDisplayName(), d.macAddress.toString(),
                            d.isConnected, d.isPaired);
     }
 
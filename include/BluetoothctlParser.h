@@ -0,0 +1,277 @@
+#ifndef TOOTHDROID_BLUETOOTHCTL_PARSER_H
+#define TOOTHDROID_BLUETOOTHCTL_PARSER_H
+
+#include <cstdint>
+#include <string_view>
+
+#include "BluetoothDevice.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Tokenizers for bluetoothctl output
+ *
+ * Everything here works on std::string_view slices of the raw output and
+ * never allocates; only the fields copied into a BluetoothDevice do.
+ */
+namespace Bluetoothctl {
+
+/**
+ * @brief Walks a buffer line by line, without the trailing '\n' / '\r'
+ */
+class LineReader {
+private:
+  std::string_view rest;
+
+public:
+  explicit LineReader(std::string_view text) : rest(text) {}
+
+  bool next(std::string_view &line) {
+    if (rest.empty())
+      return false;
+    size_t end = rest.find('\n');
+    line = rest.substr(0, end);
+    rest = end == std::string_view::npos ? std::string_view()
+                                         : rest.substr(end + 1);
+    if (!line.empty() && line.back() == '\r')
+      line.remove_suffix(1);
+    return true;
+  }
+
+  /**
+   * @brief Unread part of the buffer
+   */
+  std::string_view remaining() const { return rest; }
+};
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+
+inline bool isHex(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') ||
+         (c >= 'A' && c <= 'F');
+}
+
+inline std::string_view trimLeft(std::string_view s) {
+  size_t i = 0;
+  while (i < s.size() && isSpace(s[i]))
+    i++;
+  return s.substr(i);
+}
+
+/**
+ * @brief Whether s starts with a "XX:XX:XX:XX:XX:XX" address
+ */
+inline bool startsWithMac(std::string_view s) {
+  if (s.size() < 17)
+    return false;
+  for (size_t i = 0; i < 17; i++) {
+    if (i % 3 == 2 ? s[i] != ':' : !isHex(s[i]))
+      return false;
+  }
+  return true;
+}
+
+inline bool startsWith(std::string_view s, std::string_view prefix) {
+  return s.substr(0, prefix.size()) == prefix;
+}
+
+/**
+ * @brief Find "Device <mac> <rest>" anywhere in a line
+ *
+ * Accepts what the old `Device\s+([0-9A-Fa-f:]{17})\s+(.+)` regex did, so
+ * prompt or "[NEW]" prefixes are skipped.
+ */
+inline bool parseDeviceLine(std::string_view line, std::string_view &mac,
+                            std::string_view &rest) {
+  static constexpr std::string_view keyword = "Device";
+  size_t pos = 0;
+  while ((pos = line.find(keyword, pos)) != std::string_view::npos) {
+    pos += keyword.size();
+    size_t macStart = pos;
+    while (macStart < line.size() && isSpace(line[macStart]))
+      macStart++;
+    std::string_view tail = line.substr(macStart);
+    if (macStart == pos || !startsWithMac(tail) || tail.size() < 19 ||
+        !isSpace(tail[17]))
+      continue;
+
+    std::string_view after = trimLeft(tail.substr(17));
+    if (after.empty())
+      continue;
+    mac = tail.substr(0, 17);
+    rest = after;
+    return true;
+  }
+  return false;
+}
+
+/**
+ * @brief Call fn(mac, name) for every row of `devices` output
+ */
+template <typename Fn> void forEachDevice(std::string_view output, Fn fn) {
+  LineReader reader(output);
+  std::string_view line, mac, name;
+  while (reader.next(line)) {
+    if (parseDeviceLine(line, mac, name))
+      fn(mac, name);
+  }
+}
+
+/**
+ * @brief Call fn(mac, name, isDefault) for every row of `list` output
+ *
+ * Rows look like "Controller 00:1A:7D:DA:71:13 hostname [default]".
+ */
+template <typename Fn> void forEachController(std::string_view output, Fn fn) {
+  static constexpr std::string_view header = "Controller ";
+  static constexpr std::string_view defaultTag = "[default]";
+  LineReader reader(output);
+  std::string_view line;
+  while (reader.next(line)) {
+    size_t pos = line.find(header);
+    if (pos == std::string_view::npos)
+      continue;
+    std::string_view rest = line.substr(pos + header.size());
+    if (!startsWithMac(rest))
+      continue;
+    std::string_view name = trimLeft(rest.substr(17));
+    bool isDefault = name.size() >= defaultTag.size() &&
+                     name.substr(name.size() - defaultTag.size()) == defaultTag;
+    if (isDefault)
+      name.remove_suffix(defaultTag.size());
+    while (!name.empty() && isSpace(name.back()))
+      name.remove_suffix(1);
+    fn(rest.substr(0, 17), name, isDefault);
+  }
+}
+
+/**
+ * @brief "-60", "0xffffffc4 (-60)" -> -60
+ */
+inline int16_t parseRssi(std::string_view value) {
+  size_t paren = value.find('(');
+  if (paren != std::string_view::npos)
+    value.remove_prefix(paren + 1);
+  bool negative = !value.empty() && value.front() == '-';
+  if (negative)
+    value.remove_prefix(1);
+  int result = 0;
+  for (char c : value) {
+    if (c < '0' || c > '9')
+      break;
+    result = result * 10 + (c - '0');
+  }
+  return static_cast<int16_t>(negative ? -result : result);
+}
+
+/**
+ * @brief Fill `device` from the "\tKey: value" lines of `info` output
+ *
+ * Unknown keys and header lines are ignored; string fields reuse the
+ * device's existing capacity.
+ * @return false if there was no device to describe: every reply for a
+ *         known device has a Paired line, "not available" and errors don't
+ */
+inline bool parseInfo(std::string_view info, BluetoothDevice &device) {
+  bool found = false;
+  LineReader reader(info);
+  std::string_view line;
+  while (reader.next(line)) {
+    line = trimLeft(line);
+    size_t colon = line.find(':');
+    if (colon == std::string_view::npos || colon == 0)
+      continue;
+    std::string_view key = line.substr(0, colon);
+    std::string_view value = trimLeft(line.substr(colon + 1));
+    bool yes = startsWith(value, "yes");
+
+    switch (key.front()) {
+    case 'A':
+      if (key == "Alias")
+        device.alias.assign(value.data(), value.size());
+      break;
+    case 'B':
+      if (key == "Blocked")
+        device.isBlocked = yes;
+      break;
+    case 'C':
+      if (key == "Connected")
+        device.isConnected = yes;
+      break;
+    case 'I':
+      if (key == "Icon")
+        device.icon.assign(value.data(), value.size());
+      break;
+    case 'N':
+      if (key == "Name")
+        device.name.assign(value.data(), value.size());
+      break;
+    case 'P':
+      if (key == "Paired") {
+        device.isPaired = yes;
+        found = true;
+      }
+      break;
+    case 'R':
+      if (key == "RSSI")
+        device.rssi = parseRssi(value);
+      break;
+    case 'T':
+      if (key == "Trusted")
+        device.isTrusted = yes;
+      break;
+    case 'U':
+      if (key != "UUID")
+        break;
+      if (startsWith(value, "Audio Sink"))
+        device.supportsA2DP = true;
+      else if (startsWith(value, "Headset"))
+        device.supportsHSP = true;
+      else if (startsWith(value, "Handsfree"))
+        device.supportsHFP = true;
+      break;
+    default:
+      break;
+    }
+  }
+  return found;
+}
+
+/**
+ * @brief Split pipelined `info` replies into (mac, body) blocks
+ *
+ * Each reply starts with "Device <mac> (public)" or "Device <mac> not
+ * available"; fn gets the MAC and the slice up to the next header.
+ */
+template <typename Fn> void forEachInfoBlock(std::string_view output, Fn fn) {
+  static constexpr std::string_view header = "Device ";
+  std::string_view mac;
+  size_t bodyStart = std::string_view::npos;
+  size_t pos = 0;
+
+  while (pos <= output.size()) {
+    size_t end = output.find('\n', pos);
+    if (end == std::string_view::npos)
+      end = output.size();
+    std::string_view line = output.substr(pos, end - pos);
+    bool last = end == output.size();
+
+    if (startsWith(line, header) && startsWithMac(line.substr(7))) {
+      if (bodyStart != std::string_view::npos)
+        fn(mac, output.substr(bodyStart, pos - bodyStart));
+      mac = line.substr(7, 17);
+      bodyStart = last ? output.size() : end + 1;
+    }
+    if (last)
+      break;
+    pos = end + 1;
+  }
+  if (bodyStart != std::string_view::npos)
+    fn(mac, output.substr(bodyStart));
+}
+
+} // namespace Bluetoothctl
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_BLUETOOTHCTL_PARSER_H
@@ -0,0 +1,641 @@
+#ifndef TOOTHDROID_BLUETOOTHCTL_SESSION_H
+#define TOOTHDROID_BLUETOOTHCTL_SESSION_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "Subprocess.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Path of the bluetoothctl binary
+ *
+ * Can be overridden with TOOTHDROID_BLUETOOTHCTL, which is how the
+ * benchmarks point the manager at bench/fake-bluetoothctl.sh.
+ */
+inline std::string bluetoothctlPath() {
+  const char *env = std::getenv("TOOTHDROID_BLUETOOTHCTL");
+  return (env && *env) ? env : "bluetoothctl";
+}
+
+/**
+ * @brief Long-lived interactive bluetoothctl child process
+ *
+ * Instead of forking a shell and a fresh bluetoothctl for every command, one
+ * child is kept alive and driven through a socketpair connected to its
+ * stdin/stdout/stderr. Responses are framed by the interactive prompt
+ * ("[bluetooth]# "): a command is complete once a bare prompt follows at
+ * least one line of output, or once one of the caller's completion markers
+ * shows up (needed for pair/connect, which print their result after the
+ * prompt has already been redrawn).
+ *
+ * [NEW]/[CHG]/[DEL] event lines can arrive at any time, between commands
+ * or in the middle of a reply. They are never returned as part of a reply;
+ * they are queued for readLines() and takeEvents() instead.
+ *
+ * All commands are serialized by an internal mutex, so one session can be
+ * shared between the CLI and the GUI worker threads. readLines() waits
+ * with that mutex released, so a scan does not hold up commands.
+ */
+class BluetoothctlSession {
+private:
+  static constexpr size_t MAX_QUEUED_EVENTS = 4096; // Oldest are dropped
+
+  // The child and its socket; held for the whole of a command
+  pid_t pid = -1;
+  int fd = -1;
+  std::string streamTail; // Unterminated line left over between reads
+  std::atomic<bool> alive{false};
+  std::mutex mutex;
+
+  // Never held while blocking
+  std::deque<std::string> events; // Event lines nobody has taken yet
+  int pollers = 0;                // readLines() calls polling fd unlocked
+  std::vector<int> orphans;       // Closed while polled; the last poller
+                                  // closes them, so fds are not reused
+  std::mutex eventsMutex;
+  std::condition_variable activity; // Events queued
+  int wakeFd = -1;                  // eventfd that cuts a poller short
+
+  /**
+   * @brief Remove ANSI escapes, readline markers and carriage returns
+   */
+  static std::string stripControl(const std::string &raw) {
+    std::string out;
+    out.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); i++) {
+      char c = raw[i];
+      if (c == '\033') {
+        // CSI sequence: ESC [ params... final byte in 0x40-0x7E
+        if (i + 1 < raw.size() && raw[i + 1] == '[') {
+          i += 2;
+          while (i < raw.size() && (raw[i] < 0x40 || raw[i] > 0x7E))
+            i++;
+        }
+        continue;
+      }
+      if (c == '\r' || c == '\001' || c == '\002')
+        continue;
+      out += c;
+    }
+    return out;
+  }
+
+  /**
+   * @brief Length of a leading "[name]# " / "[name]> " prompt, 0 if none
+   */
+  static size_t promptLength(const std::string &text, size_t pos) {
+    if (pos >= text.size() || text[pos] != '[')
+      return 0;
+    size_t close = text.find(']', pos);
+    if (close == std::string::npos || close + 1 >= text.size())
+      return 0;
+    char marker = text[close + 1];
+    if (marker != '#' && marker != '>')
+      return 0;
+    size_t end = close + 2;
+    if (end < text.size() && text[end] == ' ')
+      end++;
+    return end - pos;
+  }
+
+  /**
+   * @brief Asynchronous event lines that bluetoothctl interleaves with output
+   */
+  static bool isEventLine(const std::string &line) {
+    return line.rfind("[NEW]", 0) == 0 || line.rfind("[CHG]", 0) == 0 ||
+           line.rfind("[DEL]", 0) == 0;
+  }
+
+  /**
+   * @brief Split cleaned output into lines with prompts removed
+   * @return true if the output ends in a bare prompt
+   */
+  static bool splitFrame(const std::string &clean,
+                         std::vector<std::string> &lines) {
+    size_t pos = 0;
+    bool endsWithPrompt = false;
+    while (pos < clean.size()) {
+      size_t nl = clean.find('\n', pos);
+      bool lastSegment = (nl == std::string::npos);
+      size_t end = lastSegment ? clean.size() : nl;
+
+      // A line may carry several prompts when bluetoothctl redraws it
+      size_t start = pos;
+      size_t len;
+      while ((len = promptLength(clean, start)) > 0 && start + len <= end)
+        start += len;
+
+      if (start < end) {
+        lines.push_back(clean.substr(start, end - start));
+        endsWithPrompt = false;
+      } else if (lastSegment && start > pos) {
+        endsWithPrompt = true;
+      }
+      pos = lastSegment ? clean.size() : nl + 1;
+    }
+    return endsWithPrompt;
+  }
+
+  /**
+   * @brief Counts responses terminated so far in a pipelined exchange
+   *
+   * A prompt closes a response only if some non-event output came before it
+   * since the previous prompt; bare prompt redraws are ignored. Complete
+   * lines are consumed incrementally so large batches stay linear.
+   */
+  struct FrameCounter {
+    size_t frames = 0;
+    size_t scanned = 0; // Offset in raw up to which lines were consumed
+    bool content = false;
+
+    void consume(const std::string &line, size_t &count, bool &hasContent) {
+      size_t start = 0;
+      size_t len;
+      while ((len = promptLength(line, start)) > 0 && start + len <= line.size()) {
+        if (hasContent)
+          count++;
+        hasContent = false;
+        start += len;
+      }
+      if (start < line.size() && !isEventLine(line.substr(start)))
+        hasContent = true;
+    }
+
+    size_t update(const std::string &raw) {
+      size_t nl;
+      while ((nl = raw.find('\n', scanned)) != std::string::npos) {
+        consume(stripControl(raw.substr(scanned, nl - scanned)), frames,
+                content);
+        scanned = nl + 1;
+      }
+      // An unterminated tail can only add its closing prompt
+      size_t count = frames;
+      bool tailContent = content;
+      consume(stripControl(raw.substr(scanned)), count, tailContent);
+      return count;
+    }
+  };
+
+  /**
+   * @brief Read until the predicate is satisfied, the deadline passes or
+   *        `cancel` fires
+   */
+  template <typename Done>
+  bool readUntil(std::string &raw, std::chrono::steady_clock::time_point
+                                       deadline,
+                 Done done, const CancelToken &cancel = CancelToken()) {
+    std::array<char, 4096> buffer;
+    while (!done(raw)) {
+      if (cancel.isCancelled())
+        return false;
+      auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+          deadline - std::chrono::steady_clock::now());
+      if (remaining.count() <= 0)
+        return false;
+      if (cancel.canBeCancelled() && remaining > Deadline::CANCEL_POLL)
+        remaining = Deadline::CANCEL_POLL;
+
+      pollfd pfd{fd, POLLIN, 0};
+      int ready = poll(&pfd, 1, static_cast<int>(remaining.count()));
+      if (ready < 0 && errno == EINTR)
+        continue;
+      if (ready == 0)
+        continue; // Deadline and token are checked at the top
+      if (ready < 0)
+        return false;
+
+      ssize_t n = recv(fd, buffer.data(), buffer.size(), 0);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        // Child went away; the session is no longer usable
+        closeLocked();
+        return false;
+      }
+      raw.append(buffer.data(), static_cast<size_t>(n));
+    }
+    return true;
+  }
+
+  void closeLocked() {
+    alive = false;
+    if (fd >= 0) {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      if (pollers > 0) {
+        shutdown(fd, SHUT_RDWR); // Wakes them with POLLHUP
+        orphans.push_back(fd);
+      } else {
+        close(fd);
+      }
+      fd = -1;
+    }
+    if (pid > 0) {
+      int status = 0;
+      if (waitpid(pid, &status, WNOHANG) == 0)
+        terminateChild(pid, status, false);
+      pid = -1;
+    }
+  }
+
+  // Under `mutex`
+  void queueEventLocked(std::string line) {
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      if (events.size() >= MAX_QUEUED_EVENTS)
+        events.pop_front();
+      events.push_back(std::move(line));
+    }
+    activity.notify_all();
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeFd, &one, sizeof(one));
+    (void)n; // A full counter already wakes the poller
+  }
+
+  // Under eventsMutex
+  bool takeEventsLocked(std::vector<std::string> &out) {
+    if (events.empty())
+      return false;
+    out.insert(out.end(), std::make_move_iterator(events.begin()),
+               std::make_move_iterator(events.end()));
+    events.clear();
+    return true;
+  }
+
+  /**
+   * @brief Read what arrived between commands, queueing its event lines
+   *
+   * Anything else is the late reply of a command that gave up and is
+   * dropped. An unterminated last line stays in streamTail for the next
+   * reply or readLines().
+   */
+  void drainLocked() {
+    std::array<char, 4096> buffer;
+    while (fd >= 0) {
+      ssize_t n = recv(fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+      if (n > 0) {
+        streamTail.append(buffer.data(), static_cast<size_t>(n));
+        continue;
+      }
+      if (n == 0)
+        closeLocked();
+      break;
+    }
+
+    size_t lastNewline = streamTail.rfind('\n');
+    if (lastNewline == std::string::npos)
+      return;
+    std::vector<std::string> lines;
+    splitFrame(stripControl(streamTail.substr(0, lastNewline + 1)), lines);
+    streamTail.erase(0, lastNewline + 1);
+    for (auto &l : lines) {
+      if (isEventLine(l))
+        queueEventLocked(std::move(l));
+    }
+  }
+
+  /**
+   * @brief Split a reply into lines, queueing event lines and dropping the
+   *        echo of the commands that were sent
+   */
+  std::string replyLocked(const std::string &raw,
+                          const std::unordered_set<std::string> &echoes) {
+    std::vector<std::string> lines;
+    splitFrame(stripControl(raw), lines);
+
+    std::string result;
+    for (auto &l : lines) {
+      if (isEventLine(l)) {
+        queueEventLocked(std::move(l));
+        continue;
+      }
+      if (echoes.count(l))
+        continue;
+      result += l;
+      result += '\n';
+    }
+    return result;
+  }
+
+  /**
+   * @brief Each line of `input`, as bluetoothctl echoes it back
+   */
+  static std::unordered_set<std::string> echoesOf(const std::string &input) {
+    std::unordered_set<std::string> echoes;
+    size_t pos = 0;
+    while (pos < input.size()) {
+      size_t nl = input.find('\n', pos);
+      if (nl == std::string::npos)
+        nl = input.size();
+      if (nl > pos)
+        echoes.insert(input.substr(pos, nl - pos));
+      pos = nl + 1;
+    }
+    return echoes;
+  }
+
+public:
+  BluetoothctlSession() : wakeFd(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {}
+  BluetoothctlSession(const BluetoothctlSession &) = delete;
+  BluetoothctlSession &operator=(const BluetoothctlSession &) = delete;
+
+  ~BluetoothctlSession() {
+    stop();
+    if (wakeFd >= 0)
+      close(wakeFd);
+  }
+
+  /**
+   * @brief Launch bluetoothctl and wait for its first prompt
+   * @return false if the process could not be started or never prompted
+   */
+  bool start(std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pid > 0)
+      return true;
+    if (wakeFd < 0)
+      return false;
+
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0)
+      return false;
+
+    // The child's end becomes its stdin, stdout and stderr
+    pid_t child = spawnProcess({bluetoothctlPath()}, sv[1], sv[1], sv[1]);
+    close(sv[1]);
+    if (child < 0) {
+      close(sv[0]);
+      return false;
+    }
+    pid = child;
+    fd = sv[0];
+
+    std::string raw;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool ready = readUntil(raw, deadline, [](const std::string &r) {
+      std::vector<std::string> lines;
+      return splitFrame(stripControl(r), lines);
+    });
+    if (!ready) {
+      closeLocked();
+      return false;
+    }
+    alive = true;
+    return true;
+  }
+
+  /**
+   * @brief Ask bluetoothctl to exit and reap the child
+   */
+  void stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) {
+      static const char quit[] = "quit\n";
+      send(fd, quit, sizeof(quit) - 1, MSG_NOSIGNAL);
+
+      // Give it a moment to exit cleanly before closeLocked() escalates
+      for (int i = 0; i < 20 && pid > 0; i++) {
+        int status = 0;
+        if (waitpid(pid, &status, WNOHANG) == pid) {
+          pid = -1;
+          break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+      }
+    }
+    closeLocked();
+  }
+
+  /**
+   * @brief Whether the child process is alive and connected
+   */
+  bool isRunning() const { return alive; }
+
+  /**
+   * @brief Send one command and collect its response
+   * @param args Command line as typed at the bluetoothctl prompt
+   * @param markers If non-empty, wait for one of these substrings instead of
+   *                the next prompt (for commands that complete asynchronously)
+   * @param timeout Upper bound on the wait; partial output is returned on
+   *                expiry
+   * @param cancel  Stops the wait early, like an expired timeout. The
+   *                command itself keeps running in bluetoothctl; its late
+   *                output is discarded before the next command.
+   * @return Response text with prompts, escape codes, the echoed command
+   *         and event lines removed
+   */
+  std::string command(const std::string &args,
+                      const std::vector<std::string> &markers = {},
+                      std::chrono::milliseconds timeout = Deadline::QUERY,
+                      const CancelToken &cancel = CancelToken()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0)
+      return "";
+
+    // Anything buffered now belongs to earlier commands and events
+    drainLocked();
+    if (fd < 0)
+      return "";
+
+    std::string line = args + "\n";
+    if (send(fd, line.data(), line.size(), MSG_NOSIGNAL) !=
+        static_cast<ssize_t>(line.size())) {
+      closeLocked();
+      return "";
+    }
+
+    std::string raw = std::move(streamTail);
+    streamTail.clear();
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    readUntil(raw, deadline, [&markers, &args](const std::string &r) {
+      std::string clean = stripControl(r);
+      if (!markers.empty()) {
+        for (const auto &m : markers) {
+          if (clean.find(m) != std::string::npos)
+            return true;
+        }
+        return false;
+      }
+
+      std::vector<std::string> lines;
+      bool prompt = splitFrame(clean, lines);
+      if (!prompt)
+        return false;
+      for (const auto &l : lines) {
+        if (!isEventLine(l) && l != args)
+          return true;
+      }
+      return false;
+    }, cancel);
+
+    return replyLocked(raw, echoesOf(args));
+  }
+
+  /**
+   * @brief Pipeline several commands in a single write
+   *
+   * All commands are sent at once and the combined output is collected until
+   * every one of them has been answered. bluetoothctl still works through
+   * them one by one, so this saves the turnaround of N - 1 exchanges, not
+   * their processing time. The caller splits the output (e.g. on
+   * "Device <mac>" headers for `info`).
+   *
+   * @return Combined response text, cleaned up like command()'s
+   */
+  std::string commandBatch(const std::vector<std::string> &commands,
+                           std::chrono::milliseconds timeout =
+                               Deadline::BATCH) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0 || commands.empty())
+      return "";
+
+    drainLocked();
+    if (fd < 0)
+      return "";
+
+    std::string input;
+    for (const auto &c : commands) {
+      input += c;
+      input += '\n';
+    }
+
+    // The socket buffer is finite; write in chunks while consuming output
+    // so bluetoothctl never blocks on a full stdout pipe.
+    std::string raw = std::move(streamTail);
+    streamTail.clear();
+    size_t sent = 0;
+    FrameCounter counter;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (counter.update(raw) < commands.size()) {
+      if (std::chrono::steady_clock::now() >= deadline)
+        break;
+
+      pollfd pfd{fd, POLLIN, 0};
+      if (sent < input.size())
+        pfd.events |= POLLOUT;
+      int ready = poll(&pfd, 1, 50);
+      if (ready < 0 && errno != EINTR)
+        break;
+      if (ready <= 0)
+        continue;
+
+      if (pfd.revents & POLLOUT) {
+        ssize_t n = send(fd, input.data() + sent, input.size() - sent,
+                         MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n > 0)
+          sent += static_cast<size_t>(n);
+      }
+      if (pfd.revents & (POLLIN | POLLHUP)) {
+        std::array<char, 65536> buffer;
+        ssize_t n = recv(fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+        if (n == 0) {
+          closeLocked();
+          break;
+        }
+        if (n > 0)
+          raw.append(buffer.data(), static_cast<size_t>(n));
+      }
+    }
+
+    return replyLocked(raw, echoesOf(input));
+  }
+
+  /**
+   * @brief Collect unsolicited output lines ([NEW]/[CHG]/[DEL] events)
+   *
+   * Event lines queued while commands ran come first, without waiting.
+   * Otherwise waits up to `timeout` and returns as soon as at least one
+   * event line has arrived. The wait happens with the command mutex
+   * released: while a command runs, it reads the socket and queues the
+   * events it sees, which wakes this call.
+   *
+   * @return false if the session is not running
+   */
+  bool readLines(std::chrono::milliseconds timeout,
+                 std::vector<std::string> &out) {
+    using Clock = std::chrono::steady_clock;
+    auto deadline = Clock::now() + timeout;
+    while (true) {
+      {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        if (takeEventsLocked(out))
+          return true;
+      }
+      auto now = Clock::now();
+      if (now >= deadline)
+        return alive;
+
+      std::unique_lock<std::mutex> io(mutex, std::try_to_lock);
+      if (!io.owns_lock()) {
+        // A command owns the socket; wait for it to queue something
+        std::unique_lock<std::mutex> lock(eventsMutex);
+        auto until = std::min(deadline, now + Deadline::CANCEL_POLL);
+        activity.wait_until(lock, until, [this] { return !events.empty(); });
+        continue;
+      }
+      drainLocked();
+      int watched = fd;
+      {
+        std::lock_guard<std::mutex> lock(eventsMutex);
+        if (takeEventsLocked(out))
+          return true;
+        if (watched < 0)
+          return false;
+        pollers++;
+      }
+      io.unlock();
+
+      auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+          deadline - Clock::now());
+      std::array<pollfd, 2> fds{{{watched, POLLIN, 0}, {wakeFd, POLLIN, 0}}};
+      poll(fds.data(), fds.size(),
+           static_cast<int>(std::max<int64_t>(remaining.count(), 0)));
+      uint64_t count;
+      ssize_t n = ::read(wakeFd, &count, sizeof(count));
+      (void)n; // EAGAIN: nothing was queued
+
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      if (--pollers == 0) {
+        for (int orphan : orphans)
+          close(orphan);
+        orphans.clear();
+      }
+    }
+  }
+
+  /**
+   * @brief Event lines queued while commands ran, without reading more
+   */
+  std::vector<std::string> takeEvents() {
+    std::lock_guard<std::mutex> lock(eventsMutex);
+    std::vector<std::string> out;
+    takeEventsLocked(out);
+    return out;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_BLUETOOTHCTL_SESSION_H
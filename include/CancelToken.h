@@ -0,0 +1,66 @@
+#ifndef TOOTHDROID_CANCEL_TOKEN_H
+#define TOOTHDROID_CANCEL_TOKEN_H
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+
+namespace ToothDroid {
+
+/**
+ * @brief Longest each kind of operation may take before it is abandoned
+ *
+ * A cancelled operation returns within CANCEL_POLL, plus KILL_GRACE if a
+ * child process has to be terminated.
+ */
+namespace Deadline {
+using std::chrono::milliseconds;
+
+constexpr milliseconds QUERY{5000};      // info, show, devices, trust, ...
+constexpr milliseconds BATCH{10000};     // A pipelined batch of queries
+constexpr milliseconds DISCONNECT{10000};
+constexpr milliseconds PAIR{30000};
+constexpr milliseconds CONNECT{30000};
+constexpr milliseconds TOOL{5000};       // rfkill, pactl, --version
+constexpr milliseconds CANCEL_POLL{50};  // How often waits look at a token
+constexpr milliseconds KILL_GRACE{500};  // SIGTERM to SIGKILL
+} // namespace Deadline
+
+/**
+ * @brief Shared flag that asks a blocking operation to give up
+ *
+ * Copies share the flag. A default-constructed token can never be
+ * cancelled, so passing one costs nothing.
+ */
+class CancelToken {
+private:
+  std::shared_ptr<std::atomic<bool>> flag;
+
+public:
+  CancelToken() = default;
+
+  /**
+   * @brief A token that cancel() can trigger
+   */
+  static CancelToken create() {
+    CancelToken token;
+    token.flag = std::make_shared<std::atomic<bool>>(false);
+    return token;
+  }
+
+  void cancel() const {
+    if (flag)
+      flag->store(true);
+  }
+
+  bool isCancelled() const { return flag && flag->load(); }
+
+  /**
+   * @brief Whether anyone could ever cancel this token
+   */
+  bool canBeCancelled() const { return flag != nullptr; }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_CANCEL_TOKEN_H
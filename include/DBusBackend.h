@@ -0,0 +1,1145 @@
+#ifndef TOOTHDROID_DBUS_BACKEND_H
+#define TOOTHDROID_DBUS_BACKEND_H
+
+#ifdef TOOTHDROID_HAVE_SDBUS
+
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <initializer_list>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <systemd/sd-bus.h>
+
+#include "BluetoothBackend.h"
+
+namespace ToothDroid {
+
+namespace DBus {
+
+constexpr const char *SERVICE = "org.bluez";
+constexpr const char *ADAPTER_IFACE = "org.bluez.Adapter1";
+constexpr const char *DEVICE_IFACE = "org.bluez.Device1";
+constexpr const char *OBJECT_MANAGER_IFACE =
+    "org.freedesktop.DBus.ObjectManager";
+constexpr const char *PROPERTIES_IFACE = "org.freedesktop.DBus.Properties";
+constexpr const char *AGENT_MANAGER_IFACE = "org.bluez.AgentManager1";
+constexpr const char *AGENT_IFACE = "org.bluez.Agent1";
+constexpr const char *AGENT_PATH = "/org/toothdroid/agent";
+
+/**
+ * @brief Owning handle for an sd_bus_message
+ */
+class Message {
+private:
+  sd_bus_message *msg = nullptr;
+
+public:
+  Message() = default;
+  Message(const Message &) = delete;
+  Message &operator=(const Message &) = delete;
+  ~Message() { sd_bus_message_unref(msg); }
+
+  sd_bus_message **out() { return &msg; }
+  sd_bus_message *get() const { return msg; }
+};
+
+/**
+ * @brief Owning handle for an sd_bus_error
+ */
+class Error {
+private:
+  sd_bus_error err = {nullptr, nullptr, 0}; // SD_BUS_ERROR_NULL
+
+public:
+  Error() = default;
+  Error(const Error &) = delete;
+  Error &operator=(const Error &) = delete;
+  ~Error() { sd_bus_error_free(&err); }
+
+  sd_bus_error *get() { return &err; }
+  bool is(const char *name) const { return sd_bus_error_has_name(&err, name); }
+
+  std::string text(int r) const {
+    if (err.message)
+      return err.message;
+    if (err.name)
+      return err.name;
+    return std::string("D-Bus error: ") + std::strerror(-r);
+  }
+};
+
+/**
+ * @brief "AA:BB:..." -> "<adapter>/dev_AA_BB_..."
+ */
+inline std::string devicePath(const std::string &adapterPath,
+                              const std::string &mac) {
+  std::string path = adapterPath + "/dev_" + mac;
+  for (size_t i = adapterPath.size() + 5; i < path.size(); i++) {
+    if (path[i] == ':')
+      path[i] = '_';
+  }
+  return path;
+}
+
+/**
+ * @brief "<adapter>/dev_AA_BB_..." -> "AA:BB:..."
+ */
+inline MacAddress macFromPath(const char *path) {
+  const char *dev = std::strstr(path, "/dev_");
+  if (!dev)
+    return MacAddress();
+  std::string mac = dev + 5;
+  for (char &c : mac) {
+    if (c == '_')
+      c = ':';
+  }
+  return MacAddress::fromString(mac);
+}
+
+/**
+ * @brief Read a variant holding a basic type, skipping mismatched types
+ */
+template <typename T>
+bool readVariant(sd_bus_message *m, char type, T *value) {
+  char sig[2] = {type, '\0'};
+  if (sd_bus_message_enter_container(m, 'v', sig) <= 0) {
+    sd_bus_message_skip(m, "v");
+    return false;
+  }
+  int r = sd_bus_message_read_basic(m, type, value);
+  sd_bus_message_exit_container(m);
+  return r > 0;
+}
+
+inline bool readStringVariant(sd_bus_message *m, std::string &out) {
+  const char *value = nullptr;
+  if (!readVariant(m, 's', &value) || !value)
+    return false;
+  out = value;
+  return true;
+}
+
+inline bool readBoolVariant(sd_bus_message *m, bool &out) {
+  int value = 0;
+  if (!readVariant(m, 'b', &value))
+    return false;
+  out = value != 0;
+  return true;
+}
+
+/**
+ * @brief Fill a BluetoothDevice from an org.bluez.Device1 a{sv} dictionary
+ *
+ * The message must be positioned at the start of the array; it is consumed.
+ * If `event` is given, the Connected and Paired values found are also set
+ * there, so a change can tell them from defaults.
+ */
+inline int readDeviceProperties(sd_bus_message *m, BluetoothDevice &device,
+                                DiscoveryEvent *event = nullptr) {
+  int r = sd_bus_message_enter_container(m, 'a', "{sv}");
+  if (r < 0)
+    return r;
+
+  while ((r = sd_bus_message_enter_container(m, 'e', "sv")) > 0) {
+    const char *key = nullptr;
+    r = sd_bus_message_read_basic(m, 's', &key);
+    if (r < 0)
+      return r;
+
+    if (std::strcmp(key, "Address") == 0) {
+      std::string address;
+      readStringVariant(m, address);
+      device.macAddress = MacAddress::fromString(address);
+    } else if (std::strcmp(key, "Name") == 0) {
+      readStringVariant(m, device.name);
+    } else if (std::strcmp(key, "Alias") == 0) {
+      readStringVariant(m, device.alias);
+    } else if (std::strcmp(key, "Icon") == 0) {
+      readStringVariant(m, device.icon);
+    } else if (std::strcmp(key, "Paired") == 0) {
+      if (readBoolVariant(m, device.isPaired) && event)
+        event->paired = device.isPaired;
+    } else if (std::strcmp(key, "Connected") == 0) {
+      if (readBoolVariant(m, device.isConnected) && event)
+        event->connected = device.isConnected;
+    } else if (std::strcmp(key, "Trusted") == 0) {
+      readBoolVariant(m, device.isTrusted);
+    } else if (std::strcmp(key, "Blocked") == 0) {
+      readBoolVariant(m, device.isBlocked);
+    } else if (std::strcmp(key, "RSSI") == 0) {
+      readVariant(m, 'n', &device.rssi);
+    } else if (std::strcmp(key, "UUIDs") == 0 &&
+               sd_bus_message_enter_container(m, 'v', "as") > 0) {
+      char **uuids = nullptr;
+      if (sd_bus_message_read_strv(m, &uuids) >= 0 && uuids) {
+        for (char **u = uuids; *u; u++) {
+          // 16-bit service class IDs in the Bluetooth base UUID
+          if (std::strncmp(*u, "0000110b", 8) == 0)
+            device.supportsA2DP = true;
+          else if (std::strncmp(*u, "00001108", 8) == 0)
+            device.supportsHSP = true;
+          else if (std::strncmp(*u, "0000111e", 8) == 0)
+            device.supportsHFP = true;
+          std::free(*u);
+        }
+        std::free(uuids);
+      }
+      sd_bus_message_exit_container(m);
+    } else {
+      sd_bus_message_skip(m, "v");
+    }
+
+    sd_bus_message_exit_container(m);
+  }
+  if (r < 0)
+    return r;
+
+  return sd_bus_message_exit_container(m);
+}
+
+/**
+ * @brief Flatten an a{sv} dictionary of strings/bools into text values
+ */
+inline std::map<std::string, std::string> readTextProperties(sd_bus_message *m) {
+  std::map<std::string, std::string> props;
+  if (sd_bus_message_enter_container(m, 'a', "{sv}") <= 0)
+    return props;
+
+  while (sd_bus_message_enter_container(m, 'e', "sv") > 0) {
+    const char *key = nullptr;
+    sd_bus_message_read_basic(m, 's', &key);
+
+    char type = 0;
+    const char *contents = nullptr;
+    sd_bus_message_peek_type(m, &type, &contents);
+
+    std::string value;
+    bool flag = false;
+    if (contents && std::strcmp(contents, "s") == 0 &&
+        readStringVariant(m, value)) {
+      props[key] = value;
+    } else if (contents && std::strcmp(contents, "b") == 0 &&
+               readBoolVariant(m, flag)) {
+      props[key] = flag ? "yes" : "no";
+    } else {
+      sd_bus_message_skip(m, "v");
+    }
+    sd_bus_message_exit_container(m);
+  }
+  sd_bus_message_exit_container(m);
+  return props;
+}
+
+/**
+ * @brief Walk an ObjectManager.GetManagedObjects reply
+ *
+ * Calls fn(path, interface, m) with m positioned at that interface's a{sv}
+ * properties. fn returns true if it consumed them, false to have them
+ * skipped.
+ */
+template <typename Fn> int walkManagedObjects(sd_bus_message *m, Fn fn) {
+  int r = sd_bus_message_enter_container(m, 'a', "{oa{sa{sv}}}");
+  if (r < 0)
+    return r;
+
+  while ((r = sd_bus_message_enter_container(m, 'e', "oa{sa{sv}}")) > 0) {
+    const char *path = nullptr;
+    sd_bus_message_read_basic(m, 'o', &path);
+
+    sd_bus_message_enter_container(m, 'a', "{sa{sv}}");
+    while (sd_bus_message_enter_container(m, 'e', "sa{sv}") > 0) {
+      const char *iface = nullptr;
+      sd_bus_message_read_basic(m, 's', &iface);
+      if (!fn(path, iface, m))
+        sd_bus_message_skip(m, "a{sv}");
+      sd_bus_message_exit_container(m);
+    }
+    sd_bus_message_exit_container(m);
+    sd_bus_message_exit_container(m);
+  }
+  if (r < 0)
+    return r;
+
+  return sd_bus_message_exit_container(m);
+}
+
+} // namespace DBus
+
+/**
+ * @brief Native BlueZ backend talking to org.bluez over sd-bus
+ *
+ * Every operation is a single D-Bus round-trip to bluetoothd instead of a
+ * process spawn plus text parsing. Uses the system bus by default; set
+ * TOOTHDROID_DBUS_BUS=session to talk to a fake org.bluez on the session bus
+ * instead, as tests/run-dbus-test.sh does.
+ *
+ * sd-bus is not thread-safe, so `mutex` guards the connection. It is held
+ * for quick property calls and for sd_bus_process(), never while waiting:
+ * one thread at a time polls the bus fd with the lock released and the
+ * others sleep on `activity` until it has dispatched something.
+ *
+ * Registers a pairing agent, so pair() works without another agent
+ * running. It confirms requests only for the device pair() is pairing.
+ */
+class DBusBackend : public BluetoothBackend {
+private:
+  sd_bus *bus = nullptr;
+  std::string adapterPath;
+  std::mutex mutex;
+
+  // Waiting for the bus, under `mutex`
+  std::condition_variable activity; // Something was dispatched
+  uint64_t generation = 0;          // Bumped on every dispatch
+  bool polling = false;             // A thread is in poll() on the bus fd
+  bool broken = false;              // The connection failed
+  int wakeFd = -1;                  // eventfd that cuts that poll() short
+
+  // Agent1 object, the devices pair() calls are pairing (with how many
+  // calls each) and the PIN for legacy pairing, under `mutex`
+  sd_bus_slot *agentSlot = nullptr;
+  std::map<std::string, int> pairing;
+  std::string pinCode;
+
+  // Discovery signal subscriptions, live between start/stopDiscovery
+  sd_bus_slot *addedSlot = nullptr;
+  sd_bus_slot *changedSlot = nullptr;
+  sd_bus_slot *removedSlot = nullptr;
+  std::vector<DiscoveryEvent> pendingEvents;
+
+  // Adapter1 PropertiesChanged, live from watchAdapter() on
+  sd_bus_slot *adapterSlot = nullptr;
+  AdapterCallback adapterListener;
+
+  // Device1 PropertiesChanged, live from watchDevices() on
+  sd_bus_slot *deviceSlot = nullptr;
+  DiscoveryCallback deviceListener;
+
+  bool ownsPath(const char *path) const {
+    return path &&
+           std::strncmp(path, adapterPath.c_str(), adapterPath.size()) == 0 &&
+           path[adapterPath.size()] == '/';
+  }
+
+  /**
+   * @brief ObjectManager.InterfacesAdded(o path, a{sa{sv}} interfaces)
+   */
+  static int onInterfacesAdded(sd_bus_message *m, void *userdata,
+                               sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    const char *path = nullptr;
+    if (sd_bus_message_read_basic(m, 'o', &path) < 0 || !self->ownsPath(path))
+      return 0;
+
+    if (sd_bus_message_enter_container(m, 'a', "{sa{sv}}") < 0)
+      return 0;
+    while (sd_bus_message_enter_container(m, 'e', "sa{sv}") > 0) {
+      const char *iface = nullptr;
+      sd_bus_message_read_basic(m, 's', &iface);
+      if (std::strcmp(iface, DBus::DEVICE_IFACE) == 0) {
+        DiscoveryEvent event{DiscoveryEvent::Type::Added,
+                             DBus::macFromPath(path)};
+        BluetoothDevice device;
+        DBus::readDeviceProperties(m, device, &event);
+        event.name = device.name;
+        event.rssi = device.rssi;
+        self->pendingEvents.push_back(std::move(event));
+      } else {
+        sd_bus_message_skip(m, "a{sv}");
+      }
+      sd_bus_message_exit_container(m);
+    }
+    sd_bus_message_exit_container(m);
+    return 0;
+  }
+
+  /**
+   * @brief Read Properties.PropertiesChanged(s iface, a{sv} changed,
+   *        as invalid) on one of our devices
+   */
+  bool readDeviceChange(sd_bus_message *m, DiscoveryEvent &event) const {
+    const char *path = sd_bus_message_get_path(m);
+    const char *iface = nullptr;
+    if (!ownsPath(path) || sd_bus_message_read_basic(m, 's', &iface) < 0 ||
+        std::strcmp(iface, DBus::DEVICE_IFACE) != 0)
+      return false;
+
+    event = {DiscoveryEvent::Type::Changed, DBus::macFromPath(path)};
+    BluetoothDevice changed;
+    DBus::readDeviceProperties(m, changed, &event);
+    event.name = changed.name;
+    event.rssi = changed.rssi;
+    return true;
+  }
+
+  static int onPropertiesChanged(sd_bus_message *m, void *userdata,
+                                 sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    DiscoveryEvent event;
+    if (self->readDeviceChange(m, event))
+      self->pendingEvents.push_back(std::move(event));
+    return 0;
+  }
+
+  /**
+   * @brief Device changes for watchDevices(); onPropertiesChanged() gets
+   *        them instead while discovering
+   */
+  static int onDeviceWatch(sd_bus_message *m, void *userdata,
+                           sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    DiscoveryEvent event;
+    if (!self->changedSlot && self->deviceListener &&
+        self->readDeviceChange(m, event))
+      self->deviceListener(event);
+    return 0;
+  }
+
+  /**
+   * @brief Properties.PropertiesChanged on our adapter
+   */
+  static int onAdapterChanged(sd_bus_message *m, void *userdata,
+                              sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    const char *iface = nullptr;
+    if (sd_bus_message_read_basic(m, 's', &iface) < 0 ||
+        std::strcmp(iface, DBus::ADAPTER_IFACE) != 0 || !self->adapterListener)
+      return 0;
+    for (const auto &prop : DBus::readTextProperties(m))
+      self->adapterListener(prop.first, prop.second);
+    return 0;
+  }
+
+  /**
+   * @brief Run handlers for whatever has been read off the bus, and tell
+   *        waiting threads about it
+   */
+  void dispatchLocked() {
+    int r;
+    bool any = false;
+    while ((r = sd_bus_process(bus, nullptr)) > 0)
+      any = true;
+    if (r < 0)
+      broken = true;
+    if (any || r < 0) {
+      generation++;
+      activity.notify_all();
+      wakePollerLocked();
+    }
+  }
+
+  /**
+   * @brief Make the polling thread look at the bus again, e.g. because a
+   *        call made meanwhile read its reply off the socket
+   */
+  void wakePollerLocked() {
+    if (!polling)
+      return;
+    uint64_t one = 1;
+    ssize_t n = ::write(wakeFd, &one, sizeof(one));
+    (void)n;
+  }
+
+  /**
+   * @brief Holds `mutex` for a quick call, dispatching what arrived before
+   *        and alongside it
+   */
+  class BusLock {
+  private:
+    DBusBackend &backend;
+    std::lock_guard<std::mutex> lock;
+
+  public:
+    explicit BusLock(DBusBackend &backend)
+        : backend(backend), lock(backend.mutex) {
+      backend.dispatchLocked();
+    }
+    ~BusLock() {
+      backend.dispatchLocked();
+      backend.wakePollerLocked();
+    }
+  };
+
+  /**
+   * @brief poll() the bus fd for at most `slice` with `mutex` released
+   */
+  void pollBusLocked(std::unique_lock<std::mutex> &lock,
+                     std::chrono::steady_clock::duration slice) {
+    int fd = sd_bus_get_fd(bus);
+    int events = sd_bus_get_events(bus);
+    if (fd < 0 || events < 0) {
+      broken = true;
+      return;
+    }
+
+    int timeoutMs = static_cast<int>(
+        std::chrono::ceil<std::chrono::milliseconds>(slice).count());
+    uint64_t until = 0;
+    if (sd_bus_get_timeout(bus, &until) >= 0 && until != UINT64_MAX) {
+      // Absolute CLOCK_MONOTONIC microseconds; 0 means process right away
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      uint64_t now = static_cast<uint64_t>(ts.tv_sec) * 1000000 +
+                     static_cast<uint64_t>(ts.tv_nsec) / 1000;
+      uint64_t busMs = until > now ? (until - now + 999) / 1000 : 0;
+      timeoutMs = static_cast<int>(
+          std::min<uint64_t>(static_cast<uint64_t>(timeoutMs), busMs));
+    }
+
+    polling = true;
+    lock.unlock();
+    struct pollfd fds[2] = {{fd, static_cast<short>(events), 0},
+                            {wakeFd, POLLIN, 0}};
+    ::poll(fds, 2, timeoutMs);
+    if (fds[1].revents & POLLIN) {
+      uint64_t count;
+      ssize_t n = ::read(wakeFd, &count, sizeof(count));
+      (void)n;
+    }
+    lock.lock();
+    polling = false;
+    activity.notify_all();
+  }
+
+  /**
+   * @brief Process the bus until `done()` holds, `deadline` passes or
+   *        `cancel` fires
+   *
+   * The first thread in polls the bus; the rest wait for it to dispatch
+   * and take over when it leaves.
+   */
+  template <typename Done>
+  bool waitLocked(std::unique_lock<std::mutex> &lock,
+                  std::chrono::steady_clock::time_point deadline,
+                  const CancelToken &cancel, Done done) {
+    while (true) {
+      dispatchLocked();
+      if (done())
+        return true;
+      auto now = std::chrono::steady_clock::now();
+      if (broken || cancel.isCancelled() || now >= deadline)
+        return false;
+
+      auto slice = std::min<std::chrono::steady_clock::duration>(
+          deadline - now, Deadline::CANCEL_POLL);
+      if (polling) {
+        uint64_t seen = generation;
+        activity.wait_for(lock, slice, [&] {
+          return generation != seen || !polling;
+        });
+      } else {
+        pollBusLocked(lock, slice);
+      }
+    }
+  }
+
+  /**
+   * @brief ObjectManager.InterfacesRemoved(o path, as interfaces)
+   */
+  static int onInterfacesRemoved(sd_bus_message *m, void *userdata,
+                                 sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    const char *path = nullptr;
+    if (sd_bus_message_read_basic(m, 'o', &path) < 0 || !self->ownsPath(path))
+      return 0;
+
+    char **ifaces = nullptr;
+    bool wasDevice = false;
+    if (sd_bus_message_read_strv(m, &ifaces) >= 0 && ifaces) {
+      for (char **i = ifaces; *i; i++) {
+        wasDevice |= std::strcmp(*i, DBus::DEVICE_IFACE) == 0;
+        std::free(*i);
+      }
+      std::free(ifaces);
+    }
+    if (wasDevice) {
+      self->pendingEvents.push_back(
+          {DiscoveryEvent::Type::Removed, DBus::macFromPath(path), "", 0});
+    }
+    return 0;
+  }
+
+  /**
+   * @brief org.bluez.Agent1, called by bluetoothd while pairing
+   *
+   * There is nobody to ask, so requests about devices pair() is pairing
+   * are confirmed and everything else is rejected. A PIN is only sent if
+   * one was set with setPinCode(); passkey entry cannot be answered.
+   */
+  static int onAgentCall(sd_bus_message *m, void *userdata, sd_bus_error *) {
+    auto *self = static_cast<DBusBackend *>(userdata);
+    auto is = [m](const char *method) {
+      return sd_bus_message_is_method_call(m, DBus::AGENT_IFACE, method) > 0;
+    };
+    auto handled = [](int r) { return r < 0 ? r : 1; };
+    if (sd_bus_message_is_method_call(m, DBus::AGENT_IFACE, nullptr) <= 0)
+      return 0; // Let sd-bus answer Introspect and the like
+
+    if (is("Release") || is("Cancel") || is("DisplayPasskey") ||
+        is("DisplayPinCode"))
+      return handled(sd_bus_reply_method_return(m, ""));
+
+    const char *device = nullptr;
+    sd_bus_message_read_basic(m, 'o', &device);
+    if (!device || self->pairing.count(device) == 0) {
+      return handled(sd_bus_reply_method_errorf(
+          m, "org.bluez.Error.Rejected", "Not pairing %s",
+          device ? device : "this device"));
+    }
+
+    if (is("RequestConfirmation") || is("RequestAuthorization") ||
+        is("AuthorizeService"))
+      return handled(sd_bus_reply_method_return(m, ""));
+    if (is("RequestPinCode") && !self->pinCode.empty())
+      return handled(
+          sd_bus_reply_method_return(m, "s", self->pinCode.c_str()));
+    return handled(sd_bus_reply_method_errorf(
+        m, "org.bluez.Error.Rejected", "No PIN or passkey to enter"));
+  }
+
+  /**
+   * @brief Export the agent and register it with BlueZ
+   *
+   * Best effort: pairing still works without it when another agent runs
+   * or the device needs no confirmation.
+   */
+  void registerAgent() {
+    if (sd_bus_add_object(bus, &agentSlot, DBus::AGENT_PATH,
+                          &DBusBackend::onAgentCall, this) < 0)
+      return;
+    DBus::Error error;
+    DBus::Message reply;
+    sd_bus_call_method(bus, DBus::SERVICE, "/org/bluez",
+                       DBus::AGENT_MANAGER_IFACE, "RegisterAgent", error.get(),
+                       reply.out(), "os", DBus::AGENT_PATH, "DisplayYesNo");
+  }
+
+  std::string deviceChangesRule() const {
+    return "type='signal',sender='org.bluez',"
+           "interface='org.freedesktop.DBus.Properties',"
+           "member='PropertiesChanged',"
+           "arg0='org.bluez.Device1',path_namespace='" +
+           adapterPath + "'";
+  }
+
+  void unsubscribeLocked() {
+    addedSlot = sd_bus_slot_unref(addedSlot);
+    changedSlot = sd_bus_slot_unref(changedSlot);
+    removedSlot = sd_bus_slot_unref(removedSlot);
+    pendingEvents.clear();
+  }
+
+  std::string devicePath(const std::string &mac) const {
+    return DBus::devicePath(adapterPath, mac);
+  }
+
+  /**
+   * @brief Reply slot for callWithin()
+   */
+  struct PendingCall {
+    bool done = false;
+    bool failed = false;
+    std::string errorName;
+    std::string errorText;
+  };
+
+  static int onReply(sd_bus_message *m, void *userdata, sd_bus_error *) {
+    auto *pending = static_cast<PendingCall *>(userdata);
+    if (const sd_bus_error *e = sd_bus_message_get_error(m)) {
+      pending->failed = true;
+      pending->errorName = e->name ? e->name : "";
+      pending->errorText = e->message ? e->message : pending->errorName;
+    }
+    pending->done = true;
+    return 0;
+  }
+
+  /**
+   * @brief Call a method that may take a while, bounded by `timeout` and
+   *        `cancel`
+   *
+   * The call is sent asynchronously and the reply awaited through
+   * waitLocked(), so scans and other calls go on meanwhile. On expiry the
+   * reply slot is dropped; BlueZ may still finish the operation.
+   *
+   * @param gaveUp    Set if the call timed out or was cancelled
+   * @param objectArg Object path argument, for methods that take one
+   */
+  BackendResult callWithin(const std::string &path, const char *iface,
+                           const char *method,
+                           std::chrono::milliseconds timeout,
+                           const CancelToken &cancel,
+                           std::initializer_list<const char *> okErrors,
+                           bool &gaveUp, const char *objectArg = nullptr) {
+    gaveUp = false;
+    PendingCall pending;
+    sd_bus_slot *slot = nullptr;
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    dispatchLocked();
+    int r = sd_bus_call_method_async(bus, &slot, DBus::SERVICE, path.c_str(),
+                                     iface, method, onReply, &pending,
+                                     objectArg ? "o" : "", objectArg);
+    if (r < 0)
+      return {false, std::string("D-Bus error: ") + std::strerror(-r)};
+
+    bool answered =
+        waitLocked(lock, deadline, cancel, [&] { return pending.done; });
+    sd_bus_slot_unref(slot);
+    if (!answered) {
+      gaveUp = true;
+      if (cancel.isCancelled())
+        return {false, "Cancelled"};
+      return {false, broken ? "D-Bus connection lost" : "Timed out"};
+    }
+
+    if (!pending.failed)
+      return {true, ""};
+    for (const char *name : okErrors) {
+      if (pending.errorName == name)
+        return {true, pending.errorText};
+    }
+    return {false, pending.errorText};
+  }
+
+  BackendResult call(const std::string &path, const char *iface,
+                     const char *method,
+                     std::initializer_list<const char *> okErrors = {},
+                     std::chrono::milliseconds timeout = Deadline::QUERY) {
+    bool gaveUp;
+    return callWithin(path, iface, method, timeout, CancelToken(), okErrors,
+                      gaveUp);
+  }
+
+  BackendResult setBool(const std::string &path, const char *iface,
+                        const char *property, bool value) {
+    BusLock lock(*this);
+    DBus::Error error;
+    int r = sd_bus_set_property(bus, DBus::SERVICE, path.c_str(), iface,
+                                property, error.get(), "b", value ? 1 : 0);
+    return {r >= 0, r >= 0 ? "" : error.text(r)};
+  }
+
+  /**
+   * @brief Fetch every org.bluez object in one GetManagedObjects call
+   */
+  int managedObjects(DBus::Message &reply, DBus::Error &error) {
+    return sd_bus_call_method(bus, DBus::SERVICE, "/",
+                              DBus::OBJECT_MANAGER_IFACE, "GetManagedObjects",
+                              error.get(), reply.out(), "");
+  }
+
+  /**
+   * @brief Devices that belong to our adapter
+   */
+  std::vector<BluetoothDevice> devicesLocked() {
+    std::vector<BluetoothDevice> devices;
+    DBus::Error error;
+    DBus::Message reply;
+    if (managedObjects(reply, error) < 0)
+      return devices;
+
+    std::string prefix = adapterPath + "/";
+    std::time_t now = std::time(nullptr);
+    DBus::walkManagedObjects(
+        reply.get(), [&](const char *path, const char *iface,
+                         sd_bus_message *m) {
+          if (std::strcmp(iface, DBus::DEVICE_IFACE) != 0 ||
+              std::strncmp(path, prefix.c_str(), prefix.size()) != 0)
+            return false;
+          BluetoothDevice device;
+          DBus::readDeviceProperties(m, device);
+          device.lastSeen = now;
+          devices.push_back(device);
+          return true;
+        });
+    return devices;
+  }
+
+  /**
+   * @brief Every Adapter1 object in a GetManagedObjects reply, with its
+   *        path; the first is the default
+   */
+  static std::vector<std::pair<std::string, ControllerInfo>>
+  controllersIn(const DBus::Message &reply) {
+    std::vector<std::pair<std::string, ControllerInfo>> controllers;
+    DBus::walkManagedObjects(reply.get(), [&](const char *path,
+                                              const char *iface,
+                                              sd_bus_message *m) {
+      if (std::strcmp(iface, DBus::ADAPTER_IFACE) != 0)
+        return false;
+      auto props = DBus::readTextProperties(m);
+      ControllerInfo info;
+      info.address = MacAddress::fromString(props["Address"]);
+      info.name = props.count("Alias") ? props["Alias"] : props["Name"];
+      info.isDefault = controllers.empty();
+      controllers.emplace_back(path, info);
+      return true;
+    });
+    return controllers;
+  }
+
+public:
+  /**
+   * @brief Connect to the bus and pick an org.bluez adapter
+   * @param controller Adapter address; null picks the first one
+   * @param withAgent  Register the pairing agent; one per process is
+   *                   enough, since BlueZ asks it about every adapter
+   * @throws BluetoothException if the bus or bluetoothd is unreachable, or
+   *         the adapter does not exist
+   */
+  explicit DBusBackend(MacAddress controller = MacAddress(),
+                       bool withAgent = true) {
+    const char *which = std::getenv("TOOTHDROID_DBUS_BUS");
+    bool useSession = which && std::strcmp(which, "session") == 0;
+    int r = useSession ? sd_bus_open_user(&bus) : sd_bus_open_system(&bus);
+    if (r < 0) {
+      throw BluetoothException(std::string("Failed to open D-Bus: ") +
+                               std::strerror(-r));
+    }
+
+    DBus::Error error;
+    DBus::Message reply;
+    r = managedObjects(reply, error);
+    if (r < 0) {
+      sd_bus_flush_close_unref(bus);
+      throw BluetoothException("org.bluez not available: " + error.text(r));
+    }
+
+    for (const auto &entry : controllersIn(reply)) {
+      if (controller.isNull() || entry.second.address == controller) {
+        adapterPath = entry.first;
+        break;
+      }
+    }
+
+    if (adapterPath.empty()) {
+      sd_bus_flush_close_unref(bus);
+      throw BluetoothException(
+          controller.isNull()
+              ? "No Bluetooth adapter found on D-Bus"
+              : "Adapter " + controller.toString() + " not found on D-Bus");
+    }
+
+    wakeFd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (wakeFd < 0) {
+      sd_bus_flush_close_unref(bus);
+      throw BluetoothException(std::string("eventfd failed: ") +
+                               std::strerror(errno));
+    }
+    if (withAgent)
+      registerAgent();
+  }
+
+  DBusBackend(const DBusBackend &) = delete;
+  DBusBackend &operator=(const DBusBackend &) = delete;
+
+  ~DBusBackend() override {
+    unsubscribeLocked();
+    sd_bus_slot_unref(adapterSlot);
+    sd_bus_slot_unref(deviceSlot);
+    if (agentSlot) {
+      // No reply wanted; BlueZ also drops the agent when we leave the bus
+      sd_bus_call_method_async(bus, nullptr, DBus::SERVICE, "/org/bluez",
+                               DBus::AGENT_MANAGER_IFACE, "UnregisterAgent",
+                               nullptr, nullptr, "o", DBus::AGENT_PATH);
+      sd_bus_slot_unref(agentSlot);
+    }
+    sd_bus_flush_close_unref(bus);
+    ::close(wakeFd);
+  }
+
+  std::string name() const override { return "dbus"; }
+
+  /**
+   * @brief PIN the agent gives devices that ask for one while pair() runs
+   *        (legacy pairing); empty, the default, rejects those requests
+   */
+  void setPinCode(std::string pin) {
+    BusLock lock(*this);
+    pinCode = std::move(pin);
+  }
+
+  BackendResult setPowered(bool on) override {
+    return setBool(adapterPath, DBus::ADAPTER_IFACE, "Powered", on);
+  }
+
+  bool isPowered() override {
+    BusLock lock(*this);
+    DBus::Error error;
+    int powered = 0;
+    int r = sd_bus_get_property_trivial(bus, DBus::SERVICE, adapterPath.c_str(),
+                                        DBus::ADAPTER_IFACE, "Powered",
+                                        error.get(), 'b', &powered);
+    return r >= 0 && powered;
+  }
+
+  /**
+   * @brief Adapter properties formatted like `bluetoothctl show`
+   */
+  std::string adapterInfo() override {
+    BusLock lock(*this);
+    DBus::Error error;
+    DBus::Message reply;
+    int r = sd_bus_call_method(bus, DBus::SERVICE, adapterPath.c_str(),
+                               DBus::PROPERTIES_IFACE, "GetAll", error.get(),
+                               reply.out(), "s", DBus::ADAPTER_IFACE);
+    if (r < 0)
+      return error.text(r);
+
+    auto props = DBus::readTextProperties(reply.get());
+    std::string out = "Controller " + props["Address"] + " (" +
+                      props["AddressType"] + ")\n";
+    for (const char *key : {"Name", "Alias", "Powered", "Discoverable",
+                            "Pairable", "Discovering"}) {
+      auto it = props.find(key);
+      if (it != props.end())
+        out += std::string("\t") + key + ": " + it->second + "\n";
+    }
+    return out;
+  }
+
+  /**
+   * @brief Subscribe to Adapter1 PropertiesChanged
+   *
+   * Signals are handled whenever the bus is processed: while any thread
+   * waits on it, and around every method call. `onChange` runs with the bus
+   * locked and must not call back into the backend.
+   */
+  bool watchAdapter(AdapterCallback onChange) override {
+    BusLock lock(*this);
+    adapterListener = std::move(onChange);
+    adapterSlot = sd_bus_slot_unref(adapterSlot);
+    std::string rule = "type='signal',sender='org.bluez',"
+                       "interface='org.freedesktop.DBus.Properties',"
+                       "member='PropertiesChanged',"
+                       "arg0='org.bluez.Adapter1',path='" +
+                       adapterPath + "'";
+    return sd_bus_add_match(bus, &adapterSlot, rule.c_str(),
+                            &DBusBackend::onAdapterChanged, this) >= 0;
+  }
+
+  /**
+   * @brief Subscribe to Device1 PropertiesChanged outside discovery
+   *
+   * Same rules for `onEvent` as for watchAdapter().
+   */
+  bool watchDevices(DiscoveryCallback onEvent) override {
+    BusLock lock(*this);
+    deviceListener = std::move(onEvent);
+    deviceSlot = sd_bus_slot_unref(deviceSlot);
+    return sd_bus_add_match(bus, &deviceSlot, deviceChangesRule().c_str(),
+                            &DBusBackend::onDeviceWatch, this) >= 0;
+  }
+
+  std::vector<ControllerInfo> listControllers() override {
+    BusLock lock(*this);
+    std::vector<ControllerInfo> controllers;
+    DBus::Error error;
+    DBus::Message reply;
+    if (managedObjects(reply, error) < 0)
+      return controllers;
+    for (auto &entry : controllersIn(reply))
+      controllers.push_back(std::move(entry.second));
+    return controllers;
+  }
+
+  BackendResult startDiscovery() override {
+    {
+      // Subscribe before starting so no early InterfacesAdded is missed
+      BusLock lock(*this);
+      unsubscribeLocked();
+      sd_bus_match_signal(bus, &addedSlot, DBus::SERVICE, "/",
+                          DBus::OBJECT_MANAGER_IFACE, "InterfacesAdded",
+                          &DBusBackend::onInterfacesAdded, this);
+      sd_bus_match_signal(bus, &removedSlot, DBus::SERVICE, "/",
+                          DBus::OBJECT_MANAGER_IFACE, "InterfacesRemoved",
+                          &DBusBackend::onInterfacesRemoved, this);
+      sd_bus_add_match(bus, &changedSlot, deviceChangesRule().c_str(),
+                       &DBusBackend::onPropertiesChanged, this);
+    }
+    return call(adapterPath, DBus::ADAPTER_IFACE, "StartDiscovery",
+                {"org.bluez.Error.InProgress"});
+  }
+
+  /**
+   * @brief Adapter1.SetDiscoveryFilter with a Pattern on the address
+   */
+  BackendResult setDiscoveryFilter(const std::string &address) override {
+    BusLock lock(*this);
+    DBus::Error error;
+    DBus::Message reply;
+    int r;
+    if (address.empty()) {
+      r = sd_bus_call_method(bus, DBus::SERVICE, adapterPath.c_str(),
+                             DBus::ADAPTER_IFACE, "SetDiscoveryFilter",
+                             error.get(), reply.out(), "a{sv}", 0);
+    } else {
+      r = sd_bus_call_method(bus, DBus::SERVICE, adapterPath.c_str(),
+                             DBus::ADAPTER_IFACE, "SetDiscoveryFilter",
+                             error.get(), reply.out(), "a{sv}", 1, "Pattern",
+                             "s", address.c_str());
+    }
+    return {r >= 0, r >= 0 ? "" : error.text(r)};
+  }
+
+  BackendResult stopDiscovery() override {
+    {
+      BusLock lock(*this);
+      unsubscribeLocked();
+    }
+    return call(adapterPath, DBus::ADAPTER_IFACE, "StopDiscovery",
+                {"org.bluez.Error.NotReady", "org.bluez.Error.Failed"});
+  }
+
+  bool waitForEvents(std::chrono::milliseconds timeout,
+                     const DiscoveryCallback &onEvent) override {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::vector<DiscoveryEvent> events;
+
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      waitLocked(lock, deadline, CancelToken(),
+                 [this] { return !pendingEvents.empty(); });
+      events.swap(pendingEvents);
+    }
+    for (const auto &e : events)
+      onEvent(e);
+    return true;
+  }
+
+  std::vector<std::pair<std::string, std::string>>
+  listDevices(bool pairedOnly) override {
+    BusLock lock(*this);
+    std::vector<std::pair<std::string, std::string>> result;
+    for (const auto &d : devicesLocked()) {
+      if (!pairedOnly || d.isPaired)
+        result.emplace_back(d.macAddress.toString(), d.name);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Every device from a single GetManagedObjects call
+   */
+  std::vector<BluetoothDevice> snapshotDevices(bool pairedOnly) override {
+    BusLock lock(*this);
+    std::vector<BluetoothDevice> devices = devicesLocked();
+    if (pairedOnly) {
+      devices.erase(std::remove_if(devices.begin(), devices.end(),
+                                   [](const BluetoothDevice &d) {
+                                     return !d.isPaired;
+                                   }),
+                    devices.end());
+    }
+    return devices;
+  }
+
+  BluetoothDevice deviceInfo(const std::string &mac) override {
+    BusLock lock(*this);
+    BluetoothDevice device;
+
+    DBus::Error error;
+    DBus::Message reply;
+    std::string path = devicePath(mac);
+    int r = sd_bus_call_method(bus, DBus::SERVICE, path.c_str(),
+                               DBus::PROPERTIES_IFACE, "GetAll", error.get(),
+                               reply.out(), "s", DBus::DEVICE_IFACE);
+    if (r < 0)
+      return device;
+    DBus::readDeviceProperties(reply.get(), device);
+    device.macAddress = MacAddress::fromString(mac);
+    device.lastSeen = std::time(nullptr);
+    return device;
+  }
+
+  BackendResult pair(const std::string &mac,
+                     const CancelToken &cancel = CancelToken()) override {
+    std::string path = devicePath(mac);
+    {
+      BusLock lock(*this);
+      pairing[path]++;
+    }
+    bool gaveUp;
+    BackendResult result =
+        callWithin(path, DBus::DEVICE_IFACE, "Pair", Deadline::PAIR, cancel,
+                   {"org.bluez.Error.AlreadyExists"}, gaveUp);
+    {
+      BusLock lock(*this);
+      if (--pairing[path] == 0)
+        pairing.erase(path);
+    }
+    // Otherwise BlueZ keeps the pairing attempt open on its side
+    if (gaveUp)
+      call(path, DBus::DEVICE_IFACE, "CancelPairing");
+    return result;
+  }
+
+  BackendResult connect(const std::string &mac,
+                        const CancelToken &cancel = CancelToken()) override {
+    bool gaveUp;
+    return callWithin(devicePath(mac), DBus::DEVICE_IFACE, "Connect",
+                      Deadline::CONNECT, cancel,
+                      {"org.bluez.Error.AlreadyConnected"}, gaveUp);
+  }
+
+  BackendResult disconnect(const std::string &mac) override {
+    if (!mac.empty())
+      return call(devicePath(mac), DBus::DEVICE_IFACE, "Disconnect",
+                  {"org.bluez.Error.NotConnected"}, Deadline::DISCONNECT);
+
+    std::vector<std::string> connected;
+    {
+      BusLock lock(*this);
+      for (const auto &d : devicesLocked()) {
+        if (d.isConnected)
+          connected.push_back(d.macAddress.toString());
+      }
+    }
+
+    BackendResult result{true, ""};
+    for (const auto &m : connected) {
+      auto r = disconnect(m);
+      if (!r.ok)
+        result = r;
+    }
+    return result;
+  }
+
+  BackendResult remove(const std::string &mac) override {
+    std::string path = devicePath(mac);
+    bool gaveUp;
+    return callWithin(adapterPath, DBus::ADAPTER_IFACE, "RemoveDevice",
+                      Deadline::QUERY, CancelToken(), {}, gaveUp,
+                      path.c_str());
+  }
+
+  BackendResult setTrusted(const std::string &mac, bool trusted) override {
+    return setBool(devicePath(mac), DBus::DEVICE_IFACE, "Trusted", trusted);
+  }
+
+  BackendResult setBlocked(const std::string &mac, bool blocked) override {
+    return setBool(devicePath(mac), DBus::DEVICE_IFACE, "Blocked", blocked);
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_HAVE_SDBUS
+
+#endif // TOOTHDROID_DBUS_BACKEND_H
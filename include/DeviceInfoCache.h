@@ -0,0 +1,267 @@
+#ifndef TOOTHDROID_DEVICE_INFO_CACHE_H
+#define TOOTHDROID_DEVICE_INFO_CACHE_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BluetoothBackend.h"
+#include "BluetoothDevice.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Per-device cache of backend info with a TTL per field group
+ *
+ * Names, icons and profiles rarely change and are kept for minutes, while
+ * connection state and RSSI go stale within seconds. A lookup says which
+ * fields it needs and only hits if all of them are still fresh. Discovery
+ * events and the manager's own operations invalidate or refresh fields as
+ * they happen, so the TTLs only bound changes made behind our back (e.g.
+ * by another bluetoothctl).
+ *
+ * Also remembers the MACs of the last full and paired-only snapshots, so a
+ * device list can be served without asking the backend at all.
+ */
+class DeviceInfoCache {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum Fields : unsigned {
+    IDENTITY = 1 << 0,   // Name, alias, class, icon, profiles
+    PAIRING = 1 << 1,    // Paired, trusted, blocked
+    CONNECTION = 1 << 2, // Connected
+    SIGNAL = 1 << 3,     // RSSI
+    ALL_FIELDS = IDENTITY | PAIRING | CONNECTION | SIGNAL,
+  };
+
+  struct Stats {
+    size_t hits = 0;
+    size_t misses = 0;
+    size_t invalidations = 0;
+  };
+
+private:
+  static constexpr size_t FIELD_COUNT = 4;
+
+  struct Entry {
+    BluetoothDevice device;
+    std::array<Clock::time_point, FIELD_COUNT> refreshed{};
+  };
+
+  struct Snapshot {
+    std::vector<MacAddress> members;
+    Clock::time_point refreshed{};
+    bool valid = false;
+  };
+
+  std::unordered_map<MacAddress, Entry> entries;
+  Snapshot all;    // Last snapshotDevices(false)
+  Snapshot paired; // Last snapshotDevices(true)
+  std::array<Clock::duration, FIELD_COUNT> ttl = {
+      std::chrono::minutes(10), std::chrono::seconds(60),
+      std::chrono::seconds(5), std::chrono::seconds(5)};
+  Stats stats;
+  mutable std::mutex mutex;
+
+  static size_t fieldIndex(unsigned field) {
+    size_t i = 0;
+    while (i < FIELD_COUNT && !(field & (1u << i)))
+      i++;
+    return i;
+  }
+
+  bool fresh(const Entry &entry, unsigned fields, Clock::time_point now) const {
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+      if ((fields & (1u << i)) && now - entry.refreshed[i] >= ttl[i])
+        return false;
+    }
+    return true;
+  }
+
+  void putLocked(const BluetoothDevice &device, Clock::time_point now) {
+    Entry &entry = entries[device.macAddress];
+    entry.device = device;
+    entry.refreshed.fill(now);
+  }
+
+  void invalidateLocked(MacAddress mac, unsigned fields) {
+    stats.invalidations++;
+    if (fields & PAIRING)
+      paired.valid = false;
+    auto it = entries.find(mac);
+    if (it == entries.end())
+      return;
+    for (size_t i = 0; i < FIELD_COUNT; i++) {
+      if (fields & (1u << i))
+        it->second.refreshed[i] = Clock::time_point();
+    }
+  }
+
+  bool lookupSnapshot(const Snapshot &snapshot, Clock::duration membershipTtl,
+                      unsigned fields, std::vector<BluetoothDevice> &out) {
+    auto now = Clock::now();
+    if (!snapshot.valid || now - snapshot.refreshed >= membershipTtl)
+      return false;
+    std::vector<BluetoothDevice> result;
+    result.reserve(snapshot.members.size());
+    for (MacAddress mac : snapshot.members) {
+      auto it = entries.find(mac);
+      if (it == entries.end() || !fresh(it->second, fields, now))
+        return false;
+      result.push_back(it->second.device);
+    }
+    out = std::move(result);
+    return true;
+  }
+
+public:
+  /**
+   * @brief How long one field group stays fresh after a fetch
+   */
+  void setTtl(Fields field, Clock::duration value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t i = fieldIndex(field);
+    if (i < FIELD_COUNT)
+      ttl[i] = value;
+  }
+
+  /**
+   * @brief Cached info for `mac` if every field in `fields` is fresh
+   */
+  bool lookup(MacAddress mac, unsigned fields, BluetoothDevice &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(mac);
+    if (it == entries.end() || !fresh(it->second, fields, Clock::now())) {
+      stats.misses++;
+      return false;
+    }
+    out = it->second.device;
+    stats.hits++;
+    return true;
+  }
+
+  /**
+   * @brief Store freshly fetched info; every field counts as refreshed
+   */
+  void put(const BluetoothDevice &device) {
+    std::lock_guard<std::mutex> lock(mutex);
+    putLocked(device, Clock::now());
+  }
+
+  /**
+   * @brief The devices of the last snapshot, if membership and `fields`
+   *        are all still fresh
+   *
+   * Membership of the paired list lasts as long as PAIRING does; the full
+   * list changes with discovery and lasts as long as SIGNAL.
+   */
+  bool lookupSnapshot(bool pairedOnly, unsigned fields,
+                      std::vector<BluetoothDevice> &out) {
+    std::lock_guard<std::mutex> lock(mutex);
+    bool hit =
+        pairedOnly
+            ? lookupSnapshot(paired, ttl[fieldIndex(PAIRING)], fields, out)
+            : lookupSnapshot(all, ttl[fieldIndex(SIGNAL)], fields, out);
+    if (hit)
+      stats.hits++;
+    else
+      stats.misses++;
+    return hit;
+  }
+
+  /**
+   * @brief Store the result of snapshotDevices(pairedOnly)
+   */
+  void putSnapshot(bool pairedOnly,
+                   const std::vector<BluetoothDevice> &devices) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto now = Clock::now();
+    Snapshot &snapshot = pairedOnly ? paired : all;
+    snapshot.members.clear();
+    for (const auto &device : devices) {
+      putLocked(device, now);
+      snapshot.members.push_back(device.macAddress);
+    }
+    snapshot.refreshed = now;
+    snapshot.valid = true;
+  }
+
+  /**
+   * @brief Mark `fields` of one device stale; the next lookup refetches
+   *
+   * Changing PAIRING also drops the paired list, whose membership it
+   * decides.
+   */
+  void invalidate(MacAddress mac, unsigned fields) {
+    std::lock_guard<std::mutex> lock(mutex);
+    invalidateLocked(mac, fields);
+  }
+
+  /**
+   * @brief Mark `fields` of every device stale
+   */
+  void invalidateAll(unsigned fields) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.invalidations++;
+    if (fields & PAIRING)
+      paired.valid = false;
+    for (auto &entry : entries) {
+      for (size_t i = 0; i < FIELD_COUNT; i++) {
+        if (fields & (1u << i))
+          entry.second.refreshed[i] = Clock::time_point();
+      }
+    }
+  }
+
+  /**
+   * @brief Fold a discovery event in
+   *
+   * An RSSI in the event is a fresh reading; a name is taken over as is.
+   * A connected or paired change marks CONNECTION or PAIRING stale, since
+   * it also moves fields the event does not carry (trusted, profiles).
+   * Added and Removed change the device list itself.
+   */
+  void apply(const DiscoveryEvent &event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (event.type != DiscoveryEvent::Type::Changed) {
+      all.valid = false;
+      if (event.type == DiscoveryEvent::Type::Removed) {
+        stats.invalidations += entries.erase(event.mac);
+        return;
+      }
+    }
+    unsigned stale = (event.connected ? CONNECTION : 0u) |
+                     (event.paired ? PAIRING : 0u);
+    if (stale)
+      invalidateLocked(event.mac, stale);
+    auto it = entries.find(event.mac);
+    if (it == entries.end())
+      return;
+    if (!event.name.empty())
+      it->second.device.name = event.name;
+    if (event.rssi != 0) {
+      it->second.device.rssi = event.rssi;
+      it->second.refreshed[fieldIndex(SIGNAL)] = Clock::now();
+    }
+  }
+
+  void clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    entries.clear();
+    all = Snapshot();
+    paired = Snapshot();
+  }
+
+  Stats getStats() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_DEVICE_INFO_CACHE_H
@@ -0,0 +1,426 @@
+#ifndef TOOTHDROID_DEVICE_JOURNAL_H
+#define TOOTHDROID_DEVICE_JOURNAL_H
+
+#include <array>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BluetoothDevice.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Append-only log of device state changes
+ *
+ * Every pair, connect, trust, block or remove is appended as one
+ * checksummed 32-byte entry with a plain write(), so it survives the
+ * process being killed the moment the call returns. Making it survive a
+ * machine crash needs an fsync; a background thread batches those (group
+ * commit) instead of paying one per action.
+ *
+ * At startup the entries are replayed over the device store, after which
+ * the store is synced and the replayed entries are dropped (checkpoint).
+ * Replay stops at the first entry whose checksum does not match, which is
+ * where a crash cut the last write short.
+ *
+ * Several processes (CLI, GUI) may append to one journal. Each tags its
+ * entries with a random writer ID, and a checkpoint only drops entries it
+ * has saved itself, so another process's unsaved changes stay.
+ */
+class DeviceJournal {
+public:
+  static constexpr uint32_t VERSION = 1;
+
+  enum class Change : uint16_t {
+    Connected = 1,
+    Disconnected,
+    Paired,
+    Unpaired,
+    Trusted,
+    Untrusted,
+    Blocked,
+    Unblocked,
+  };
+
+  struct Header {
+    char magic[8]; // "TDJRNL\0\0"
+    uint32_t version;
+    uint32_t entrySize;
+  };
+
+  struct Entry {
+    uint32_t checksum; // CRC-32 of the rest of the entry
+    uint32_t sequence;
+    uint64_t mac;
+    int64_t time;
+    Change change;
+    uint16_t reserved16;
+    uint32_t writer; // Appending journal's ID; 0 in older journals
+  };
+
+  static_assert(sizeof(Header) == 16, "journal header layout");
+  static_assert(sizeof(Entry) == 32, "journal entry layout");
+  static_assert(std::is_trivially_copyable<Entry>::value,
+                "entries are written as raw bytes");
+
+  /**
+   * @brief Counters for tuning the commit interval
+   */
+  struct Stats {
+    size_t appended = 0;
+    size_t syncs = 0;
+  };
+
+private:
+  static constexpr char MAGIC[8] = {'T', 'D', 'J', 'R', 'N', 'L', '\0', '\0'};
+
+  std::string path;
+  int fd = -1;
+  uint32_t writer; // Tags this process's entries
+  uint32_t nextSequence = 1;
+  std::chrono::milliseconds commitInterval;
+  size_t checkpointAfter;
+  size_t unchecked = 0; // Own entries since the last checkpoint
+
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  bool dirty = false; // Written but not yet fsynced
+  bool stopping = false;
+  Stats stats;
+  std::thread committer;
+
+  static constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t c = i;
+      for (int k = 0; k < 8; k++)
+        c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+      table[i] = c;
+    }
+    return table;
+  }
+
+  static uint32_t crc32(const void *data, size_t size) {
+    static constexpr std::array<uint32_t, 256> table = makeCrcTable();
+    const auto *p = static_cast<const uint8_t *>(data);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; i++)
+      crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+  }
+
+  static uint32_t checksumOf(const Entry &entry) {
+    return crc32(reinterpret_cast<const char *>(&entry) + sizeof(uint32_t),
+                 sizeof(Entry) - sizeof(uint32_t));
+  }
+
+  static uint32_t makeWriterId() {
+    std::random_device random;
+    uint32_t id = random() ^ static_cast<uint32_t>(getpid());
+    return id != 0 ? id : 1;
+  }
+
+  static uint64_t keyOf(const Entry &entry) {
+    return static_cast<uint64_t>(entry.writer) << 32 | entry.sequence;
+  }
+
+  // Valid entries from the start of the file; held under the file lock
+  std::vector<Entry> readLocked(off_t &end) const {
+    std::vector<Entry> entries;
+    end = sizeof(Header);
+    Entry entry;
+    while (pread(fd, &entry, sizeof(entry), end) ==
+               static_cast<ssize_t>(sizeof(entry)) &&
+           entry.checksum == checksumOf(entry)) {
+      entries.push_back(entry);
+      end += sizeof(Entry);
+    }
+    return entries;
+  }
+
+  static Header makeHeader() {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.entrySize = sizeof(Entry);
+    return header;
+  }
+
+  static bool writeAll(int file, const void *data, size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+      ssize_t n = ::write(file, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Background group commit: one fdatasync per interval at most
+   */
+  void commitLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wakeup.wait(lock, [this] { return stopping || dirty; });
+      if (!stopping) {
+        // Let more writes join this commit
+        wakeup.wait_for(lock, commitInterval, [this] { return stopping; });
+      }
+      if (dirty) {
+        dirty = false;
+        int file = fd;
+        lock.unlock();
+        fdatasync(file);
+        lock.lock();
+        stats.syncs++;
+      }
+      if (stopping)
+        return;
+    }
+  }
+
+public:
+  /**
+   * @param file            Journal location; created if missing
+   * @param commitInterval  Longest a change waits before it is fsynced
+   * @param checkpointAfter Own entries after which needsCheckpoint() says
+   *                        so
+   */
+  explicit DeviceJournal(std::string file,
+                         std::chrono::milliseconds commitInterval =
+                             std::chrono::milliseconds(200),
+                         size_t checkpointAfter = 1024)
+      : path(std::move(file)), writer(makeWriterId()),
+        commitInterval(commitInterval), checkpointAfter(checkpointAfter) {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+      return;
+
+    struct stat st;
+    Header header{};
+    bool valid = fstat(fd, &st) == 0 &&
+                 static_cast<size_t>(st.st_size) >= sizeof(Header) &&
+                 pread(fd, &header, sizeof(header), 0) ==
+                     static_cast<ssize_t>(sizeof(header)) &&
+                 std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 &&
+                 header.version == VERSION &&
+                 header.entrySize == sizeof(Entry);
+    if (!valid) {
+      header = makeHeader();
+      if (ftruncate(fd, 0) != 0 ||
+          pwrite(fd, &header, sizeof(header), 0) !=
+              static_cast<ssize_t>(sizeof(header))) {
+        ::close(fd);
+        fd = -1;
+        return;
+      }
+    }
+    committer = std::thread(&DeviceJournal::commitLoop, this);
+  }
+
+  /**
+   * @brief Commit whatever is still pending, then close
+   */
+  ~DeviceJournal() {
+    if (committer.joinable()) {
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+      }
+      wakeup.notify_all();
+      committer.join();
+    }
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  DeviceJournal(const DeviceJournal &) = delete;
+  DeviceJournal &operator=(const DeviceJournal &) = delete;
+
+  bool isOpen() const { return fd >= 0; }
+
+  /**
+   * @brief Valid entries in order; a torn or corrupt tail is cut off
+   */
+  std::vector<Entry> replay() {
+    std::vector<Entry> entries;
+    if (fd < 0)
+      return entries;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    flock(fd, LOCK_EX);
+    off_t offset;
+    entries = readLocked(offset);
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size != offset) {
+      if (ftruncate(fd, offset) == 0)
+        fdatasync(fd);
+    }
+    flock(fd, LOCK_UN);
+
+    if (!entries.empty())
+      nextSequence = entries.back().sequence + 1;
+    return entries;
+  }
+
+  /**
+   * @brief A change to `mac` happening now, ready for apply() and append()
+   */
+  static Entry makeEntry(MacAddress mac, Change change) {
+    Entry entry{};
+    entry.mac = mac.toUint64();
+    entry.time = static_cast<int64_t>(std::time(nullptr));
+    entry.change = change;
+    return entry;
+  }
+
+  /**
+   * @brief Record a change; durable against SIGKILL on return, against a
+   *        machine crash within the commit interval
+   */
+  bool append(Entry entry) {
+    if (fd < 0)
+      return false;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    entry.sequence = nextSequence++;
+    entry.writer = writer;
+    entry.checksum = checksumOf(entry);
+
+    // The CLI and GUI may share the file; the lock keeps entries whole
+    flock(fd, LOCK_EX);
+    bool ok =
+        lseek(fd, 0, SEEK_END) >= 0 && writeAll(fd, &entry, sizeof(entry));
+    flock(fd, LOCK_UN);
+    if (!ok)
+      return false;
+
+    stats.appended++;
+    unchecked++;
+    dirty = true;
+    wakeup.notify_all();
+    return true;
+  }
+
+  /**
+   * @brief Whether enough of our own entries piled up to checkpoint
+   *
+   * Only the owner of the device store can checkpoint, so it asks after
+   * appending; a long-running process would otherwise grow the journal
+   * until it exits.
+   */
+  bool needsCheckpoint() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return unchecked >= checkpointAfter;
+  }
+
+  /**
+   * @brief fsync now instead of waiting for the next group commit
+   */
+  void sync() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0 && dirty) {
+      dirty = false;
+      fdatasync(fd);
+      stats.syncs++;
+    }
+  }
+
+  /**
+   * @brief Drop entries once they are safely in the device store
+   *
+   * Entries this journal appended are always dropped, plus `persisted`
+   * (from replay()). Whatever other processes appended stays; the file is
+   * rewritten in place, since they keep appending to it.
+   */
+  void checkpoint(const std::vector<Entry> &persisted = {}) {
+    if (fd < 0)
+      return;
+    std::unordered_set<uint64_t> saved;
+    for (const Entry &entry : persisted)
+      saved.insert(keyOf(entry));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    flock(fd, LOCK_EX);
+    off_t end;
+    std::vector<Entry> kept;
+    for (const Entry &entry : readLocked(end)) {
+      if (entry.writer != writer && !saved.count(keyOf(entry)))
+        kept.push_back(entry);
+    }
+    // Moving entries towards the front: a crash midway leaves duplicates,
+    // which replay harmlessly, but never loses a kept entry
+    size_t size = kept.size() * sizeof(Entry);
+    bool ok = size == 0 ||
+              pwrite(fd, kept.data(), size, sizeof(Header)) ==
+                  static_cast<ssize_t>(size);
+    if (ok && ftruncate(fd, static_cast<off_t>(sizeof(Header) + size)) == 0)
+      fdatasync(fd);
+    flock(fd, LOCK_UN);
+    dirty = false;
+    unchecked = 0;
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+
+  /**
+   * @brief Apply one entry to a device's in-memory state
+   */
+  static void apply(const Entry &entry, BluetoothDevice &device) {
+    switch (entry.change) {
+    case Change::Connected:
+      device.lastConnected = static_cast<std::time_t>(entry.time);
+      break;
+    case Change::Disconnected:
+      break;
+    case Change::Paired:
+      device.isPaired = true;
+      break;
+    case Change::Unpaired:
+      device.isPaired = false;
+      device.isTrusted = false;
+      break;
+    case Change::Trusted:
+      device.isTrusted = true;
+      break;
+    case Change::Untrusted:
+      device.isTrusted = false;
+      break;
+    case Change::Blocked:
+      device.isBlocked = true;
+      break;
+    case Change::Unblocked:
+      device.isBlocked = false;
+      break;
+    }
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_DEVICE_JOURNAL_H
@@ -0,0 +1,534 @@
+#ifndef TOOTHDROID_DEVICE_STORE_H
+#define TOOTHDROID_DEVICE_STORE_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BluetoothDevice.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Known devices and favorites persisted across launches
+ *
+ * The file is a 64-byte header followed by fixed 256-byte records, one per
+ * saved device state. Updates only ever append a record; the newest record
+ * for an address wins. Loading maps the file and reads the records in
+ * place, so nothing is parsed. Once superseded records outnumber live ones
+ * the file is rewritten (compacted) next to the original and renamed over
+ * it.
+ *
+ * Persistence is best effort: if the file cannot be opened the store stays
+ * closed and every call is a no-op.
+ */
+class DeviceStore {
+public:
+  static constexpr uint32_t VERSION = 1;
+
+  enum Flags : uint32_t {
+    PAIRED = 1u << 0,
+    TRUSTED = 1u << 1,
+    BLOCKED = 1u << 2,
+    A2DP = 1u << 3,
+    HSP = 1u << 4,
+    HFP = 1u << 5,
+    FAVORITE = 1u << 6,
+  };
+
+  struct Header {
+    char magic[8]; // "TDSTORE\0"
+    uint32_t version;
+    uint32_t recordSize;
+    uint8_t reserved[48];
+  };
+
+  struct Record {
+    uint64_t mac; // MacAddress::toUint64()
+    int64_t lastSeen;
+    int64_t lastConnected;
+    uint32_t flags;
+    int16_t rssi;
+    uint16_t reserved;
+    char name[80]; // NUL-terminated, truncated if longer
+    char alias[80];
+    char icon[32];
+    char deviceClass[32];
+  };
+
+  static_assert(sizeof(Header) == 64, "store header layout");
+  static_assert(sizeof(Record) == 256, "store record layout");
+  static_assert(std::is_trivially_copyable<Record>::value,
+                "records are read straight from the mapping");
+
+private:
+  std::string path;
+  int fd = -1;
+  ino_t inode = 0;
+  size_t records = 0; // Whole records in the file
+  size_t capacity = DeviceHistory::DEFAULT_CAPACITY;
+  std::unordered_map<uint64_t, size_t> latest; // MAC -> newest record index
+  std::unordered_set<uint64_t> favorites;
+
+  static constexpr char MAGIC[8] = {'T', 'D', 'S', 'T', 'O', 'R', 'E', '\0'};
+
+  static Header makeHeader() {
+    Header header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.recordSize = sizeof(Record);
+    return header;
+  }
+
+  static void copyField(char *dest, size_t size, const std::string &src) {
+    size_t n = src.size() < size - 1 ? src.size() : size - 1;
+    std::memcpy(dest, src.data(), n);
+    std::memset(dest + n, 0, size - n);
+  }
+
+  static std::string readField(const char *src, size_t size) {
+    return std::string(src, strnlen(src, size));
+  }
+
+  static bool writeAll(int file, const void *data, size_t size) {
+    const char *p = static_cast<const char *>(data);
+    while (size > 0) {
+      ssize_t n = ::write(file, p, size);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      p += n;
+      size -= static_cast<size_t>(n);
+    }
+    return true;
+  }
+
+  /**
+   * @brief Read-only view of the records currently on disk
+   */
+  class Mapping {
+  private:
+    void *base = MAP_FAILED;
+    size_t length = 0;
+
+  public:
+    const Record *records = nullptr;
+    size_t count = 0;
+
+    explicit Mapping(int file) {
+      struct stat st;
+      if (fstat(file, &st) != 0 ||
+          static_cast<size_t>(st.st_size) < sizeof(Header))
+        return;
+      length = static_cast<size_t>(st.st_size);
+      base = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+      if (base == MAP_FAILED)
+        return;
+      records = reinterpret_cast<const Record *>(
+          static_cast<const char *>(base) + sizeof(Header));
+      count = (length - sizeof(Header)) / sizeof(Record);
+    }
+
+    ~Mapping() {
+      if (base != MAP_FAILED)
+        munmap(base, length);
+    }
+
+    Mapping(const Mapping &) = delete;
+    Mapping &operator=(const Mapping &) = delete;
+
+    const Header *header() const {
+      return base != MAP_FAILED ? static_cast<const Header *>(base) : nullptr;
+    }
+  };
+
+  /**
+   * @brief Open (or create) the file and index its records
+   */
+  bool openFile() {
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+      return false;
+    flock(fd, LOCK_EX);
+
+    struct stat st;
+    fstat(fd, &st);
+    inode = st.st_ino;
+
+    bool valid = false;
+    {
+      Mapping map(fd);
+      const Header *header = map.header();
+      valid = header &&
+              std::memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+              header->version == VERSION &&
+              header->recordSize == sizeof(Record);
+      if (valid)
+        index(map);
+    }
+
+    if (!valid) {
+      // New file, or one written by an incompatible version: start over
+      Header header = makeHeader();
+      if (ftruncate(fd, 0) != 0 ||
+          pwrite(fd, &header, sizeof(header), 0) !=
+              static_cast<ssize_t>(sizeof(header))) {
+        flock(fd, LOCK_UN);
+        ::close(fd);
+        fd = -1;
+        return false;
+      }
+      records = 0;
+      latest.clear();
+      favorites.clear();
+    } else {
+      // Drop a record torn by a crash mid-append so later appends line up
+      off_t whole =
+          static_cast<off_t>(sizeof(Header) + records * sizeof(Record));
+      if (st.st_size != whole && ftruncate(fd, whole) != 0) {
+        records = 0;
+      }
+    }
+
+    flock(fd, LOCK_UN);
+    return true;
+  }
+
+  void index(const Mapping &map) {
+    records = 0;
+    latest.clear();
+    favorites.clear();
+    indexFrom(map);
+  }
+
+  // Index the records after the ones already seen
+  void indexFrom(const Mapping &map) {
+    for (size_t i = records; i < map.count; i++) {
+      const Record &r = map.records[i];
+      latest[r.mac] = i;
+      if (r.flags & FAVORITE)
+        favorites.insert(r.mac);
+      else
+        favorites.erase(r.mac);
+    }
+    records = map.count;
+  }
+
+  /**
+   * @brief Catch up with records other processes appended; call with the
+   *        file locked
+   *
+   * Without this a favorite set by another process would be written back
+   * without its FAVORITE bit by our next save.
+   */
+  void refreshLocked() {
+    Mapping map(fd);
+    if (map.count < records)
+      index(map);
+    else if (map.count > records)
+      indexFrom(map);
+  }
+
+  /**
+   * @brief Append `devices` under the file lock, after `update` has had a
+   *        chance to change the freshly read favorites
+   */
+  template <typename Update>
+  bool append(const std::vector<BluetoothDevice> &devices, Update update) {
+    if (fd < 0 || devices.empty())
+      return false;
+
+    if (!lockCurrent())
+      return false;
+    refreshLocked();
+    update();
+
+    std::vector<Record> batch;
+    batch.reserve(devices.size());
+    for (const auto &d : devices)
+      batch.push_back(toRecord(d));
+    bool ok = appendLocked(batch.data(), batch.size());
+
+    bool compact = ok && needsCompaction();
+    flock(fd, LOCK_UN);
+    if (compact)
+      this->compact();
+    return ok;
+  }
+
+  /**
+   * @brief Take the file lock, first following a compaction by another
+   *        process that renamed a new file over ours
+   */
+  bool lockCurrent() {
+    while (fd >= 0) {
+      flock(fd, LOCK_EX);
+      struct stat st;
+      if (::stat(path.c_str(), &st) == 0 && st.st_ino == inode)
+        return true;
+      ::close(fd);
+      fd = -1;
+      openFile();
+    }
+    return false;
+  }
+
+  Record toRecord(const BluetoothDevice &device) const {
+    Record r{};
+    r.mac = device.macAddress.toUint64();
+    r.lastSeen = static_cast<int64_t>(device.lastSeen);
+    r.lastConnected = static_cast<int64_t>(device.lastConnected);
+    auto bit = [](bool on, Flags flag) {
+      return on ? static_cast<uint32_t>(flag) : 0u;
+    };
+    r.flags = bit(device.isPaired, PAIRED) | bit(device.isTrusted, TRUSTED) |
+              bit(device.isBlocked, BLOCKED) |
+              bit(device.supportsA2DP, A2DP) | bit(device.supportsHSP, HSP) |
+              bit(device.supportsHFP, HFP) |
+              bit(favorites.count(r.mac) > 0, FAVORITE);
+    r.rssi = device.rssi;
+    copyField(r.name, sizeof(r.name), device.name);
+    copyField(r.alias, sizeof(r.alias), device.alias);
+    copyField(r.icon, sizeof(r.icon), device.icon);
+    copyField(r.deviceClass, sizeof(r.deviceClass), device.deviceClass);
+    return r;
+  }
+
+  static BluetoothDevice fromRecord(const Record &r) {
+    BluetoothDevice device;
+    device.macAddress = MacAddress(r.mac);
+    device.name = readField(r.name, sizeof(r.name));
+    device.alias = readField(r.alias, sizeof(r.alias));
+    device.icon = readField(r.icon, sizeof(r.icon));
+    device.deviceClass = readField(r.deviceClass, sizeof(r.deviceClass));
+    device.isPaired = r.flags & PAIRED;
+    device.isTrusted = r.flags & TRUSTED;
+    device.isBlocked = r.flags & BLOCKED;
+    device.supportsA2DP = r.flags & A2DP;
+    device.supportsHSP = r.flags & HSP;
+    device.supportsHFP = r.flags & HFP;
+    device.rssi = r.rssi;
+    device.lastSeen = static_cast<std::time_t>(r.lastSeen);
+    device.lastConnected = static_cast<std::time_t>(r.lastConnected);
+    return device; // isConnected is live state and never restored
+  }
+
+  /**
+   * @brief Newest record of each live MAC, oldest first; the `keep` most
+   *        recent MACs plus all favorites survive
+   */
+  std::vector<Record> liveRecords(const Mapping &map, size_t keep) const {
+    std::vector<size_t> order;
+    order.reserve(latest.size());
+    for (size_t i = 0; i < map.count; i++) {
+      auto it = latest.find(map.records[i].mac);
+      if (it != latest.end() && it->second == i)
+        order.push_back(i);
+    }
+
+    std::vector<Record> live;
+    live.reserve(order.size());
+    size_t skip = order.size() > keep ? order.size() - keep : 0;
+    for (size_t n = 0; n < order.size(); n++) {
+      const Record &r = map.records[order[n]];
+      if (n >= skip || (r.flags & FAVORITE))
+        live.push_back(r);
+    }
+    return live;
+  }
+
+  bool appendLocked(const Record *data, size_t count) {
+    // Another process may have appended since we last looked
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+      return false;
+    size_t size = static_cast<size_t>(st.st_size);
+    size_t onDisk =
+        size < sizeof(Header) ? 0 : (size - sizeof(Header)) / sizeof(Record);
+    if (onDisk > records)
+      records = onDisk;
+
+    off_t end = static_cast<off_t>(sizeof(Header) + records * sizeof(Record));
+    if (lseek(fd, end, SEEK_SET) < 0 ||
+        !writeAll(fd, data, count * sizeof(Record)))
+      return false;
+    for (size_t i = 0; i < count; i++)
+      latest[data[i].mac] = records + i;
+    records += count;
+    return true;
+  }
+
+  bool needsCompaction() const {
+    return records > 64 && records > 2 * latest.size();
+  }
+
+public:
+  /**
+   * @param file Store location; created (with parent directory) if missing
+   */
+  explicit DeviceStore(std::string file) : path(std::move(file)) {
+    size_t slash = path.rfind('/');
+    if (slash != std::string::npos && slash > 0)
+      makeDirectories(path.substr(0, slash));
+    openFile();
+  }
+
+  ~DeviceStore() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  DeviceStore(const DeviceStore &) = delete;
+  DeviceStore &operator=(const DeviceStore &) = delete;
+
+  /**
+   * @brief $TOOTHDROID_STORE, else $XDG_DATA_HOME/toothdroid/devices.db,
+   *        else ~/.local/share/toothdroid/devices.db; "" disables the store
+   */
+  static std::string defaultPath() {
+    if (const char *env = std::getenv("TOOTHDROID_STORE"))
+      return env;
+    if (const char *xdg = std::getenv("XDG_DATA_HOME"); xdg && *xdg)
+      return std::string(xdg) + "/toothdroid/devices.db";
+    if (const char *home = std::getenv("HOME"); home && *home)
+      return std::string(home) + "/.local/share/toothdroid/devices.db";
+    return "";
+  }
+
+  static void makeDirectories(const std::string &dir) {
+    for (size_t pos = dir.find('/', 1); pos != std::string::npos;
+         pos = dir.find('/', pos + 1))
+      ::mkdir(dir.substr(0, pos).c_str(), 0700);
+    ::mkdir(dir.c_str(), 0700);
+  }
+
+  bool isOpen() const { return fd >= 0; }
+  const std::string &getPath() const { return path; }
+
+  /**
+   * @brief Records on disk, including superseded ones
+   */
+  size_t recordCount() const { return records; }
+
+  /**
+   * @brief Distinct devices on disk
+   */
+  size_t deviceCount() const { return latest.size(); }
+
+  /**
+   * @brief How many non-favorite devices survive compaction
+   */
+  void setCapacity(size_t maxDevices) { capacity = maxDevices; }
+
+  /**
+   * @brief Fill `history` with the saved devices and favorites
+   *
+   * Devices are added oldest first, so the history's LRU order matches
+   * the order they were last saved in.
+   */
+  void load(DeviceHistory &history) {
+    if (!lockCurrent())
+      return;
+    Mapping map(fd);
+    if (map.count != records)
+      index(map);
+    flock(fd, LOCK_UN);
+    for (const Record &r : liveRecords(map, map.count)) {
+      history.addDevice(fromRecord(r));
+      // Pin right away so later records cannot evict it
+      if (r.flags & FAVORITE)
+        history.addFavorite(MacAddress(r.mac));
+    }
+  }
+
+  /**
+   * @brief Append the current state of one device
+   */
+  bool save(const BluetoothDevice &device) {
+    return saveAll(std::vector<BluetoothDevice>{device});
+  }
+
+  /**
+   * @brief Append the current state of several devices in one write
+   */
+  bool saveAll(const std::vector<BluetoothDevice> &devices) {
+    return append(devices, [] {});
+  }
+
+  /**
+   * @brief Mark a device as favorite and append its state
+   */
+  bool setFavorite(const BluetoothDevice &device, bool favorite = true) {
+    uint64_t mac = device.macAddress.toUint64();
+    return append({device}, [&] {
+      if (favorite)
+        favorites.insert(mac);
+      else
+        favorites.erase(mac);
+    });
+  }
+
+  bool isFavorite(MacAddress mac) const {
+    return favorites.count(mac.toUint64()) > 0;
+  }
+
+  /**
+   * @brief Flush appended records to disk
+   */
+  bool sync() { return fd >= 0 && fdatasync(fd) == 0; }
+
+  /**
+   * @brief Rewrite the file with only the newest record per device
+   */
+  bool compact() {
+    if (fd < 0)
+      return false;
+    if (!lockCurrent())
+      return false;
+
+    std::vector<Record> live;
+    {
+      Mapping map(fd);
+      index(map);
+      live = liveRecords(map, capacity);
+    }
+
+    std::string temp = path + ".tmp";
+    int out = ::open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                     0600);
+    Header header = makeHeader();
+    bool ok = out >= 0 && writeAll(out, &header, sizeof(header)) &&
+              writeAll(out, live.data(), live.size() * sizeof(Record)) &&
+              fsync(out) == 0;
+    if (out >= 0)
+      ::close(out);
+    if (!ok || ::rename(temp.c_str(), path.c_str()) != 0) {
+      ::unlink(temp.c_str());
+      flock(fd, LOCK_UN);
+      return false;
+    }
+
+    // Switch to the new file; the old descriptor (and its lock) go away
+    ::close(fd);
+    fd = -1;
+    return openFile();
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_DEVICE_STORE_H
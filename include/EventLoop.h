@@ -0,0 +1,102 @@
+#ifndef TOOTHDROID_EVENT_LOOP_H
+#define TOOTHDROID_EVENT_LOOP_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <utility>
+
+namespace ToothDroid {
+
+/**
+ * @brief Queue of callbacks run on whichever thread drives the loop
+ *
+ * Any thread may post(); callbacks run in posting order on the thread
+ * inside run() or runUntil(). Used to deliver Operation completions to a
+ * single thread, the way the GUI gets them on the Qt event loop.
+ */
+class EventLoop {
+private:
+  std::deque<std::function<void()>> queue;
+  bool stopped = false;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+
+  // Pop one callback, waiting until `deadline`; false if none came
+  bool runOne(std::chrono::steady_clock::time_point deadline) {
+    std::function<void()> fn;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      if (!wakeup.wait_until(lock, deadline, [this] { return !queue.empty(); }))
+        return false;
+      fn = std::move(queue.front());
+      queue.pop_front();
+    }
+    fn();
+    return true;
+  }
+
+public:
+  void post(std::function<void()> fn) {
+    // Notify under the lock: the callback may be the last one the owner
+    // waits for, after which the loop can be destroyed
+    std::lock_guard<std::mutex> lock(mutex);
+    queue.push_back(std::move(fn));
+    wakeup.notify_one();
+  }
+
+  /**
+   * @brief Run callbacks until stop() is called
+   */
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wakeup.wait(lock, [this] { return stopped || !queue.empty(); });
+      if (queue.empty())
+        break;
+      std::function<void()> fn = std::move(queue.front());
+      queue.pop_front();
+      lock.unlock();
+      fn();
+      lock.lock();
+    }
+    stopped = false;
+  }
+
+  /**
+   * @brief Run callbacks until `done()` holds or `timeout` passes
+   * @return done() at the end
+   */
+  template <typename Pred>
+  bool runUntil(Pred done, std::chrono::milliseconds timeout) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!done()) {
+      if (!runOne(deadline))
+        return done();
+    }
+    return true;
+  }
+
+  /**
+   * @brief Make run() return once the queue is empty
+   */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopped = true;
+    }
+    wakeup.notify_all();
+  }
+
+  size_t pending() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queue.size();
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_EVENT_LOOP_H
@@ -0,0 +1,131 @@
+#ifndef TOOTHDROID_MAC_ADDRESS_H
+#define TOOTHDROID_MAC_ADDRESS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace ToothDroid {
+
+/**
+ * @brief 48-bit Bluetooth device address packed into one integer
+ *
+ * Trivially copyable, so comparing or hashing it costs one integer
+ * operation. The all-zero address doubles as "no address".
+ */
+class MacAddress {
+private:
+  uint64_t bits = 0;
+
+  static constexpr int hexValue(char c) {
+    if (c >= '0' && c <= '9')
+      return c - '0';
+    if (c >= 'a' && c <= 'f')
+      return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+      return c - 'A' + 10;
+    return -1;
+  }
+
+public:
+  static constexpr size_t STRING_LENGTH = 17; // "XX:XX:XX:XX:XX:XX"
+
+  constexpr MacAddress() = default;
+  constexpr explicit MacAddress(uint64_t value)
+      : bits(value & 0xFFFFFFFFFFFFull) {}
+
+  /**
+   * @brief Parse "AA:BB:CC:DD:EE:FF" (either case)
+   * @return false, leaving `out` untouched, if text is not exactly that
+   */
+  static constexpr bool parse(std::string_view text, MacAddress &out) {
+    if (text.size() != STRING_LENGTH)
+      return false;
+    uint64_t value = 0;
+    for (size_t i = 0; i < STRING_LENGTH; i += 3) {
+      int high = hexValue(text[i]);
+      int low = hexValue(text[i + 1]);
+      if (high < 0 || low < 0 || (i + 2 < STRING_LENGTH && text[i + 2] != ':'))
+        return false;
+      value = value << 8 | static_cast<uint64_t>(high << 4 | low);
+    }
+    out = MacAddress(value);
+    return true;
+  }
+
+  /**
+   * @brief Parse, or the null address if text is not a MAC
+   */
+  static constexpr MacAddress fromString(std::string_view text) {
+    MacAddress result;
+    parse(text, result);
+    return result;
+  }
+
+  constexpr uint64_t toUint64() const { return bits; }
+  constexpr bool isNull() const { return bits == 0; }
+
+  /**
+   * @brief Upper-case "AA:BB:CC:DD:EE:FF" plus a terminating NUL
+   */
+  constexpr std::array<char, STRING_LENGTH + 1> format() const {
+    constexpr char digits[] = "0123456789ABCDEF";
+    std::array<char, STRING_LENGTH + 1> out{};
+    for (int byte = 0; byte < 6; byte++) {
+      unsigned value = static_cast<unsigned>(bits >> (40 - 8 * byte)) & 0xFF;
+      out[byte * 3] = digits[value >> 4];
+      out[byte * 3 + 1] = digits[value & 0xF];
+      if (byte < 5)
+        out[byte * 3 + 2] = ':';
+    }
+    return out;
+  }
+
+  std::string toString() const {
+    auto text = format();
+    return std::string(text.data(), STRING_LENGTH);
+  }
+
+  constexpr bool operator==(const MacAddress &other) const {
+    return bits == other.bits;
+  }
+  constexpr bool operator!=(const MacAddress &other) const {
+    return bits != other.bits;
+  }
+  constexpr bool operator<(const MacAddress &other) const {
+    return bits < other.bits;
+  }
+};
+
+static_assert(std::is_trivially_copyable<MacAddress>::value,
+              "MacAddress must stay trivially copyable");
+static_assert(sizeof(MacAddress) == sizeof(uint64_t), "MacAddress is packed");
+static_assert(MacAddress::fromString("aa:BB:cc:00:11:22").toUint64() ==
+                  0xAABBCC001122ull,
+              "MacAddress parsing");
+
+inline std::ostream &operator<<(std::ostream &os, const MacAddress &mac) {
+  return os << mac.format().data();
+}
+
+} // namespace ToothDroid
+
+namespace std {
+template <> struct hash<ToothDroid::MacAddress> {
+  size_t operator()(const ToothDroid::MacAddress &mac) const noexcept {
+    // Vendor prefixes repeat, so mix the bits before bucketing
+    uint64_t x = mac.toUint64();
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    return static_cast<size_t>(x);
+  }
+};
+} // namespace std
+
+#endif // TOOTHDROID_MAC_ADDRESS_H
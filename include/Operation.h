@@ -0,0 +1,187 @@
+#ifndef TOOTHDROID_OPERATION_H
+#define TOOTHDROID_OPERATION_H
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "BluetoothBackend.h"
+#include "CancelToken.h"
+#include "EventLoop.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Thrown by Operation::get() for an operation that never ran
+ *        or was cancelled before it could finish
+ */
+class OperationCancelled : public BluetoothException {
+public:
+  OperationCancelled() : BluetoothException("Operation cancelled") {}
+};
+
+template <typename T> class Promise;
+
+/**
+ * @brief Result of an asynchronous BluetoothManager call
+ *
+ * A cheap, copyable handle on a result that a worker fills in later.
+ * Callers can block on it (wait(), get()), or register a continuation
+ * with then(); the EventLoop overload delivers it on the loop's thread, so
+ * any number of operations can be in flight from one thread.
+ */
+template <typename T> class Operation {
+private:
+  friend class Promise<T>;
+
+  struct State {
+    std::mutex mutex;
+    std::condition_variable ready;
+    bool done = false;
+    std::optional<T> value;
+    std::exception_ptr error;
+    std::vector<std::function<void()>> continuations;
+    CancelToken cancel = CancelToken::create();
+  };
+
+  std::shared_ptr<State> state;
+
+  explicit Operation(std::shared_ptr<State> s) : state(std::move(s)) {}
+
+public:
+  bool isReady() const {
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->done;
+  }
+
+  void wait() const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->ready.wait(lock, [this] { return state->done; });
+  }
+
+  /**
+   * @return false if the operation is still running after `timeout`
+   */
+  template <typename Rep, typename Period>
+  bool waitFor(std::chrono::duration<Rep, Period> timeout) const {
+    std::unique_lock<std::mutex> lock(state->mutex);
+    return state->ready.wait_for(lock, timeout, [this] { return state->done; });
+  }
+
+  /**
+   * @brief Wait for the result
+   * @throws Whatever the operation threw, or OperationCancelled
+   */
+  T get() const {
+    wait();
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (state->error)
+      std::rethrow_exception(state->error);
+    return *state->value;
+  }
+
+  /**
+   * @brief Ask the operation to stop; it still completes, with
+   *        OperationCancelled or whatever it had achieved
+   */
+  void cancel() const { state->cancel.cancel(); }
+
+  const CancelToken &token() const { return state->cancel; }
+
+  /**
+   * @brief Call fn(*this) once the operation completes
+   *
+   * Runs on the worker that completes it, or right away if it already
+   * has; keep it short.
+   */
+  void then(std::function<void(const Operation &)> fn) const {
+    Operation self = *this;
+    std::function<void()> call = [self, fn]() { fn(self); };
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (!state->done) {
+        state->continuations.push_back(std::move(call));
+        return;
+      }
+    }
+    call();
+  }
+
+  /**
+   * @brief Call fn(*this) on `loop`'s thread once the operation completes
+   */
+  void then(EventLoop &loop, std::function<void(const Operation &)> fn) const {
+    then([&loop, fn](const Operation &op) {
+      loop.post([fn, op]() { fn(op); });
+    });
+  }
+};
+
+/**
+ * @brief Producer side of an Operation
+ *
+ * Whoever runs the work completes it exactly once. A promise destroyed
+ * without completing, e.g. because its queued task was dropped, completes
+ * the operation with OperationCancelled, so waiters never hang.
+ */
+template <typename T> class Promise {
+private:
+  std::shared_ptr<typename Operation<T>::State> state =
+      std::make_shared<typename Operation<T>::State>();
+
+  void complete(std::optional<T> value, std::exception_ptr error) {
+    std::vector<std::function<void()>> continuations;
+    {
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (state->done)
+        return;
+      state->value = std::move(value);
+      state->error = error;
+      state->done = true;
+      continuations.swap(state->continuations);
+    }
+    state->ready.notify_all();
+    for (auto &c : continuations)
+      c();
+  }
+
+public:
+  Promise() = default;
+  Promise(const Promise &) = delete;
+  Promise &operator=(const Promise &) = delete;
+
+  ~Promise() { setError(std::make_exception_ptr(OperationCancelled())); }
+
+  Operation<T> operation() const { return Operation<T>(state); }
+
+  const CancelToken &token() const { return state->cancel; }
+
+  void setValue(T value) { complete(std::move(value), nullptr); }
+
+  void setError(std::exception_ptr error) { complete(std::nullopt, error); }
+
+  /**
+   * @brief Run fn(token) and complete with its result or exception
+   */
+  template <typename Fn> void run(Fn &&fn) {
+    if (state->cancel.isCancelled()) {
+      setError(std::make_exception_ptr(OperationCancelled()));
+      return;
+    }
+    try {
+      setValue(fn(state->cancel));
+    } catch (...) {
+      setError(std::current_exception());
+    }
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_OPERATION_H
@@ -0,0 +1,237 @@
+#ifndef TOOTHDROID_SCAN_COALESCER_H
+#define TOOTHDROID_SCAN_COALESCER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "BluetoothDevice.h"
+#include "MacAddress.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Receives device events while BluetoothManager::scanDevices() runs
+ *
+ * Added fires when a device is first seen (possibly with only MAC and name),
+ * Updated when more of its properties become known, Removed when BlueZ
+ * drops it.
+ */
+class ScanObserver {
+public:
+  virtual ~ScanObserver() = default;
+  virtual void onDeviceAdded(const BluetoothDevice &device) { (void)device; }
+  virtual void onDeviceUpdated(const BluetoothDevice &device) { (void)device; }
+  virtual void onDeviceRemoved(MacAddress mac) { (void)mac; }
+};
+
+/**
+ * @brief ScanObserver that batches events into at most one delivery per
+ *        display frame
+ *
+ * In a dense BLE environment discovery events arrive hundreds of times a
+ * second, mostly RSSI updates for devices already shown. Events are kept
+ * per device until the next flush, where `sink` gets one call per device
+ * with its latest state: an update folded into a pending add or update is
+ * merged, and a device added and removed within one frame is dropped
+ * without the sink ever hearing of it.
+ *
+ * Events may come from any thread. flush() calls the sink on the calling
+ * thread, so a GUI drains from a frame timer on its own thread while a
+ * terminal renderer calls flushIfDue() from the scanning loop.
+ */
+class ScanCoalescer : public ScanObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  static constexpr std::chrono::milliseconds DEFAULT_FRAME{16}; // ~60 Hz
+
+  // Once flushed, received == delivered + merged + dropped
+  struct Stats {
+    size_t received = 0;  // Events handed to the coalescer
+    size_t delivered = 0; // Calls made on the sink
+    size_t merged = 0;    // Events folded into another that was delivered
+    size_t dropped = 0;   // Events that cancelled out before a flush
+    size_t flushes = 0;   // Flushes that delivered anything
+  };
+
+private:
+  enum class Kind { None, Added, Updated, Removed };
+
+  struct Pending {
+    Kind kind = Kind::None;
+    BluetoothDevice device; // Latest state; only the MAC for Removed
+    size_t events = 0;      // Received events this entry stands for
+  };
+
+  ScanObserver &sink;
+  std::chrono::milliseconds frame;
+  Clock::time_point lastFlush{};
+  // Arrival order, so rows appear in the order devices were seen
+  std::vector<Pending> pending;
+  std::unordered_map<MacAddress, size_t> pendingIndex;
+  Stats stats;
+  std::mutex mutex;
+
+  void record(Kind kind, const BluetoothDevice &device) {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.received++;
+    auto it = pendingIndex.find(device.macAddress);
+    if (it == pendingIndex.end()) {
+      pendingIndex[device.macAddress] = pending.size();
+      pending.push_back({kind, device, 1});
+      return;
+    }
+
+    Pending &entry = pending[it->second];
+    entry.events++;
+    if (entry.kind == Kind::None) {
+      // Cancelled earlier in this frame; start over
+      entry.kind = kind;
+      entry.device = device;
+      entry.events = 1;
+      return;
+    }
+    if (kind == Kind::Removed && entry.kind == Kind::Added) {
+      // The sink never saw it, so it need not hear of it at all
+      stats.dropped += entry.events;
+      entry.kind = Kind::None;
+      entry.events = 0;
+      return;
+    }
+
+    if (kind == Kind::Removed) {
+      entry.kind = Kind::Removed;
+    } else if (entry.kind == Kind::Removed) {
+      // Gone and back within a frame: the sink still has its row
+      entry.kind = Kind::Updated;
+    } else if (entry.kind == Kind::Updated && kind == Kind::Added) {
+      entry.kind = Kind::Updated;
+    }
+    entry.device = device;
+  }
+
+public:
+  explicit ScanCoalescer(ScanObserver &sink,
+                         std::chrono::milliseconds frame = DEFAULT_FRAME)
+      : sink(sink), frame(frame) {}
+
+  /**
+   * @brief Frame from TOOTHDROID_FRAME_MS if set, otherwise `fallback`
+   */
+  static std::chrono::milliseconds
+  frameFromEnvironment(std::chrono::milliseconds fallback = DEFAULT_FRAME) {
+    const char *value = std::getenv("TOOTHDROID_FRAME_MS");
+    if (!value)
+      return fallback;
+    int ms = std::atoi(value);
+    return ms >= 0 ? std::chrono::milliseconds(ms) : fallback;
+  }
+
+  void onDeviceAdded(const BluetoothDevice &device) override {
+    record(Kind::Added, device);
+  }
+  void onDeviceUpdated(const BluetoothDevice &device) override {
+    record(Kind::Updated, device);
+  }
+  void onDeviceRemoved(MacAddress mac) override {
+    BluetoothDevice device;
+    device.macAddress = mac;
+    record(Kind::Removed, device);
+  }
+
+  /**
+   * @brief Minimum time between two flushes; zero passes events through
+   *        on every flushIfDue()
+   */
+  void setFrame(std::chrono::milliseconds value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    frame = value;
+  }
+
+  std::chrono::milliseconds getFrame() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frame;
+  }
+
+  /**
+   * @brief Time until flushIfDue() would deliver; max() if nothing waits
+   */
+  Clock::duration untilDue() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (pending.empty())
+      return Clock::duration::max();
+    auto due = lastFlush + frame;
+    auto now = Clock::now();
+    return due > now ? due - now : Clock::duration::zero();
+  }
+
+  /**
+   * @brief Deliver everything pending to the sink now
+   * @return Number of sink calls made
+   */
+  size_t flush() {
+    std::vector<Pending> batch;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      lastFlush = Clock::now();
+      batch.swap(pending);
+      pendingIndex.clear();
+    }
+
+    // Outside the lock: the sink may be slow, and events keep coming
+    size_t delivered = 0;
+    size_t merged = 0;
+    for (const auto &entry : batch) {
+      switch (entry.kind) {
+      case Kind::Added:
+        sink.onDeviceAdded(entry.device);
+        break;
+      case Kind::Updated:
+        sink.onDeviceUpdated(entry.device);
+        break;
+      case Kind::Removed:
+        sink.onDeviceRemoved(entry.device.macAddress);
+        break;
+      case Kind::None:
+        continue;
+      }
+      delivered++;
+      merged += entry.events - 1;
+    }
+
+    if (delivered > 0) {
+      std::lock_guard<std::mutex> lock(mutex);
+      stats.delivered += delivered;
+      stats.merged += merged;
+      stats.flushes++;
+    }
+    return delivered;
+  }
+
+  /**
+   * @brief flush() if a frame has passed since the last one
+   */
+  size_t flushIfDue() {
+    if (untilDue() > Clock::duration::zero())
+      return 0;
+    return flush();
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+
+  void resetStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stats = Stats();
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_SCAN_COALESCER_H
@@ -0,0 +1,308 @@
+#ifndef TOOTHDROID_SCAN_CONTROLLER_H
+#define TOOTHDROID_SCAN_CONTROLLER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "BluetoothManager.h"
+#include "CancelToken.h"
+#include "ScanCoalescer.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Runs scans on a thread of its own, which can be stopped, restarted
+ *        and extended while they run
+ *
+ * A one-shot scan runs for one window. In continuous mode windows repeat
+ * with an idle pause between them, so the radio is not discovering all the
+ * time, until stop() is called.
+ *
+ * Scan events are forwarded to `sink` as they happen. Over a continuous
+ * scan, devices BlueZ still remembers but that have not advertised for
+ * `maxAge` are aged out: the sink is told they were removed and they are
+ * left out of results until they are heard again. Paired and connected
+ * devices are never aged out.
+ *
+ * Callbacks run on the controller's thread. stop() and start() return at
+ * once. shutdown() and the destructor wait for the scan to notice its
+ * CancelToken (Deadline::CANCEL_POLL) and stop discovery, one short backend
+ * request; a cancelled scan skips its closing device snapshot.
+ */
+class ScanController : private ScanObserver {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  enum class State {
+    Idle,     // Not scanning
+    Scanning, // A scan window is open
+    Waiting   // Continuous mode, between two windows
+  };
+
+  struct Options {
+    std::chrono::seconds window{8};  // Length of each scan
+    std::chrono::seconds idle{0};    // Pause between windows (continuous)
+    std::chrono::seconds maxAge{60}; // Continuous only; 0 keeps every device
+    bool continuous = false;
+  };
+
+  // `complete` is false for a window that stop() or shutdown() cut short:
+  // `devices` then only holds what was heard, not every device BlueZ knows
+  using FinishedCallback = std::function<void(
+      const std::vector<BluetoothDevice> &devices, bool complete)>;
+  using ErrorCallback = std::function<void(const std::string &error)>;
+  using StateCallback = std::function<void(State state)>;
+
+private:
+  BluetoothManager &manager;
+  ScanObserver &sink;
+  FinishedCallback onFinished;
+  ErrorCallback onError;
+  StateCallback onStateChanged;
+
+  // Shared with callers, under `mutex`
+  Options options;
+  State state = State::Idle;
+  bool pending = false;  // start() asked for a new run
+  bool stopping = false; // stop() asked the current run to end
+  bool quitting = false; // shutdown() is waiting
+  CancelToken cancel;    // Current scan window
+  std::optional<ScanWindow> window;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+
+  // Aging, only touched on the controller thread
+  std::unordered_map<MacAddress, Clock::time_point> lastHeard;
+  std::unordered_set<MacAddress> aged; // Removed from the sink by aging
+
+  std::thread worker;
+
+  // Held by the caller
+  void enter(State next, std::unique_lock<std::mutex> &lock) {
+    if (state == next)
+      return;
+    state = next;
+    if (quitting || !onStateChanged)
+      return;
+    lock.unlock();
+    onStateChanged(next);
+    lock.lock();
+  }
+
+  // Aged devices stay hidden until age() sees they were heard, since the
+  // scan's closing snapshot reports remembered devices too
+  void onDeviceAdded(const BluetoothDevice &device) override {
+    if (!aged.count(device.macAddress))
+      sink.onDeviceAdded(device);
+  }
+  void onDeviceUpdated(const BluetoothDevice &device) override {
+    if (!aged.count(device.macAddress))
+      sink.onDeviceUpdated(device);
+  }
+  void onDeviceRemoved(MacAddress mac) override {
+    lastHeard.erase(mac);
+    if (aged.erase(mac) == 0)
+      sink.onDeviceRemoved(mac);
+  }
+
+  /**
+   * @brief Age out devices not heard within maxAge and bring back aged
+   *        ones that were; a zero maxAge brings back all of them
+   * @return `devices` without the aged ones
+   */
+  std::vector<BluetoothDevice>
+  age(const std::vector<BluetoothDevice> &devices,
+      const std::vector<MacAddress> &heard, std::chrono::seconds maxAge) {
+    auto now = Clock::now();
+    std::unordered_set<MacAddress> heardNow(heard.begin(), heard.end());
+    for (const auto &mac : heard)
+      lastHeard[mac] = now;
+
+    std::vector<BluetoothDevice> kept;
+    kept.reserve(devices.size());
+    for (const auto &device : devices) {
+      const MacAddress &mac = device.macAddress;
+      // A remembered device starts its clock when first listed
+      auto heardAt = lastHeard.emplace(mac, now).first->second;
+      bool exempt = device.isPaired || device.isConnected;
+
+      if (aged.count(mac)) {
+        if (!exempt && !heardNow.count(mac) && maxAge.count() > 0)
+          continue;
+        aged.erase(mac);
+        sink.onDeviceAdded(device);
+      } else if (!exempt && maxAge.count() > 0 && now - heardAt > maxAge) {
+        aged.insert(mac);
+        sink.onDeviceRemoved(mac);
+        continue;
+      }
+      kept.push_back(device);
+    }
+    return kept;
+  }
+
+  // One window; false if the scan failed
+  bool scanOnce(const ScanWindow &scanWindow, const CancelToken &token,
+                std::chrono::seconds maxAge) {
+    std::vector<BluetoothDevice> devices;
+    manager.addObserver(this);
+    try {
+      devices = manager.scanDevices(scanWindow, token);
+    } catch (const std::exception &e) {
+      manager.removeObserver(this);
+      if (!isQuitting() && onError)
+        onError(e.what());
+      return false;
+    }
+    manager.removeObserver(this);
+
+    auto kept = age(devices, manager.getLastScanStats().heard, maxAge);
+    if (!isQuitting() && onFinished)
+      onFinished(kept, !token.isCancelled());
+    return true;
+  }
+
+  bool isQuitting() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return quitting;
+  }
+
+  void run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      wakeup.wait(lock, [this] { return quitting || pending; });
+      if (quitting)
+        return;
+      pending = false;
+      stopping = false;
+      Options current = options;
+
+      while (true) {
+        cancel = CancelToken::create();
+        window.emplace(current.window);
+        CancelToken token = cancel;
+        ScanWindow scanWindow = *window;
+        enter(State::Scanning, lock);
+        lock.unlock();
+        bool ok = scanOnce(scanWindow, token,
+                           current.continuous ? current.maxAge
+                                              : std::chrono::seconds(0));
+        lock.lock();
+        window.reset();
+
+        if (!ok || !current.continuous || stopping || pending || quitting)
+          break;
+        if (current.idle.count() > 0) {
+          enter(State::Waiting, lock);
+          wakeup.wait_for(lock, current.idle, [this] {
+            return quitting || pending || stopping;
+          });
+          if (stopping || pending || quitting)
+            break;
+        }
+      }
+      // A restart goes straight into its first window
+      if (!pending)
+        enter(State::Idle, lock);
+    }
+  }
+
+public:
+  ScanController(BluetoothManager &manager, ScanObserver &sink)
+      : manager(manager), sink(sink) {}
+
+  ScanController(const ScanController &) = delete;
+  ScanController &operator=(const ScanController &) = delete;
+
+  ~ScanController() { shutdown(); }
+
+  /**
+   * @brief Set before the first start(); callbacks run on the controller
+   *        thread
+   */
+  void setOnFinished(FinishedCallback callback) {
+    onFinished = std::move(callback);
+  }
+  void setOnError(ErrorCallback callback) { onError = std::move(callback); }
+  void setOnStateChanged(StateCallback callback) {
+    onStateChanged = std::move(callback);
+  }
+
+  /**
+   * @brief Start scanning; a scan already running is cut short and started
+   *        over with the new options
+   */
+  void start(const Options &scanOptions) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (quitting)
+      return;
+    options = scanOptions;
+    pending = true;
+    cancel.cancel();
+    if (!worker.joinable())
+      worker = std::thread(&ScanController::run, this);
+    wakeup.notify_all();
+  }
+
+  /**
+   * @brief End the current window and leave continuous mode
+   *
+   * Returns at once; the scan reports what it has heard so far through the
+   * finished callback once discovery is stopped, without the full details
+   * a completed window fetches.
+   */
+  void stop() {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    cancel.cancel();
+    wakeup.notify_all();
+  }
+
+  /**
+   * @brief Keep the open scan window open `more` longer
+   * @return false if no window is open
+   */
+  bool extend(std::chrono::seconds more) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!window || stopping)
+      return false;
+    window->extend(more);
+    return true;
+  }
+
+  State getState() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return state;
+  }
+
+  /**
+   * @brief Whether a window is open or a continuous scan is between two
+   */
+  bool isActive() { return getState() != State::Idle; }
+
+  /**
+   * @brief Cancel any scan and wait for the thread, without callbacks
+   */
+  void shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      quitting = true;
+      cancel.cancel();
+      wakeup.notify_all();
+    }
+    if (worker.joinable())
+      worker.join();
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_SCAN_CONTROLLER_H
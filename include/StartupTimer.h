@@ -0,0 +1,119 @@
+#ifndef TOOTHDROID_STARTUP_TIMER_H
+#define TOOTHDROID_STARTUP_TIMER_H
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace ToothDroid {
+
+/**
+ * @brief Milestones of application startup, measured from process start
+ *
+ * The kernel's start time for this process is read from /proc, so time
+ * spent in the dynamic loader and static initialisers before main() is
+ * counted too. Without /proc, timing starts when the timer is created.
+ */
+class StartupTimer {
+public:
+  using Clock = std::chrono::steady_clock;
+
+private:
+  Clock::time_point processStart;
+  std::vector<std::pair<std::string, Clock::time_point>> marks;
+
+  /**
+   * @brief How long ago the kernel started this process; zero if unknown
+   *
+   * /proc/self/stat has it in clock ticks since boot (field 22), which
+   * CLOCK_BOOTTIME is measured against too.
+   */
+  static Clock::duration processAge() {
+    std::ifstream file("/proc/self/stat");
+    std::string stat;
+    if (!std::getline(file, stat))
+      return Clock::duration::zero();
+    // The command name may contain spaces; fields are counted after it
+    size_t close = stat.rfind(')');
+    if (close == std::string::npos)
+      return Clock::duration::zero();
+    std::istringstream fields(stat.substr(close + 1));
+    std::string field;
+    for (int i = 3; i <= 22 && fields >> field; i++) {
+    }
+    long ticksPerSecond = sysconf(_SC_CLK_TCK);
+    timespec now{};
+    if (field.empty() || ticksPerSecond <= 0 ||
+        clock_gettime(CLOCK_BOOTTIME, &now) != 0)
+      return Clock::duration::zero();
+
+    double started = std::stod(field) / ticksPerSecond;
+    double age = now.tv_sec + now.tv_nsec / 1e9 - started;
+    if (age <= 0)
+      return Clock::duration::zero();
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(age));
+  }
+
+public:
+  StartupTimer() : processStart(Clock::now() - processAge()) {}
+
+  /**
+   * @brief Record that `stage` was reached now
+   * @return false if it was already recorded; the first time counts
+   */
+  bool mark(const std::string &stage) {
+    if (reached(stage))
+      return false;
+    marks.emplace_back(stage, Clock::now());
+    return true;
+  }
+
+  bool reached(const std::string &stage) const {
+    for (const auto &m : marks) {
+      if (m.first == stage)
+        return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Time from process start to `stage`; -1 if not reached
+   */
+  std::chrono::milliseconds elapsed(const std::string &stage) const {
+    for (const auto &m : marks) {
+      if (m.first == stage)
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            m.second - processStart);
+    }
+    return std::chrono::milliseconds(-1);
+  }
+
+  /**
+   * @brief One line per stage, in the order they were reached
+   */
+  std::string report() const {
+    std::string out;
+    char line[96];
+    for (const auto &m : marks) {
+      double ms =
+          std::chrono::duration<double, std::milli>(m.second - processStart)
+              .count();
+      std::snprintf(line, sizeof(line), "  %-24s %8.1f ms\n", m.first.c_str(),
+                    ms);
+      out += line;
+    }
+    return out;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_STARTUP_TIMER_H
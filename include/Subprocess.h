@@ -0,0 +1,266 @@
+#ifndef TOOTHDROID_SUBPROCESS_H
+#define TOOTHDROID_SUBPROCESS_H
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "CancelToken.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Output and fate of a command run with runProcess()
+ */
+struct CommandResult {
+  std::string output;
+  std::string errorOutput; // Only with StderrMode::Capture
+  int exitStatus = -1;     // Exit code, or -1 if it did not exit normally
+  bool started = false;    // false if the program could not be started
+  bool timedOut = false;
+  bool cancelled = false;
+
+  bool ok() const { return exitStatus == 0; }
+};
+
+/**
+ * @brief Where a child's stderr goes
+ */
+enum class StderrMode {
+  Merge,   // Into CommandResult::output, like "2>&1"
+  Capture, // Into CommandResult::errorOutput
+  Discard, // To /dev/null
+  Inherit  // To our own stderr
+};
+
+namespace detail {
+
+// Pipes hold 64 KiB on Linux; one read can drain a full one
+constexpr size_t READ_CHUNK = 64 * 1024;
+
+/**
+ * @brief Wait for `pid` until `deadline`
+ * @return true if it was reaped
+ */
+inline bool reapBy(pid_t pid, int &status,
+                   std::chrono::steady_clock::time_point deadline) {
+  // A child that just closed its pipes is usually gone within microseconds,
+  // so start polling fast and back off to 5 ms
+  std::chrono::microseconds nap{50};
+  while (true) {
+    pid_t r = waitpid(pid, &status, WNOHANG);
+    if (r == pid || (r < 0 && errno != EINTR))
+      return true;
+    if (std::chrono::steady_clock::now() >= deadline)
+      return false;
+    std::this_thread::sleep_for(nap);
+    nap = std::min(nap * 2, std::chrono::microseconds(5000));
+  }
+}
+
+/**
+ * @brief read() straight into the unused tail of `into`
+ *
+ * Capacity grows geometrically, so large outputs are neither copied
+ * through a bounce buffer nor reallocated per chunk.
+ */
+inline ssize_t readAppend(int fd, std::string &into) {
+  size_t used = into.size();
+  if (into.capacity() - used < READ_CHUNK)
+    into.reserve(std::max(into.capacity() * 2, used + READ_CHUNK));
+  into.resize(into.capacity());
+  ssize_t n = read(fd, &into[used], into.size() - used);
+  into.resize(used + (n > 0 ? static_cast<size_t>(n) : 0));
+  return n;
+}
+
+} // namespace detail
+
+/**
+ * @brief Start argv[0], searched in PATH, in a new process group
+ *
+ * No shell is involved, so arguments need no quoting.
+ * @param out Descriptor for the child's stdout; -1 for /dev/null
+ * @param err Descriptor for its stderr; -1 for /dev/null
+ * @param in  Descriptor for its stdin; -1 for /dev/null
+ * @return Child pid, or -1 if the program could not be started
+ */
+inline pid_t spawnProcess(const std::vector<std::string> &argv, int out,
+                          int err, int in = -1) {
+  if (argv.empty())
+    return -1;
+  std::vector<char *> args;
+  args.reserve(argv.size() + 1);
+  for (const auto &a : argv)
+    args.push_back(const_cast<char *>(a.c_str()));
+  args.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawnattr_t attr;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawnattr_init(&attr);
+  if (in >= 0)
+    posix_spawn_file_actions_adddup2(&actions, in, STDIN_FILENO);
+  else
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                     O_RDONLY, 0);
+  if (out >= 0)
+    posix_spawn_file_actions_adddup2(&actions, out, STDOUT_FILENO);
+  else
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+  if (err >= 0)
+    posix_spawn_file_actions_adddup2(&actions, err, STDERR_FILENO);
+  else
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null",
+                                     O_WRONLY, 0);
+  // Own group, so terminateChild() also reaches anything it starts
+  posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+  posix_spawnattr_setpgroup(&attr, 0);
+
+  pid_t pid = -1;
+  int rc = posix_spawnp(&pid, args[0], &actions, &attr, args.data(), environ);
+  posix_spawnattr_destroy(&attr);
+  posix_spawn_file_actions_destroy(&actions);
+  return rc == 0 ? pid : -1;
+}
+
+/**
+ * @brief SIGTERM a child, SIGKILL it after Deadline::KILL_GRACE, reap it
+ * @param group Signal the child's whole process group
+ */
+inline void terminateChild(pid_t pid, int &status, bool group) {
+  pid_t target = group ? -pid : pid;
+  kill(target, SIGTERM);
+  if (detail::reapBy(pid, status,
+                     std::chrono::steady_clock::now() + Deadline::KILL_GRACE))
+    return;
+  kill(target, SIGKILL);
+  while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+  }
+}
+
+/**
+ * @brief Run argv[0] with arguments `argv`, reading its output until it
+ *        exits
+ *
+ * The read never blocks past `timeout` or a cancellation: the child runs in
+ * its own process group, which gets SIGTERM and then SIGKILL, so
+ * grandchildren such as a hung bluetoothctl go too.
+ */
+inline CommandResult runProcess(const std::vector<std::string> &argv,
+                                std::chrono::milliseconds timeout,
+                                const CancelToken &cancel = CancelToken(),
+                                StderrMode stderrMode = StderrMode::Merge) {
+  CommandResult result;
+  int out[2];
+  int err[2] = {-1, -1};
+  if (pipe2(out, O_CLOEXEC) != 0)
+    return result;
+  if (stderrMode == StderrMode::Capture && pipe2(err, O_CLOEXEC) != 0) {
+    close(out[0]);
+    close(out[1]);
+    return result;
+  }
+
+  int childErr = -1;
+  if (stderrMode == StderrMode::Merge)
+    childErr = out[1];
+  else if (stderrMode == StderrMode::Capture)
+    childErr = err[1];
+  else if (stderrMode == StderrMode::Inherit)
+    childErr = STDERR_FILENO;
+
+  pid_t pid = spawnProcess(argv, out[1], childErr);
+  close(out[1]);
+  if (err[1] >= 0)
+    close(err[1]);
+  if (pid < 0) {
+    close(out[0]);
+    if (err[0] >= 0)
+      close(err[0]);
+    return result;
+  }
+  result.started = true;
+
+  pollfd fds[2] = {{out[0], POLLIN, 0}, {err[0], POLLIN, 0}};
+  std::string *sinks[2] = {&result.output, &result.errorOutput};
+  nfds_t watched = err[0] >= 0 ? 2 : 1;
+  auto deadline = std::chrono::steady_clock::now() + timeout;
+  while (fds[0].fd >= 0 || fds[1].fd >= 0) {
+    if (cancel.isCancelled()) {
+      result.cancelled = true;
+      break;
+    }
+    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    if (remaining.count() <= 0) {
+      result.timedOut = true;
+      break;
+    }
+    if (cancel.canBeCancelled() && remaining > Deadline::CANCEL_POLL)
+      remaining = Deadline::CANCEL_POLL;
+
+    // poll() skips negative descriptors, so closed ones stay in place
+    int ready = poll(fds, watched, static_cast<int>(remaining.count()));
+    if (ready < 0 && errno != EINTR)
+      break;
+    if (ready <= 0)
+      continue;
+    for (nfds_t i = 0; i < watched; i++) {
+      if (fds[i].fd < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+        continue;
+      ssize_t n = detail::readAppend(fds[i].fd, *sinks[i]);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        close(fds[i].fd);
+        fds[i].fd = -1;
+      }
+    }
+  }
+  bool eof = fds[0].fd < 0 && fds[1].fd < 0;
+  for (auto &p : fds) {
+    if (p.fd >= 0)
+      close(p.fd);
+  }
+
+  // The pipes can close before the process exits; the deadline still holds
+  int status = 0;
+  if (!eof || !detail::reapBy(pid, status, deadline)) {
+    if (eof)
+      result.timedOut = true;
+    terminateChild(pid, status, true);
+    return result;
+  }
+  if (WIFEXITED(status))
+    result.exitStatus = WEXITSTATUS(status);
+  return result;
+}
+
+/**
+ * @brief Run `cmd` through /bin/sh -c, for when shell syntax is needed
+ *
+ * Costs an extra exec over runProcess(); stderr is inherited.
+ */
+inline CommandResult runCommand(const std::string &cmd,
+                                std::chrono::milliseconds timeout,
+                                const CancelToken &cancel = CancelToken()) {
+  return runProcess({"/bin/sh", "-c", cmd}, timeout, cancel,
+                    StderrMode::Inherit);
+}
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_SUBPROCESS_H
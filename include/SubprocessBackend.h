@@ -0,0 +1,554 @@
+#ifndef TOOTHDROID_SUBPROCESS_BACKEND_H
+#define TOOTHDROID_SUBPROCESS_BACKEND_H
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "BluetoothBackend.h"
+#include "BluetoothctlParser.h"
+#include "BluetoothctlSession.h"
+#include "Subprocess.h"
+#include "WorkerPool.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Run a program and capture its stdout and stderr
+ *
+ * Output gathered before a timeout or cancellation is still returned.
+ * Non-zero exit codes are not errors here; some commands use them for
+ * normal conditions.
+ * @throws BluetoothException if the program could not be started
+ */
+inline std::string executeCommand(const std::vector<std::string> &argv,
+                                  std::chrono::milliseconds timeout =
+                                      Deadline::TOOL,
+                                  const CancelToken &cancel = CancelToken()) {
+  CommandResult result = runProcess(argv, timeout, cancel);
+  if (!result.started) {
+    throw BluetoothException("Failed to execute command: " +
+                             (argv.empty() ? std::string() : argv[0]));
+  }
+  return std::move(result.output);
+}
+
+/**
+ * @brief argv for a one-shot `bluetoothctl <args>`
+ *
+ * Commands are typed as at the interactive prompt; none of them take
+ * arguments with spaces, so splitting on whitespace is enough.
+ */
+inline std::vector<std::string> bluetoothctlArgv(const std::string &args) {
+  std::vector<std::string> argv{bluetoothctlPath()};
+  std::istringstream words(args);
+  std::string word;
+  while (words >> word)
+    argv.push_back(word);
+  return argv;
+}
+
+/**
+ * @brief Backend that scrapes bluetoothctl output
+ *
+ * Commands go through one persistent interactive bluetoothctl session; if it
+ * cannot be started, each command falls back to a one-shot invocation.
+ */
+class SubprocessBackend : public BluetoothBackend {
+private:
+  mutable BluetoothctlSession session;
+  AdapterCallback adapterListener;
+  DiscoveryCallback deviceListener;
+
+  // Device events the session queued, kept while discovering
+  mutable std::mutex eventsMutex;
+  mutable std::vector<DiscoveryEvent> pendingEvents;
+  mutable bool discovering = false;
+  pid_t scanChild = -1; // Without a session: the scanning bluetoothctl
+  // Seconds that scanning bluetoothctl may outlive us
+  static constexpr const char *SCAN_CHILD_TIMEOUT = "600";
+
+  // One-shot `info` fetches run on this pool when there is no session
+  size_t fetchParallelism = 4;
+  std::shared_ptr<WorkerPool> fetchPool;
+  std::mutex fetchPoolMutex;
+
+  /**
+   * @brief The fetch pool, resized if the parallelism changed
+   *
+   * Shared, so a caller still mapping over the old pool keeps it alive
+   * while another thread replaces it.
+   */
+  std::shared_ptr<WorkerPool> pool() {
+    std::lock_guard<std::mutex> lock(fetchPoolMutex);
+    if (!fetchPool || fetchPool->size() != fetchParallelism)
+      fetchPool = std::make_shared<WorkerPool>(fetchParallelism);
+    return fetchPool;
+  }
+
+  /**
+   * @brief Execute bluetoothctl command
+   * @param markers Completion strings for commands whose result arrives
+   *                after the prompt (pair, connect); ignored in one-shot mode
+   * @param timeout Also bounds a one-shot bluetoothctl, which is killed
+   */
+  std::string bluetoothctl(const std::string &args,
+                           const std::vector<std::string> &markers = {},
+                           std::chrono::milliseconds timeout = Deadline::QUERY,
+                           const CancelToken &cancel = CancelToken()) const {
+    if (session.isRunning()) {
+      std::string output = session.command(args, markers, timeout, cancel);
+      routeEvents(session.takeEvents());
+      return output;
+    }
+    return executeCommand(bluetoothctlArgv(args), timeout, cancel);
+  }
+
+  /**
+   * @brief End the one-shot scan, if any; BlueZ stops a discovery once the
+   *        client that started it is gone
+   */
+  void endScanChild() {
+    pid_t pid;
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      pid = scanChild;
+      scanChild = -1;
+    }
+    if (pid > 0) {
+      int status;
+      terminateChild(pid, status, true);
+    }
+  }
+
+  /**
+   * @brief Hand event lines the session set aside to discovery, or else
+   *        to the device or adapter listener
+   */
+  void routeEvents(const std::vector<std::string> &lines) const {
+    DiscoveryEvent event;
+    for (const auto &line : lines) {
+      if (parseEventLine(line, event)) {
+        {
+          std::lock_guard<std::mutex> lock(eventsMutex);
+          if (discovering) {
+            pendingEvents.push_back(event);
+            continue;
+          }
+        }
+        if (deviceListener)
+          deviceListener(event);
+      } else {
+        reportAdapterChanges(line);
+      }
+    }
+  }
+
+  /**
+   * @brief Pass "[CHG] Controller <mac> Powered: no" lines to the listener
+   *
+   * The session prints these whenever the adapter changes, interleaved
+   * with whatever command or scan output is being read.
+   */
+  void reportAdapterChanges(std::string_view output) const {
+    static constexpr std::string_view tag = "[CHG] Controller ";
+    if (!adapterListener || output.find(tag) == std::string_view::npos)
+      return;
+    Bluetoothctl::LineReader reader(output);
+    std::string_view line;
+    while (reader.next(line)) {
+      size_t pos = line.find(tag);
+      if (pos == std::string_view::npos)
+        continue;
+      std::string_view rest = line.substr(pos + tag.size());
+      if (!Bluetoothctl::startsWithMac(rest) || rest.size() < 18)
+        continue;
+      rest = Bluetoothctl::trimLeft(rest.substr(17));
+      size_t colon = rest.find(':');
+      if (colon == std::string_view::npos || colon == 0)
+        continue;
+      adapterListener(rest.substr(0, colon),
+                      Bluetoothctl::trimLeft(rest.substr(colon + 1)));
+    }
+  }
+
+  /**
+   * @brief Parse "[NEW] Device <mac> <name>", "[CHG] Device <mac> RSSI: -60"
+   *        (or Name, Connected, Paired) and "[DEL] Device <mac> <name>" lines
+   */
+  static bool parseEventLine(const std::string &line, DiscoveryEvent &event) {
+    static const std::string devicePrefix = " Device ";
+    event = DiscoveryEvent();
+    const size_t tagLength = 5; // "[NEW]"
+    if (line.size() < tagLength + devicePrefix.size() + 17 ||
+        line.compare(tagLength, devicePrefix.size(), devicePrefix) != 0)
+      return false;
+
+    if (line.rfind("[NEW]", 0) == 0) {
+      event.type = DiscoveryEvent::Type::Added;
+    } else if (line.rfind("[CHG]", 0) == 0) {
+      event.type = DiscoveryEvent::Type::Changed;
+    } else if (line.rfind("[DEL]", 0) == 0) {
+      event.type = DiscoveryEvent::Type::Removed;
+    } else {
+      return false;
+    }
+
+    size_t macStart = tagLength + devicePrefix.size();
+    event.mac =
+        MacAddress::fromString(std::string_view(line).substr(macStart, 17));
+    std::string rest =
+        line.size() > macStart + 18 ? line.substr(macStart + 18) : "";
+
+    if (event.type != DiscoveryEvent::Type::Changed) {
+      event.name = rest;
+    } else if (rest.rfind("RSSI: ", 0) == 0) {
+      // Either "RSSI: -60" or "RSSI: 0xffffffc4 (-60)"
+      size_t paren = rest.find('(');
+      std::string value =
+          paren != std::string::npos ? rest.substr(paren + 1) : rest.substr(6);
+      event.rssi = static_cast<int16_t>(std::atoi(value.c_str()));
+    } else if (rest.rfind("Name: ", 0) == 0) {
+      event.name = rest.substr(6);
+    } else if (rest.rfind("Connected: ", 0) == 0) {
+      event.connected = rest.compare(11, 3, "yes") == 0;
+    } else if (rest.rfind("Paired: ", 0) == 0) {
+      event.paired = rest.compare(8, 3, "yes") == 0;
+    }
+    return true;
+  }
+
+  static BackendResult resultOf(std::string output,
+                                std::initializer_list<const char *> success) {
+    BackendResult result;
+    for (const char *s : success) {
+      if (output.find(s) != std::string::npos) {
+        result.ok = true;
+        break;
+      }
+    }
+    result.message = std::move(output);
+    return result;
+  }
+
+public:
+  /**
+   * @param useSession Keep a persistent bluetoothctl; false forces one
+   *                   process per command (used by the fetch benchmark)
+   * @param controller Adapter to drive; null for bluetoothctl's default
+   * @throws BluetoothException if bluetoothctl is missing, or `controller`
+   *         cannot be selected
+   */
+  explicit SubprocessBackend(bool useSession = true,
+                             MacAddress controller = MacAddress()) {
+    // Check if bluetoothctl is available
+    CommandResult version =
+        runProcess({bluetoothctlPath(), "--version"}, Deadline::TOOL);
+    if (version.output.find("bluetoothctl") == std::string::npos) {
+      throw BluetoothException("bluetoothctl not found. Please install bluez.");
+    }
+
+    // Keep one interactive bluetoothctl around for all further commands
+    if (useSession) {
+      session.start();
+    }
+
+    if (!controller.isNull()) {
+      // `select` only sticks within one interactive session
+      if (!session.isRunning()) {
+        throw BluetoothException(
+            "Choosing an adapter needs a bluetoothctl session");
+      }
+      // `select` prints nothing on success; send `show` right behind it
+      // and stop at its header instead of waiting for a reply
+      std::string address = controller.toString();
+      std::string reply =
+          session.command("select " + address + "\nshow",
+                          {"Controller " + address + " (", "not available"});
+      if (reply.find("Controller " + address + " (") == std::string::npos) {
+        throw BluetoothException("Adapter " + controller.toString() +
+                                 " not available");
+      }
+    }
+  }
+
+  ~SubprocessBackend() override { endScanChild(); }
+
+  SubprocessBackend(const SubprocessBackend &) = delete;
+  SubprocessBackend &operator=(const SubprocessBackend &) = delete;
+
+  /**
+   * @brief Number of concurrent one-shot `info` processes in
+   *        snapshotDevices() when there is no session
+   */
+  void setFetchParallelism(size_t jobs) override {
+    std::lock_guard<std::mutex> lock(fetchPoolMutex);
+    fetchParallelism = jobs > 0 ? jobs : 1;
+  }
+
+  std::string name() const override { return "bluetoothctl"; }
+
+  /**
+   * @brief Whether commands are served by the persistent session
+   */
+  bool hasSession() const { return session.isRunning(); }
+
+  BackendResult setPowered(bool on) override {
+    return resultOf(bluetoothctl(on ? "power on" : "power off"),
+                    {"succeeded"});
+  }
+
+  bool isPowered() override {
+    return adapterInfo().find("Powered: yes") != std::string::npos;
+  }
+
+  std::string adapterInfo() override { return bluetoothctl("show"); }
+
+  std::vector<ControllerInfo> listControllers() override {
+    std::vector<ControllerInfo> controllers;
+    Bluetoothctl::forEachController(
+        bluetoothctl("list"),
+        [&](std::string_view mac, std::string_view name, bool isDefault) {
+          controllers.push_back(
+              {MacAddress::fromString(mac), std::string(name), isDefault});
+        });
+    return controllers;
+  }
+
+  /**
+   * @brief Changes are only visible through the persistent session
+   */
+  bool watchAdapter(AdapterCallback onChange) override {
+    adapterListener = std::move(onChange);
+    return session.isRunning();
+  }
+
+  /**
+   * @brief Also only through the session, and only as its output is read
+   *        (by the next command)
+   */
+  bool watchDevices(DiscoveryCallback onEvent) override {
+    deviceListener = std::move(onEvent);
+    return session.isRunning();
+  }
+
+  BackendResult startDiscovery() override {
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      pendingEvents.clear();
+      discovering = true;
+    }
+    if (!session.isRunning()) {
+      // A one-shot `scan on` would exit, ending the discovery with it. This
+      // one runs until stopDiscovery(), or the timeout if we die first.
+      endScanChild();
+      auto argv = bluetoothctlArgv("scan on");
+      argv.insert(argv.begin() + 1, {"--timeout", SCAN_CHILD_TIMEOUT});
+      pid_t pid = spawnProcess(argv, -1, -1);
+      if (pid < 0)
+        return {false, "Failed to execute command: " + argv[0]};
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      scanChild = pid;
+      return {true, ""};
+    }
+
+    // Devices found right away are in the reply and queued by bluetoothctl()
+    return {true, bluetoothctl("scan on")};
+  }
+
+  BackendResult stopDiscovery() override {
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      pendingEvents.clear();
+      discovering = false;
+    }
+    if (!session.isRunning()) {
+      endScanChild();
+      return {true, "Discovery stopped"};
+    }
+    return {true, bluetoothctl("scan off")};
+  }
+
+  bool waitForEvents(std::chrono::milliseconds timeout,
+                     const DiscoveryCallback &onEvent) override {
+    bool queued;
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      queued = !pendingEvents.empty();
+    }
+    if (!queued) {
+      std::vector<std::string> lines;
+      if (!session.readLines(timeout, lines)) {
+        std::this_thread::sleep_for(timeout);
+        return false;
+      }
+      routeEvents(lines);
+    }
+
+    std::vector<DiscoveryEvent> events;
+    {
+      std::lock_guard<std::mutex> lock(eventsMutex);
+      events.swap(pendingEvents);
+    }
+    for (const auto &e : events)
+      onEvent(e);
+    return true;
+  }
+
+  std::vector<std::pair<std::string, std::string>>
+  listDevices(bool pairedOnly) override {
+    std::vector<std::pair<std::string, std::string>> devices;
+    std::string output = bluetoothctl(pairedOnly ? "paired-devices" : "devices");
+
+    // "Device XX:XX:XX:XX:XX:XX Name"
+    Bluetoothctl::forEachDevice(
+        output, [&](std::string_view mac, std::string_view name) {
+          devices.emplace_back(std::string(mac), std::string(name));
+        });
+    return devices;
+  }
+
+  /**
+   * @brief Parse device info from bluetoothctl output
+   */
+  static BluetoothDevice parseInfo(std::string_view mac,
+                                   std::string_view info) {
+    BluetoothDevice device;
+    if (Bluetoothctl::parseInfo(info, device)) {
+      device.macAddress = MacAddress::fromString(mac);
+      device.lastSeen = std::time(nullptr);
+    }
+    return device;
+  }
+
+  BluetoothDevice deviceInfo(const std::string &mac) override {
+    return parseInfo(mac, bluetoothctl("info " + mac));
+  }
+
+  /**
+   * @brief `devices` plus every `info` pipelined through the session
+   *
+   * Without a session every device needs its own bluetoothctl process; those
+   * run on a bounded worker pool, merged back in listing order.
+   */
+  std::vector<BluetoothDevice> snapshotDevices(bool pairedOnly) override {
+    auto listed = listDevices(pairedOnly);
+    std::vector<BluetoothDevice> devices;
+    devices.reserve(listed.size());
+
+    // Slices of `output`, which outlives them
+    std::string output;
+    std::unordered_map<std::string_view, std::string_view> blocks;
+    if (session.isRunning() && !listed.empty()) {
+      std::vector<std::string> commands;
+      commands.reserve(listed.size());
+      for (const auto &entry : listed)
+        commands.push_back("info " + entry.first);
+
+      output = session.commandBatch(
+          commands,
+          Deadline::QUERY + std::chrono::milliseconds(10) * listed.size());
+      routeEvents(session.takeEvents());
+
+      blocks.reserve(listed.size());
+      Bluetoothctl::forEachInfoBlock(
+          output, [&](std::string_view mac, std::string_view body) {
+            blocks[mac] = body;
+          });
+    }
+
+    if (session.isRunning()) {
+      for (const auto &entry : listed) {
+        auto block = blocks.find(entry.first);
+        devices.push_back(block != blocks.end()
+                              ? parseInfo(entry.first, block->second)
+                              : deviceInfo(entry.first));
+      }
+    } else {
+      devices = pool()->map(
+          listed, [this](const std::pair<std::string, std::string> &entry) {
+            return deviceInfo(entry.first);
+          });
+    }
+
+    // A device that went away between the two requests keeps its row
+    for (size_t i = 0; i < devices.size(); i++) {
+      if (devices[i].macAddress.isNull())
+        devices[i].macAddress = MacAddress::fromString(listed[i].first);
+      if (devices[i].name.empty()) {
+        devices[i].name = listed[i].second;
+      }
+    }
+    return devices;
+  }
+
+  BackendResult pair(const std::string &mac,
+                     const CancelToken &cancel = CancelToken()) override {
+    return resultOf(bluetoothctl("pair " + mac,
+                                 {"Pairing successful", "already paired",
+                                  "Failed to pair", "not available"},
+                                 Deadline::PAIR, cancel),
+                    {"Pairing successful", "already paired"});
+  }
+
+  BackendResult connect(const std::string &mac,
+                        const CancelToken &cancel = CancelToken()) override {
+    return resultOf(bluetoothctl("connect " + mac,
+                                 {"Connection successful", "already connected",
+                                  "Failed to connect", "not available"},
+                                 Deadline::CONNECT, cancel),
+                    {"Connection successful", "already connected"});
+  }
+
+  /**
+   * @brief bluetoothctl's bare `disconnect` only drops its default device,
+   *        so an empty `mac` disconnects each connected one in turn
+   */
+  BackendResult disconnect(const std::string &mac) override {
+    if (!mac.empty()) {
+      return resultOf(bluetoothctl("disconnect " + mac,
+                                   {"Successful disconnected",
+                                    "Failed to disconnect", "not available"},
+                                   Deadline::DISCONNECT),
+                      {"Successful disconnected", "NotConnected"});
+    }
+
+    BackendResult result{true, ""};
+    for (const auto &device : snapshotDevices(false)) {
+      if (!device.isConnected)
+        continue;
+      auto r = disconnect(device.macAddress.toString());
+      if (!r.ok)
+        result = r;
+    }
+    return result;
+  }
+
+  BackendResult remove(const std::string &mac) override {
+    return resultOf(bluetoothctl("remove " + mac), {"Device has been removed"});
+  }
+
+  BackendResult setTrusted(const std::string &mac, bool trusted) override {
+    return resultOf(bluetoothctl((trusted ? "trust " : "untrust ") + mac),
+                    {"succeeded", "already trusted"});
+  }
+
+  BackendResult setBlocked(const std::string &mac, bool blocked) override {
+    return resultOf(bluetoothctl((blocked ? "block " : "unblock ") + mac),
+                    {"succeeded"});
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_SUBPROCESS_BACKEND_H
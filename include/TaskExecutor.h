@@ -0,0 +1,256 @@
+#ifndef TOOTHDROID_TASK_EXECUTOR_H
+#define TOOTHDROID_TASK_EXECUTOR_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "CancelToken.h"
+#include "MacAddress.h"
+
+namespace ToothDroid {
+
+/**
+ * @brief Bounded task queue for device actions
+ *
+ * A fixed number of workers runs tasks from a queue of bounded depth;
+ * submitting to a full queue is refused instead of piling up threads.
+ * Tasks for the same device run one at a time in submission order, so a
+ * pair queued behind a connect for that device waits for it, while actions
+ * on other devices proceed in parallel.
+ *
+ * Queued tasks can be cancelled outright. Running tasks have their token
+ * cancelled, which the manager's pair/connect/scan calls act on within
+ * Deadline::CANCEL_POLL.
+ *
+ * Tasks are destroyed with the mutex released: a task may own a Promise,
+ * whose destructor completes it and runs its callbacks, and those may
+ * call back in here.
+ */
+class TaskExecutor {
+public:
+  using Task = std::function<void(const CancelToken &cancel)>;
+  using TaskId = uint64_t; // 0 means "not accepted"
+
+  struct Stats {
+    size_t queued = 0;    // Waiting right now
+    size_t running = 0;   // Executing right now
+    size_t maxQueued = 0; // Deepest the queue has been
+    size_t submitted = 0;
+    size_t completed = 0;
+    size_t cancelled = 0; // Dropped from the queue or flagged while running
+    size_t rejected = 0;  // Refused because the queue was full
+  };
+
+private:
+  struct Entry {
+    TaskId id;
+    MacAddress device; // Null: no ordering against other tasks
+    Task task;
+    CancelToken cancel;
+  };
+
+  struct Running {
+    MacAddress device;
+    CancelToken cancel;
+  };
+
+  std::vector<std::thread> workers;
+  std::deque<Entry> queue;
+  std::unordered_map<TaskId, Running> running;
+  std::unordered_set<MacAddress> busyDevices;
+  size_t capacity;
+  TaskId nextId = 1;
+  Stats stats;
+  bool stopping = false;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+
+  // Held by the caller, who destroys the returned tasks after unlocking
+  template <typename Pred> std::vector<Task> dropQueued(Pred pred) {
+    std::vector<Task> dropped;
+    auto kept = std::stable_partition(queue.begin(), queue.end(),
+                                      [&](const Entry &e) { return !pred(e); });
+    for (auto it = kept; it != queue.end(); ++it)
+      dropped.push_back(std::move(it->task));
+    queue.erase(kept, queue.end());
+    stats.queued = queue.size();
+    return dropped;
+  }
+
+  // First queued task whose device is not busy
+  std::deque<Entry>::iterator nextRunnable() {
+    return std::find_if(queue.begin(), queue.end(), [this](const Entry &e) {
+      return e.device.isNull() || busyDevices.count(e.device) == 0;
+    });
+  }
+
+  void workerLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+      auto it = queue.end();
+      wakeup.wait(lock, [&] {
+        if (stopping)
+          return true;
+        it = nextRunnable();
+        return it != queue.end();
+      });
+      if (stopping)
+        return;
+
+      Entry entry = std::move(*it);
+      queue.erase(it);
+      if (!entry.device.isNull())
+        busyDevices.insert(entry.device);
+      running.emplace(entry.id, Running{entry.device, entry.cancel});
+      stats.queued = queue.size();
+      stats.running = running.size();
+
+      lock.unlock();
+      try {
+        entry.task(entry.cancel);
+      } catch (...) {
+        // A failed action must not take a worker down with it
+      }
+      entry.task = nullptr;
+      lock.lock();
+
+      running.erase(entry.id);
+      if (!entry.device.isNull())
+        busyDevices.erase(entry.device);
+      stats.running = running.size();
+      stats.completed++;
+      // The next task for this device may be runnable now
+      wakeup.notify_all();
+    }
+  }
+
+public:
+  /**
+   * @param threads  Tasks that may run at once
+   * @param maxQueue Tasks that may wait; further submits are refused
+   */
+  TaskExecutor(size_t threads, size_t maxQueue)
+      : capacity(maxQueue > 0 ? maxQueue : 1) {
+    if (threads == 0)
+      threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++)
+      workers.emplace_back(&TaskExecutor::workerLoop, this);
+  }
+
+  TaskExecutor(const TaskExecutor &) = delete;
+  TaskExecutor &operator=(const TaskExecutor &) = delete;
+
+  /**
+   * @brief Drop queued tasks, flag running ones and wait for them
+   */
+  ~TaskExecutor() {
+    std::vector<Task> dropped;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+      stats.cancelled += queue.size() + running.size();
+      dropped = dropQueued([](const Entry &) { return true; });
+      for (auto &r : running)
+        r.second.cancel.cancel();
+    }
+    wakeup.notify_all();
+    dropped.clear();
+    for (auto &w : workers)
+      w.join();
+  }
+
+  /**
+   * @brief Queue a task, ordered after earlier tasks for the same device
+   * @param device Null if the task does not touch one device
+   * @param cancel Token handed to the task; cancel() and friends fire it
+   * @return Id for cancel(), or 0 if the queue is full
+   */
+  TaskId submit(MacAddress device, Task task,
+                CancelToken cancel = CancelToken::create()) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopping || queue.size() >= capacity) {
+      stats.rejected++;
+      return 0;
+    }
+    TaskId id = nextId++;
+    queue.push_back({id, device, std::move(task), std::move(cancel)});
+    stats.submitted++;
+    stats.queued = queue.size();
+    stats.maxQueued = std::max(stats.maxQueued, stats.queued);
+    wakeup.notify_all();
+    return id;
+  }
+
+  /**
+   * @brief Drop a queued task, or ask a running one to stop
+   * @return false if the task already finished
+   */
+  bool cancel(TaskId id) {
+    std::vector<Task> dropped; // Destroyed after the lock is released
+    std::lock_guard<std::mutex> lock(mutex);
+    dropped = dropQueued([id](const Entry &e) { return e.id == id; });
+    if (!dropped.empty()) {
+      stats.cancelled++;
+      return true;
+    }
+    auto r = running.find(id);
+    if (r == running.end())
+      return false;
+    r->second.cancel.cancel();
+    stats.cancelled++;
+    return true;
+  }
+
+  /**
+   * @brief Cancel every queued and running task for one device
+   * @return Number of tasks affected
+   */
+  size_t cancelDevice(MacAddress device) {
+    std::vector<Task> dropped; // Destroyed after the lock is released
+    std::lock_guard<std::mutex> lock(mutex);
+    dropped = dropQueued(
+        [device](const Entry &e) { return e.device == device; });
+    size_t count = dropped.size();
+    for (auto &r : running) {
+      if (r.second.device == device) {
+        r.second.cancel.cancel();
+        count++;
+      }
+    }
+    stats.cancelled += count;
+    return count;
+  }
+
+  /**
+   * @brief Cancel everything queued or running
+   */
+  size_t cancelAll() {
+    std::vector<Task> dropped; // Destroyed after the lock is released
+    std::lock_guard<std::mutex> lock(mutex);
+    dropped = dropQueued([](const Entry &) { return true; });
+    size_t count = dropped.size() + running.size();
+    for (auto &r : running)
+      r.second.cancel.cancel();
+    stats.cancelled += count;
+    return count;
+  }
+
+  Stats getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_TASK_EXECUTOR_H
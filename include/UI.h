@@ -4,6 +4,7 @@
 #include <chrono>
 #include <iostream>
 #include <string>
+#include <string_view>
 #include <thread>
 
 namespace UI {
@@ -72,6 +73,9 @@ inline void printHeader(const std::string &title) {
   std::cout << std::endl;
 }
 
+// Erase the current terminal line (e.g. a progress bar) before printing
+inline void clearLine() { std::cout << "\r\033[K" << std::flush; }
+
 inline void printDivider() {
   std::cout << Color::DIM << "────────────────────────────────────────────────"
             << Color::RESET << std::endl;
@@ -145,8 +149,8 @@ inline void printProgress(int current, int total,
 }
 
 // Device display formatting
-inline void printDeviceEntry(int index, const std::string &name,
-                             const std::string &mac, bool connected = false,
+inline void printDeviceEntry(int index, std::string_view name,
+                             std::string_view mac, bool connected = false,
                              bool paired = false) {
   std::cout << "  " << Color::BRIGHT_CYAN << "[" << index << "]"
             << Color::RESET;
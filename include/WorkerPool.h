@@ -0,0 +1,127 @@
+#ifndef TOOTHDROID_WORKER_POOL_H
+#define TOOTHDROID_WORKER_POOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace ToothDroid {
+
+/**
+ * @brief Fixed-size pool of worker threads with a FIFO task queue
+ *
+ * The number of threads never changes after construction, so at most
+ * size() tasks run at once no matter how many are queued.
+ */
+class WorkerPool {
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> queue;
+  std::mutex mutex;
+  std::condition_variable wakeup;
+  bool stopping = false;
+
+  void workerLoop() {
+    while (true) {
+      std::function<void()> task;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wakeup.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (queue.empty())
+          return; // stopping and drained
+        task = std::move(queue.front());
+        queue.pop_front();
+      }
+      task();
+    }
+  }
+
+public:
+  explicit WorkerPool(size_t threads) {
+    if (threads == 0)
+      threads = 1;
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; i++)
+      workers.emplace_back(&WorkerPool::workerLoop, this);
+  }
+
+  WorkerPool(const WorkerPool &) = delete;
+  WorkerPool &operator=(const WorkerPool &) = delete;
+
+  /**
+   * @brief Finish queued tasks, then join all workers
+   */
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    wakeup.notify_all();
+    for (auto &w : workers)
+      w.join();
+  }
+
+  size_t size() const { return workers.size(); }
+
+  /**
+   * @brief Queue a task; it must not throw
+   */
+  void submit(std::function<void()> task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      queue.push_back(std::move(task));
+    }
+    wakeup.notify_one();
+  }
+
+  /**
+   * @brief Apply fn to every item concurrently and wait for all results
+   *
+   * Results come back in input order regardless of completion order. If any
+   * call throws, the first exception is rethrown once all calls finished.
+   * Must not be called from one of this pool's own workers.
+   */
+  template <typename T, typename Fn>
+  auto map(const std::vector<T> &items, Fn fn)
+      -> std::vector<std::invoke_result_t<Fn, const T &>> {
+    using Result = std::invoke_result_t<Fn, const T &>;
+    std::vector<Result> results(items.size());
+
+    std::mutex doneMutex;
+    std::condition_variable done;
+    size_t remaining = items.size();
+    std::exception_ptr error;
+
+    for (size_t i = 0; i < items.size(); i++) {
+      submit([&, i] {
+        std::exception_ptr failure;
+        try {
+          results[i] = fn(items[i]);
+        } catch (...) {
+          failure = std::current_exception();
+        }
+        std::lock_guard<std::mutex> lock(doneMutex);
+        if (failure && !error)
+          error = failure;
+        if (--remaining == 0)
+          done.notify_one();
+      });
+    }
+
+    std::unique_lock<std::mutex> lock(doneMutex);
+    done.wait(lock, [&] { return remaining == 0; });
+    if (error)
+      std::rethrow_exception(error);
+    return results;
+  }
+};
+
+} // namespace ToothDroid
+
+#endif // TOOTHDROID_WORKER_POOL_H
@@ -7,11 +7,15 @@
  * Features: Device scanning, pairing, connecting, and audio profile management.
  */
 
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
 #include <signal.h>
+#include <string>
 #include <vector>
 
+#include "include/AdapterGroup.h"
 #include "include/BluetoothDevice.h"
 #include "include/BluetoothManager.h"
 #include "include/UI.h"
@@ -56,7 +60,7 @@ void showMainMenu() {
 int deviceSelectionMenu(BluetoothManager &manager) {
   manager.displayDevices();
 
-  auto &devices = manager.getDiscoveredDevices();
+  auto devices = manager.getDiscoveredDevices();
   if (devices.empty()) {
     return -1;
   }
@@ -112,14 +116,14 @@ void deviceActionMenu(BluetoothManager &manager, BluetoothDevice &device) {
   switch (choice) {
   case 1: // Connect/Disconnect
     if (device.isConnected) {
-      manager.disconnectDevice(device.macAddress);
+      manager.disconnectDevice(device.macAddress.toString());
       device.isConnected = false;
     } else {
       if (!device.isPaired) {
-        manager.pairDevice(device.macAddress);
+        manager.pairDevice(device.macAddress.toString());
         device.isPaired = true;
       }
-      if (manager.connectDevice(device.macAddress)) {
+      if (manager.connectDevice(device.macAddress.toString())) {
         device.isConnected = true;
       }
     }
@@ -127,10 +131,10 @@ void deviceActionMenu(BluetoothManager &manager, BluetoothDevice &device) {
 
   case 2: // Pair/Remove
     if (device.isPaired) {
-      manager.removeDevice(device.macAddress);
+      manager.removeDevice(device.macAddress.toString());
       device.isPaired = false;
     } else {
-      if (manager.pairDevice(device.macAddress)) {
+      if (manager.pairDevice(device.macAddress.toString())) {
         device.isPaired = true;
       }
     }
@@ -141,15 +145,18 @@ void deviceActionMenu(BluetoothManager &manager, BluetoothDevice &device) {
       // Untrust not directly supported, would need block/unblock
       UI::printWarning("Use 'block' to prevent auto-connect");
     } else {
-      manager.trustDevice(device.macAddress);
+      manager.trustDevice(device.macAddress.toString());
       device.isTrusted = true;
       UI::printSuccess("Device trusted - will auto-connect");
     }
     break;
 
   case 4: // Favorites
-    manager.getHistory().addFavorite(device.macAddress);
-    UI::printSuccess("Added to favorites!");
+    if (manager.addFavorite(device.macAddress)) {
+      UI::printSuccess("Added to favorites!");
+    } else {
+      UI::printWarning("Device is not in history yet");
+    }
     break;
 
   case 5: // Back
@@ -161,7 +168,8 @@ void deviceActionMenu(BluetoothManager &manager, BluetoothDevice &device) {
  * @brief Quick connect menu (favorites)
  */
 void quickConnectMenu(BluetoothManager &manager) {
-  auto &favorites = manager.getHistory().getFavorites();
+  const DeviceHistory &history = manager.getHistory();
+  const auto &favorites = history.getFavorites();
 
   if (favorites.empty()) {
     UI::printWarning("No favorites yet. Add devices from the scan menu.");
@@ -171,20 +179,30 @@ void quickConnectMenu(BluetoothManager &manager) {
   UI::printInfo("Favorites:");
   UI::printDivider();
 
-  for (size_t i = 0; i < favorites.size(); i++) {
-    const auto &d = favorites[i];
-    UI::printDeviceEntry(i + 1, d.getDisplayName(), d.macAddress, d.isConnected,
-                         d.isPaired);
-  }
+  // Handles resolve to the live history entries; nothing is copied
+  int shown = 0;
+  history.forEachFavorite(
+      [&](DeviceHistory::Handle, const BluetoothDevice &d) {
+        auto mac = d.macAddress.format();
+        std::string_view macText(mac.data(), MacAddress::STRING_LENGTH);
+        UI::printDeviceEntry(++shown, d.getDisplayName(macText), macText,
+                             d.isConnected, d.isPaired);
+      });
 
   std::cout << "  " << UI::Color::DIM << "[0] Cancel" << UI::Color::RESET
             << std::endl;
   std::cout << std::endl;
 
-  int choice = UI::promptChoice("Quick connect to:", 0, favorites.size());
+  int choice = UI::promptChoice("Quick connect to:", 0, shown);
 
-  if (choice > 0 && choice <= static_cast<int>(favorites.size())) {
-    manager.connectDevice(favorites[choice - 1].macAddress);
+  MacAddress target;
+  int n = 0;
+  history.forEachFavorite([&](DeviceHistory::Handle, const BluetoothDevice &d) {
+    if (++n == choice)
+      target = d.macAddress;
+  });
+  if (!target.isNull()) {
+    manager.connectDevice(target.toString());
   }
 }
 
@@ -195,17 +213,31 @@ void adapterSettingsMenu(BluetoothManager &manager) {
   UI::printInfo("Adapter Settings");
   UI::printDivider();
 
-  std::cout << manager.getAdapterInfo() << std::endl;
+  // One cached state for the whole menu instead of a `show` per question
+  AdapterState adapter = manager.getAdapterState();
+  auto yesNo = [](bool value) { return value ? "yes" : "no"; };
+  std::cout << "Controller " << adapter.address << " (" << adapter.name
+            << ")" << std::endl;
+  std::cout << "\tPowered: " << yesNo(adapter.powered) << std::endl;
+  std::cout << "\tDiscoverable: " << yesNo(adapter.discoverable) << std::endl;
+  std::cout << "\tPairable: " << yesNo(adapter.pairable) << std::endl;
+  std::cout << "\tDiscovering: " << yesNo(adapter.discovering) << std::endl;
+
+  auto cache = manager.getInfoCacheStats();
+  std::cout << UI::Color::DIM << "Device info cache: " << cache.hits
+            << " hits, " << cache.misses << " misses, "
+            << cache.invalidations << " invalidations" << UI::Color::RESET
+            << std::endl;
 
-  const std::string items[] = {
-      manager.isBluetoothOn() ? "Power OFF" : "Power ON", "Back"};
+  const std::string items[] = {adapter.powered ? "Power OFF" : "Power ON",
+                               "Back"};
 
   UI::printMenu(items, 2);
 
   int choice = UI::promptChoice("Action:", 1, 2);
 
   if (choice == 1) {
-    if (manager.isBluetoothOn()) {
+    if (adapter.powered) {
       manager.powerOff();
       UI::printSuccess("Bluetooth powered off");
     } else {
@@ -215,10 +247,134 @@ void adapterSettingsMenu(BluetoothManager &manager) {
   }
 }
 
+/**
+ * @brief Command-line usage
+ */
+void printUsage(const char *program) {
+  std::cout << "Usage:" << std::endl;
+  std::cout << "  " << program << "                     Interactive menu"
+            << std::endl;
+  std::cout << "  " << program
+            << " connect --mac XX:XX:XX:XX:XX:XX [--timeout SECONDS]"
+            << std::endl;
+  std::cout << "      Scan until the device appears, then connect right away"
+            << std::endl;
+  std::cout << "  " << program << " adapters" << std::endl;
+  std::cout << "      List the Bluetooth adapters on this machine" << std::endl;
+  std::cout << "  " << program << " scan --all-adapters [--duration SECONDS]"
+            << std::endl;
+  std::cout << "      Scan on every adapter at once, one merged device table"
+            << std::endl;
+}
+
+/**
+ * @brief Scan on all adapters in parallel and print the merged table
+ */
+int scanAllAdapters(int duration) {
+  auto controllers = g_manager->listControllers();
+  if (controllers.empty()) {
+    UI::printError("No Bluetooth adapters found");
+    return 1;
+  }
+
+  std::unique_ptr<AdapterGroup> group;
+  try {
+    group = std::make_unique<AdapterGroup>(*g_manager, controllers);
+  } catch (const BluetoothException &e) {
+    UI::printError(e.what());
+    return 1;
+  }
+
+  UI::printStep("Scanning on " + std::to_string(group->size()) +
+                " adapter(s) for " + std::to_string(duration) + " s...");
+  for (size_t i = 0; i < group->size(); i++)
+    group->manager(i).powerOn();
+  auto devices = group->scan(duration);
+
+  UI::printSuccess("Found " + std::to_string(devices.size()) + " device(s)");
+  UI::printDivider();
+  for (size_t i = 0; i < devices.size(); i++) {
+    const BluetoothDevice &d = devices[i].device;
+    UI::printDeviceEntry(i + 1, d.getDisplayName(), d.macAddress.toString(),
+                         d.isConnected, d.isPaired);
+    std::cout << "      " << UI::Color::DIM;
+    for (const auto &seen : devices[i].rssi) {
+      std::cout << seen.adapter << " " << seen.rssi << " dBm"
+                << (seen.adapter == devices[i].bestAdapter ? " *" : "")
+                << "  ";
+    }
+    std::cout << UI::Color::RESET << std::endl;
+  }
+  return 0;
+}
+
+/**
+ * @brief Run a non-interactive command
+ * @return Process exit code
+ */
+int runCommand(int argc, char *argv[]) {
+  std::string command = argv[1];
+  if (command == "-h" || command == "--help") {
+    printUsage(argv[0]);
+    return 0;
+  }
+
+  if (command == "connect") {
+    std::string mac;
+    int timeout = 20;
+    for (int i = 2; i < argc; i++) {
+      if (std::strcmp(argv[i], "--mac") == 0 && i + 1 < argc) {
+        mac = argv[++i];
+      } else if (std::strcmp(argv[i], "--timeout") == 0 && i + 1 < argc) {
+        timeout = std::atoi(argv[++i]);
+      } else {
+        printUsage(argv[0]);
+        return 2;
+      }
+    }
+    if (mac.empty() || timeout <= 0) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    return g_manager->connectByAddress(mac, timeout) ? 0 : 1;
+  }
+
+  if (command == "adapters" && argc == 2) {
+    for (const auto &controller : g_manager->listControllers()) {
+      std::cout << controller.address << "  " << controller.name
+                << (controller.isDefault ? "  [default]" : "") << std::endl;
+    }
+    return 0;
+  }
+
+  if (command == "scan") {
+    bool allAdapters = false;
+    int duration = 8;
+    for (int i = 2; i < argc; i++) {
+      if (std::strcmp(argv[i], "--all-adapters") == 0) {
+        allAdapters = true;
+      } else if (std::strcmp(argv[i], "--duration") == 0 && i + 1 < argc) {
+        duration = std::atoi(argv[++i]);
+      } else {
+        printUsage(argv[0]);
+        return 2;
+      }
+    }
+    if (!allAdapters || duration <= 0) {
+      printUsage(argv[0]);
+      return 2;
+    }
+    return scanAllAdapters(duration);
+  }
+
+  printUsage(argv[0]);
+  return 2;
+}
+
 /**
  * @brief Main application entry point
  */
-int main() {
+int main(int argc, char *argv[]) {
   // Setup signal handler
   signal(SIGINT, signalHandler);
   signal(SIGTERM, signalHandler);
@@ -237,9 +393,18 @@ int main() {
     return 1;
   }
 
+  if (argc > 1) {
+    return runCommand(argc, argv);
+  }
+
   // Display header
   UI::printHeader("ToothDroid v2.0");
   UI::printInfo("Modern Linux Bluetooth Manager");
+  UI::printInfo("Backend: " + g_manager->getBackendName());
+  if (g_manager->getHistory().size() > 0) {
+    UI::printInfo("Remembered devices: " +
+                  std::to_string(g_manager->getHistory().size()));
+  }
 
   // Main loop
   bool running = true;
@@ -256,7 +421,7 @@ int main() {
       if (!devices.empty()) {
         int selected = deviceSelectionMenu(*g_manager);
         if (selected > 0) {
-          auto *device = g_manager->selectDevice(selected - 1);
+          auto device = g_manager->selectDevice(selected - 1);
           if (device) {
             deviceActionMenu(*g_manager, *device);
           }
@@ -274,28 +439,30 @@ int main() {
         UI::printDivider();
         for (size_t i = 0; i < paired.size(); i++) {
           UI::printDeviceEntry(i + 1, paired[i].getDisplayName(),
-                               paired[i].macAddress, paired[i].isConnected,
-                               true);
+                               paired[i].macAddress.toString(),
+                               paired[i].isConnected, true);
         }
       }
       break;
     }
 
     case 3: { // Connect
-      auto &devices = g_manager->getDiscoveredDevices();
-      if (devices.empty()) {
+      auto devices = g_manager->getDiscoveredDevices();
+      if (devices.empty() && g_manager->loadKnownDevices()) {
+        UI::printInfo("Showing remembered devices (scan to refresh)");
+      } else if (devices.empty()) {
         UI::printWarning("No devices in cache. Scanning first...");
         g_manager->scanDevices(5);
       }
 
       int selected = deviceSelectionMenu(*g_manager);
       if (selected > 0) {
-        auto *device = g_manager->selectDevice(selected - 1);
+        auto device = g_manager->selectDevice(selected - 1);
         if (device) {
           if (!device->isPaired) {
-            g_manager->pairDevice(device->macAddress);
+            g_manager->pairDevice(device->macAddress.toString());
           }
-          g_manager->connectDevice(device->macAddress);
+          g_manager->connectDevice(device->macAddress.toString());
         }
       }
       break;
@@ -0,0 +1,191 @@
+#include "DeviceItemDelegate.h"
+#include "DeviceListModel.h"
+#include <QFontMetrics>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+
+namespace ToothDroid {
+namespace GUI {
+
+namespace {
+
+// Same geometry and colours as the old per-row widget and style.qss
+constexpr int CARD_MARGIN_X = 10;
+constexpr int CARD_MARGIN_Y = 5;
+constexpr int PADDING_X = 16;
+constexpr int ICON_SIZE = 24;
+constexpr int SPACING = 12;
+constexpr int BUTTON_WIDTH = 100;
+constexpr int BUTTON_HEIGHT = 32;
+
+const QColor CARD(0x33, 0x33, 0x33);
+const QColor CARD_HOVER(0x3d, 0x3d, 0x3d);
+const QColor GREEN(0x30, 0xd1, 0x58);
+const QColor BLUE(0x0a, 0x84, 0xff);
+const QColor RED(0xff, 0x45, 0x3a);
+const QColor MAC_TEXT(0x98, 0x98, 0x9d);
+const QColor PROFILE_TEXT(0xe5, 0xe5, 0xea);
+
+QRect cardRect(const QRect &rowRect) {
+  return rowRect.adjusted(CARD_MARGIN_X, CARD_MARGIN_Y, -CARD_MARGIN_X,
+                          -CARD_MARGIN_Y);
+}
+
+QColor withAlpha(QColor color, qreal alpha) {
+  color.setAlphaF(alpha);
+  return color;
+}
+
+} // namespace
+
+DeviceItemDelegate::DeviceItemDelegate(QObject *parent)
+    : QStyledItemDelegate(parent) {
+  m_nameFont.setPixelSize(15);
+  m_nameFont.setWeight(QFont::DemiBold);
+  m_macFont.setFamilies({"SF Mono", "Menlo", "monospace"});
+  m_macFont.setStyleHint(QFont::Monospace);
+  m_macFont.setPixelSize(11);
+  m_profileFont.setPixelSize(10);
+  m_buttonFont.setPixelSize(14);
+  m_buttonFont.setWeight(QFont::Medium);
+}
+
+QRect DeviceItemDelegate::buttonRect(const QRect &rowRect) {
+  QRect card = cardRect(rowRect);
+  return QRect(card.right() - PADDING_X - BUTTON_WIDTH + 1,
+               card.center().y() - BUTTON_HEIGHT / 2, BUTTON_WIDTH,
+               BUTTON_HEIGHT);
+}
+
+QSize DeviceItemDelegate::sizeHint(const QStyleOptionViewItem &,
+                                   const QModelIndex &) const {
+  return QSize(0, ROW_HEIGHT);
+}
+
+void DeviceItemDelegate::paint(QPainter *painter,
+                               const QStyleOptionViewItem &option,
+                               const QModelIndex &index) const {
+  const auto *model = qobject_cast<const DeviceListModel *>(index.model());
+  if (!model)
+    return;
+  const BluetoothDevice &device = model->deviceAt(index.row());
+  bool hovered = option.state & QStyle::State_MouseOver;
+  bool selected = option.state & QStyle::State_Selected;
+
+  painter->save();
+  painter->setRenderHint(QPainter::Antialiasing);
+
+  // Card
+  QRectF card = QRectF(cardRect(option.rect)).adjusted(0.5, 0.5, -0.5, -0.5);
+  painter->setPen(selected ? QColor(255, 255, 255, 26) : QColor(0, 0, 0, 51));
+  painter->setBrush(hovered || selected ? CARD_HOVER : CARD);
+  painter->drawRoundedRect(card, 10, 10);
+
+  // Status dot
+  QRect content = cardRect(option.rect).adjusted(PADDING_X, 0, -PADDING_X, 0);
+  QRect icon(content.left(), content.center().y() - ICON_SIZE / 2, ICON_SIZE,
+             ICON_SIZE);
+  QColor status = device.isConnected ? GREEN
+                  : device.isPaired  ? BLUE
+                                     : QColor(Qt::white);
+  painter->setPen(Qt::NoPen);
+  painter->setBrush(status);
+  painter->drawEllipse(QRectF(icon).adjusted(6, 6, -6, -6));
+
+  // Name over MAC and profiles
+  QRect button = buttonRect(option.rect);
+  int textLeft = icon.right() + SPACING;
+  int textWidth = button.left() - SPACING - textLeft;
+  QFontMetrics nameMetrics(m_nameFont);
+  QFontMetrics macMetrics(m_macFont);
+  QRect nameRect(textLeft, content.center().y() - nameMetrics.height() - 2,
+                 textWidth, nameMetrics.height());
+  QRect detailRect(textLeft, content.center().y() + 2, textWidth,
+                   macMetrics.height() + 4);
+
+  painter->setFont(m_nameFont);
+  painter->setPen(status);
+  painter->drawText(nameRect, Qt::AlignLeft | Qt::AlignVCenter,
+                    nameMetrics.elidedText(
+                        QString::fromStdString(device.getDisplayName()),
+                        Qt::ElideRight, textWidth));
+
+  QString mac = QString::fromStdString(device.macAddress.toString());
+  painter->setFont(m_macFont);
+  painter->setPen(MAC_TEXT);
+  painter->drawText(detailRect, Qt::AlignLeft | Qt::AlignVCenter, mac);
+
+  if (device.hasAudioSupport()) {
+    QString profiles;
+    if (device.supportsA2DP)
+      profiles += "A2DP ";
+    if (device.supportsHSP)
+      profiles += "HSP ";
+    if (device.supportsHFP)
+      profiles += "HFP ";
+    profiles = profiles.trimmed();
+
+    QFontMetrics profileMetrics(m_profileFont);
+    QRect pill(detailRect.left() + macMetrics.horizontalAdvance(mac) + 8,
+               detailRect.top(),
+               profileMetrics.horizontalAdvance(profiles) + 12,
+               detailRect.height());
+    if (pill.right() < detailRect.right()) {
+      painter->setPen(Qt::NoPen);
+      painter->setBrush(QColor(255, 255, 255, 26));
+      painter->drawRoundedRect(pill, 4, 4);
+      painter->setFont(m_profileFont);
+      painter->setPen(PROFILE_TEXT);
+      painter->drawText(pill, Qt::AlignCenter, profiles);
+    }
+  }
+
+  // Connect / Disconnect
+  QColor accent = device.isConnected ? RED : GREEN;
+  bool pressed = m_pressed.isValid() && m_pressed == index;
+  painter->setPen(withAlpha(accent, 0.3));
+  painter->setBrush(withAlpha(accent, pressed ? 0.35 : hovered ? 0.25 : 0.15));
+  painter->drawRoundedRect(QRectF(button).adjusted(0.5, 0.5, -0.5, -0.5),
+                           BUTTON_HEIGHT / 2.0, BUTTON_HEIGHT / 2.0);
+  painter->setFont(m_buttonFont);
+  painter->setPen(accent);
+  painter->drawText(button, Qt::AlignCenter,
+                    device.isConnected ? "Disconnect" : "Connect");
+
+  painter->restore();
+}
+
+bool DeviceItemDelegate::editorEvent(QEvent *event, QAbstractItemModel *model,
+                                     const QStyleOptionViewItem &option,
+                                     const QModelIndex &index) {
+  if (event->type() != QEvent::MouseButtonPress &&
+      event->type() != QEvent::MouseButtonRelease)
+    return QStyledItemDelegate::editorEvent(event, model, option, index);
+
+  auto *mouse = static_cast<QMouseEvent *>(event);
+  bool onButton = mouse->button() == Qt::LeftButton &&
+                  buttonRect(option.rect).contains(mouse->position().toPoint());
+
+  if (event->type() == QEvent::MouseButtonPress) {
+    m_pressed =
+        onButton ? QPersistentModelIndex(index) : QPersistentModelIndex();
+    return onButton;
+  }
+
+  // A click is a press and release on the same row's button
+  bool clicked = onButton && m_pressed == index;
+  m_pressed = QPersistentModelIndex();
+  if (!clicked)
+    return false;
+
+  QString mac = index.data(DeviceListModel::MacRole).toString();
+  if (index.data(DeviceListModel::ConnectedRole).toBool())
+    emit disconnectClicked(mac);
+  else
+    emit connectClicked(mac);
+  return true;
+}
+
+} // namespace GUI
+} // namespace ToothDroid
@@ -0,0 +1,50 @@
+#ifndef DEVICEITEMDELEGATE_H
+#define DEVICEITEMDELEGATE_H
+
+#include <QFont>
+#include <QPersistentModelIndex>
+#include <QStyledItemDelegate>
+
+namespace ToothDroid {
+namespace GUI {
+
+// Paints a DeviceListModel row as a card: status dot, name, MAC, audio
+// profiles and a Connect/Disconnect button. The button is hit-tested here,
+// so a row costs no widgets however many devices are listed.
+class DeviceItemDelegate : public QStyledItemDelegate {
+  Q_OBJECT
+
+public:
+  static constexpr int ROW_HEIGHT = 72;
+
+  explicit DeviceItemDelegate(QObject *parent = nullptr);
+
+  void paint(QPainter *painter, const QStyleOptionViewItem &option,
+             const QModelIndex &index) const override;
+  QSize sizeHint(const QStyleOptionViewItem &option,
+                 const QModelIndex &index) const override;
+
+  // Where the button of the row at `rowRect` is drawn
+  static QRect buttonRect(const QRect &rowRect);
+
+signals:
+  void connectClicked(const QString &mac);
+  void disconnectClicked(const QString &mac);
+
+protected:
+  bool editorEvent(QEvent *event, QAbstractItemModel *model,
+                   const QStyleOptionViewItem &option,
+                   const QModelIndex &index) override;
+
+private:
+  QFont m_nameFont;
+  QFont m_macFont;
+  QFont m_profileFont;
+  QFont m_buttonFont;
+  QPersistentModelIndex m_pressed; // Row whose button is held down
+};
+
+} // namespace GUI
+} // namespace ToothDroid
+
+#endif // DEVICEITEMDELEGATE_H
@@ -0,0 +1,138 @@
+#include "DeviceListModel.h"
+
+namespace ToothDroid {
+namespace GUI {
+
+DeviceListModel::DeviceListModel(QObject *parent)
+    : QAbstractListModel(parent) {}
+
+int DeviceListModel::rowCount(const QModelIndex &parent) const {
+  return parent.isValid() ? 0 : static_cast<int>(m_devices.size());
+}
+
+QVariant DeviceListModel::data(const QModelIndex &index, int role) const {
+  if (!index.isValid() || index.row() >= rowCount())
+    return QVariant();
+
+  const BluetoothDevice &device = m_devices[index.row()];
+  switch (role) {
+  case Qt::DisplayRole:
+    return QString::fromStdString(device.getDisplayName());
+  case MacRole:
+    return QString::fromStdString(device.macAddress.toString());
+  case ConnectedRole:
+    return device.isConnected;
+  case PairedRole:
+    return device.isPaired;
+  default:
+    return QVariant();
+  }
+}
+
+void DeviceListModel::setDevices(const std::vector<BluetoothDevice> &devices) {
+  std::unordered_map<MacAddress, const BluetoothDevice *> incoming;
+  incoming.reserve(devices.size());
+  for (const auto &device : devices)
+    incoming[device.macAddress] = &device;
+
+  // Drop rows that are gone, one contiguous run at a time from the bottom,
+  // so the rows above keep their indices while we go
+  bool removed = false;
+  for (int last = rowCount() - 1; last >= 0;) {
+    if (incoming.count(m_devices[last].macAddress)) {
+      last--;
+      continue;
+    }
+    int first = last;
+    while (first > 0 && !incoming.count(m_devices[first - 1].macAddress))
+      first--;
+    beginRemoveRows(QModelIndex(), first, last);
+    m_devices.erase(m_devices.begin() + first, m_devices.begin() + last + 1);
+    endRemoveRows();
+    removed = true;
+    last = first - 1;
+  }
+  if (removed) {
+    m_rows.clear();
+    for (size_t i = 0; i < m_devices.size(); i++)
+      m_rows[m_devices[i].macAddress] = static_cast<int>(i);
+  }
+
+  // Rows that stay keep their place; only those that look different repaint
+  for (size_t i = 0; i < m_devices.size(); i++) {
+    const BluetoothDevice &device = *incoming[m_devices[i].macAddress];
+    bool changed = looksDifferent(m_devices[i], device);
+    m_devices[i] = device;
+    if (changed) {
+      QModelIndex row = index(static_cast<int>(i));
+      emit dataChanged(row, row);
+    }
+  }
+
+  // New devices go after them, in snapshot order
+  std::vector<const BluetoothDevice *> added;
+  for (const auto &device : devices) {
+    if (rowOf(device.macAddress) < 0 &&
+        incoming[device.macAddress] == &device)
+      added.push_back(&device);
+  }
+  if (added.empty())
+    return;
+  int first = rowCount();
+  beginInsertRows(QModelIndex(), first,
+                  first + static_cast<int>(added.size()) - 1);
+  for (const BluetoothDevice *device : added) {
+    m_rows[device->macAddress] = rowCount();
+    m_devices.push_back(*device);
+  }
+  endInsertRows();
+}
+
+bool DeviceListModel::looksDifferent(const BluetoothDevice &a,
+                                     const BluetoothDevice &b) {
+  return a.name != b.name || a.alias != b.alias ||
+         a.isConnected != b.isConnected || a.isPaired != b.isPaired ||
+         a.supportsA2DP != b.supportsA2DP || a.supportsHSP != b.supportsHSP ||
+         a.supportsHFP != b.supportsHFP;
+}
+
+void DeviceListModel::upsert(const BluetoothDevice &device) {
+  int row = rowOf(device.macAddress);
+  if (row >= 0) {
+    bool changed = looksDifferent(m_devices[row], device);
+    m_devices[row] = device;
+    if (changed) {
+      QModelIndex updated = index(row);
+      emit dataChanged(updated, updated);
+    }
+    return;
+  }
+
+  row = rowCount();
+  beginInsertRows(QModelIndex(), row, row);
+  m_devices.push_back(device);
+  m_rows[device.macAddress] = row;
+  endInsertRows();
+}
+
+bool DeviceListModel::remove(MacAddress mac) {
+  int row = rowOf(mac);
+  if (row < 0)
+    return false;
+
+  beginRemoveRows(QModelIndex(), row, row);
+  m_devices.erase(m_devices.begin() + row);
+  m_rows.erase(mac);
+  for (size_t i = row; i < m_devices.size(); i++)
+    m_rows[m_devices[i].macAddress] = static_cast<int>(i);
+  endRemoveRows();
+  return true;
+}
+
+int DeviceListModel::rowOf(MacAddress mac) const {
+  auto it = m_rows.find(mac);
+  return it == m_rows.end() ? -1 : it->second;
+}
+
+} // namespace GUI
+} // namespace ToothDroid
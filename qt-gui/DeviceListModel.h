@@ -0,0 +1,56 @@
+#ifndef DEVICELISTMODEL_H
+#define DEVICELISTMODEL_H
+
+#include "../include/BluetoothDevice.h"
+#include <QAbstractListModel>
+#include <unordered_map>
+#include <vector>
+
+namespace ToothDroid {
+namespace GUI {
+
+// Devices shown in the main list, one row each, in arrival order.
+// Rows are found by MAC in O(1); DeviceItemDelegate reads the device of a
+// row straight from here instead of through a QVariant copy.
+class DeviceListModel : public QAbstractListModel {
+  Q_OBJECT
+
+public:
+  enum Roles {
+    MacRole = Qt::UserRole + 1, // "AA:BB:CC:DD:EE:FF" as QString
+    ConnectedRole,
+    PairedRole
+  };
+
+  explicit DeviceListModel(QObject *parent = nullptr);
+
+  int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+  QVariant data(const QModelIndex &index,
+                int role = Qt::DisplayRole) const override;
+
+  // Make the rows match `devices`, keyed by MAC. Rows that left are
+  // removed, rows that stay keep their place and are only repainted if
+  // they look different, and new devices are appended; no row is rebuilt.
+  void setDevices(const std::vector<BluetoothDevice> &devices);
+  // Update the device's row, or append one
+  void upsert(const BluetoothDevice &device);
+  // @return false if the device had no row
+  bool remove(MacAddress mac);
+
+  const BluetoothDevice &deviceAt(int row) const { return m_devices[row]; }
+  // @return -1 if the device has no row
+  int rowOf(MacAddress mac) const;
+
+private:
+  // Whether the delegate would paint the two differently
+  static bool looksDifferent(const BluetoothDevice &a,
+                             const BluetoothDevice &b);
+
+  std::vector<BluetoothDevice> m_devices;
+  std::unordered_map<MacAddress, int> m_rows; // MAC -> row
+};
+
+} // namespace GUI
+} // namespace ToothDroid
+
+#endif // DEVICELISTMODEL_H
@@ -1,18 +1,48 @@
 #include "MainWindow.h"
-#include "DeviceItemWidget.h"
+#include "DeviceItemDelegate.h"
 #include <QDir>
 #include <QFile>
+#include <QGuiApplication>
 #include <QHBoxLayout>
 #include <QMenu>
 #include <QMessageBox>
 #include <QPointer>
+#include <QScreen>
 #include <QStyle>
 #include <QVBoxLayout>
-#include <thread>
+#include <cstdio>
 
 namespace ToothDroid {
 namespace GUI {
 
+namespace {
+
+// Device actions that may run at once, and that may wait behind them
+constexpr size_t ACTION_THREADS = 4;
+constexpr size_t ACTION_QUEUE = 32;
+
+// A scan window, and in "Keep scanning" mode the pause before the next one,
+// so the radio discovers 8 s out of every 20; devices unheard for a minute
+// drop off the list
+constexpr std::chrono::seconds SCAN_WINDOW{8};
+constexpr std::chrono::seconds SCAN_IDLE{12};
+constexpr std::chrono::seconds SCAN_MAX_AGE{60};
+constexpr std::chrono::seconds SCAN_EXTEND{10};
+
+// One refresh of the primary screen, unless TOOTHDROID_FRAME_MS says
+// otherwise
+std::chrono::milliseconds displayFrame() {
+  auto frame = ScanCoalescer::DEFAULT_FRAME;
+  if (QScreen *screen = QGuiApplication::primaryScreen()) {
+    if (screen->refreshRate() >= 1.0)
+      frame = std::chrono::milliseconds(
+          std::max(1, qRound(1000.0 / screen->refreshRate())));
+  }
+  return ScanCoalescer::frameFromEnvironment(frame);
+}
+
+} // namespace
+
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
   setWindowTitle("ToothDroid v2.2");
   resize(420, 680);
@@ -21,27 +51,151 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
   setWindowFlags(Qt::Window | Qt::FramelessWindowHint);
   setAttribute(Qt::WA_TranslucentBackground);
 
-  // Initialize Bluetooth
-  try {
-    m_manager = std::make_unique<BluetoothManager>();
-    m_manager->unblockAdapter();
-    m_manager->powerOn();
-  } catch (const std::exception &e) {
+  m_reportStartup =
+      QCoreApplication::arguments().contains("--startup-timing") ||
+      qEnvironmentVariableIsSet("TOOTHDROID_STARTUP_TIMING");
+
+  setupUi();
+
+  m_scanEvents = std::make_unique<ScanCoalescer>(*this, displayFrame());
+  m_frameTimer = new QTimer(this);
+  m_frameTimer->setInterval(
+      static_cast<int>(m_scanEvents->getFrame().count()));
+  connect(m_frameTimer, &QTimer::timeout, this, &MainWindow::flushScanEvents);
+
+  // Show remembered devices straight from the store, so the first paint
+  // does not wait for the backend; the scan refreshes them
+  auto known = BluetoothManager::loadRememberedDevices();
+  if (!known.empty()) {
+    updateDeviceList(known);
+    m_statusLabel->setText(QString("%1 remembered devices").arg(known.size()));
+  } else {
+    m_statusLabel->setText("Starting Bluetooth...");
+  }
+  m_startup.mark("remembered devices");
+
+  m_actions = std::make_unique<TaskExecutor>(ACTION_THREADS, ACTION_QUEUE);
+  startBluetooth();
+}
+
+void MainWindow::startBluetooth() {
+  m_scanButton->setEnabled(false);
+  m_initStages = 2;
+  QPointer<MainWindow> safeSelf(this);
+
+  // Unblocking the radio and probing the backend are independent, so they
+  // run side by side; powering on waits for both
+  m_actions->submit(MacAddress(), [safeSelf](const CancelToken &cancel) {
+    if (cancel.isCancelled())
+      return;
+    BluetoothManager::unblockAdapter();
+    QMetaObject::invokeMethod(safeSelf, [safeSelf]() {
+      if (safeSelf)
+        safeSelf->onStartupStageDone();
+    });
+  });
+
+  m_actions->submit(MacAddress(), [safeSelf](const CancelToken &cancel) {
+    if (cancel.isCancelled())
+      return;
+    // Freed with the callback if the window is gone before it runs
+    auto made = std::make_shared<std::unique_ptr<BluetoothManager>>();
+    QString error;
+    try {
+      *made = std::make_unique<BluetoothManager>();
+    } catch (const std::exception &e) {
+      error = QString::fromStdString(e.what());
+    }
+    QMetaObject::invokeMethod(safeSelf, [safeSelf, made, error]() {
+      if (!safeSelf)
+        return;
+      safeSelf->m_manager = std::move(*made);
+      safeSelf->m_initError = error;
+      safeSelf->onStartupStageDone();
+    });
+  });
+}
+
+void MainWindow::onStartupStageDone() {
+  if (--m_initStages > 0)
+    return;
+
+  if (!m_manager) {
+    m_statusLabel->setText("Bluetooth unavailable");
     QMessageBox::critical(
         this, "Bluetooth Error",
-        QString("Failed to initialize Bluetooth:\n%1").arg(e.what()));
+        QString("Failed to initialize Bluetooth:\n%1").arg(m_initError));
+    return;
   }
 
-  setupUi();
+  QPointer<MainWindow> safeSelf(this);
+  m_actions->submit(MacAddress(), [this, safeSelf](const CancelToken &cancel) {
+    if (cancel.isCancelled())
+      return;
+    try {
+      m_manager->powerOn();
+    } catch (const std::exception &) {
+    }
+    QMetaObject::invokeMethod(safeSelf, [safeSelf]() {
+      if (safeSelf)
+        safeSelf->onBluetoothReady();
+    });
+  });
+}
+
+void MainWindow::onBluetoothReady() {
+  m_startup.mark("bluetooth ready");
+
+  // The controller's callbacks come from its thread; the window may be
+  // gone by the time they are delivered
+  m_scanner = std::make_unique<ScanController>(*m_manager, *m_scanEvents);
+  QPointer<MainWindow> safeSelf(this);
+  m_scanner->setOnFinished(
+      [safeSelf](const std::vector<BluetoothDevice> &devices, bool complete) {
+        QMetaObject::invokeMethod(safeSelf, [safeSelf, devices, complete]() {
+          if (safeSelf)
+            safeSelf->onScanFinished(devices, complete);
+        });
+      });
+  m_scanner->setOnError([safeSelf](const std::string &error) {
+    QString message = QString::fromStdString(error);
+    QMetaObject::invokeMethod(safeSelf, [safeSelf, message]() {
+      if (safeSelf)
+        safeSelf->onScanError(message);
+    });
+  });
+  m_scanner->setOnStateChanged([safeSelf](ScanController::State state) {
+    QMetaObject::invokeMethod(safeSelf, [safeSelf, state]() {
+      if (safeSelf)
+        safeSelf->onScanStateChanged(state);
+    });
+  });
 
-  // Auto scan on startup
-  QTimer::singleShot(200, this, [this]() { startScan(); });
+  m_scanButton->setEnabled(true);
+  startScan();
+}
+
+void MainWindow::reportStartup() {
+  if (!m_reportStartup || m_startupReported)
+    return;
+  m_startupReported = true;
+  std::fprintf(stderr, "Startup timeline (from process start):\n%s",
+               m_startup.report().c_str());
+}
+
+void MainWindow::paintEvent(QPaintEvent *event) {
+  QMainWindow::paintEvent(event);
+  m_startup.mark("first paint");
 }
 
 MainWindow::~MainWindow() {
-  if (m_scanThread && m_scanThread->isRunning()) {
-    m_scanThread->quit();
-    m_scanThread->wait();
+  // The scan, even between two windows, and running actions return within
+  // Deadline::CANCEL_POLL; pending actions are dropped. Both are gone
+  // before the manager and the coalescer they use
+  m_scanner.reset();
+  if (m_actions) {
+    m_actions->cancelAll();
+    m_actions.reset();
   }
 }
 
@@ -174,14 +328,24 @@ void MainWindow::setupUi() {
   emptyLayout->addWidget(emptyTitle, 0, Qt::AlignCenter);
   emptyLayout->addWidget(emptyDesc, 0, Qt::AlignCenter);
 
-  // Device List
-  m_deviceList = new QListWidget(this);
+  // Device List: rows are painted by the delegate, not built from widgets
+  m_deviceModel = new DeviceListModel(this);
+  auto *delegate = new DeviceItemDelegate(this);
+  m_deviceList = new QListView(this);
+  m_deviceList->setModel(m_deviceModel);
+  m_deviceList->setItemDelegate(delegate);
+  m_deviceList->setUniformItemSizes(true);
+  m_deviceList->setMouseTracking(true);
   m_deviceList->setVisible(false);
   m_deviceList->setContextMenuPolicy(Qt::CustomContextMenu);
   m_deviceList->setStyleSheet(
-      "QListWidget { background: transparent; border: none; outline: none; }");
+      "QListView { background: transparent; border: none; outline: none; }");
   m_deviceList->setVerticalScrollMode(QAbstractItemView::ScrollPerPixel);
-  connect(m_deviceList, &QListWidget::customContextMenuRequested, this,
+  connect(delegate, &DeviceItemDelegate::connectClicked, this,
+          &MainWindow::connectDevice);
+  connect(delegate, &DeviceItemDelegate::disconnectClicked, this,
+          &MainWindow::disconnectDevice);
+  connect(m_deviceList, &QListView::customContextMenuRequested, this,
           &MainWindow::onContextMenuRequested);
 
   stackLayout->addWidget(m_emptyState);
@@ -203,6 +367,31 @@ void MainWindow::setupUi() {
 
   statusLayout->addStretch();
 
+  // Continuous discovery, duty-cycled
+  m_keepScanning = new QCheckBox("Keep scanning", this);
+  m_keepScanning->setCursor(Qt::PointingHandCursor);
+  m_keepScanning->setStyleSheet("color: #888; font-size: 11px;");
+  connect(m_keepScanning, &QCheckBox::toggled, this, [this]() {
+    // Carry on in the new mode
+    if (m_isScanning)
+      startScan();
+  });
+  statusLayout->addWidget(m_keepScanning);
+
+  // Keeps a one-shot scan going a little longer
+  m_extendButton = new QPushButton(
+      QString("+%1s").arg(static_cast<int>(SCAN_EXTEND.count())), this);
+  m_extendButton->setCursor(Qt::PointingHandCursor);
+  m_extendButton->setFixedWidth(48);
+  m_extendButton->setVisible(false);
+  m_extendButton->setStyleSheet(
+      "QPushButton { background-color: #333; color: white; border-radius: 6px; "
+      "padding: 8px; border: 1px solid #444; }"
+      "QPushButton:hover { background-color: #444; border-color: #555; }");
+  connect(m_extendButton, &QPushButton::clicked, this,
+          &MainWindow::extendScan);
+  statusLayout->addWidget(m_extendButton);
+
   // Scan Button
   m_scanButton = new QPushButton("Scan", this);
   m_scanButton->setCursor(Qt::PointingHandCursor);
@@ -214,54 +403,151 @@ void MainWindow::setupUi() {
       "QPushButton:pressed { background-color: #222; transform: "
       "translateY(1px); }"
       "QPushButton:disabled { color: #555; border-color: #2a2a2a; }");
-  connect(m_scanButton, &QPushButton::clicked, this, &MainWindow::startScan);
+  connect(m_scanButton, &QPushButton::clicked, this,
+          &MainWindow::onScanButtonClicked);
   statusLayout->addWidget(m_scanButton);
 
   mainLayout->addWidget(statusBar);
 }
 
+ScanController::Options MainWindow::scanOptions() const {
+  ScanController::Options options;
+  options.window = SCAN_WINDOW;
+  options.continuous = m_keepScanning->isChecked();
+  options.idle = SCAN_IDLE;
+  options.maxAge = SCAN_MAX_AGE;
+  return options;
+}
+
 void MainWindow::startScan() {
-  if (m_isScanning)
+  if (!m_scanner)
     return;
 
+  // A scan already running starts over with the current options
+  m_scanEvents->resetStats();
+  m_scanner->start(scanOptions());
   setScanning(true);
   m_statusLabel->setText("Scanning...");
+}
+
+void MainWindow::stopScan() {
+  if (!m_isScanning)
+    return;
+  // The controller returns what it has seen so far through onFinished and
+  // then goes idle
+  m_scanner->stop();
+  m_scanButton->setEnabled(false);
+  m_scanButton->setText("Stopping...");
+  m_extendButton->setVisible(false);
+}
+
+void MainWindow::extendScan() {
+  if (m_scanner && m_scanner->extend(SCAN_EXTEND))
+    m_statusLabel->setText("Scanning a little longer...");
+}
 
-  m_scanThread = new QThread;
-  m_scanWorker = new ScanWorker(m_manager.get());
-  m_scanWorker->moveToThread(m_scanThread);
+void MainWindow::onScanButtonClicked() {
+  if (m_isScanning)
+    stopScan();
+  else
+    startScan();
+}
+
+void MainWindow::onScanFinished(const std::vector<BluetoothDevice> &devices,
+                                bool complete) {
+  flushScanEvents();
+  if (complete) {
+    updateDeviceList(devices);
+  } else {
+    // Only what was heard before the stop; rows for the rest stay
+    for (const auto &device : devices)
+      upsertDeviceRow(device);
+    bool empty = m_deviceModel->rowCount() == 0;
+    m_emptyState->setVisible(empty);
+    m_deviceList->setVisible(!empty);
+    m_statusLabel->setText(
+        QString("Stopped, %1 devices").arg(m_deviceModel->rowCount()));
+  }
+  m_startup.mark("first scan done");
+  reportStartup();
+}
 
-  connect(m_scanThread, &QThread::started, m_scanWorker, &ScanWorker::process);
-  connect(m_scanWorker, &ScanWorker::finished, this,
-          &MainWindow::onScanFinished);
-  connect(m_scanWorker, &ScanWorker::finished, m_scanThread, &QThread::quit);
-  connect(m_scanWorker, &ScanWorker::finished, m_scanWorker,
-          &ScanWorker::deleteLater);
-  connect(m_scanThread, &QThread::finished, m_scanThread,
-          &QThread::deleteLater);
+void MainWindow::flushScanEvents() {
+  if (m_scanEvents->flush() > 0 && m_isScanning)
+    m_statusLabel->setText(
+        QString("Scanning... %1 devices").arg(m_deviceModel->rowCount()));
+}
 
-  m_scanThread->start();
+void MainWindow::onDeviceAdded(const BluetoothDevice &device) {
+  onDeviceFound(device);
 }
 
-void MainWindow::onScanFinished(const std::vector<BluetoothDevice> &devices) {
-  setScanning(false);
-  updateDeviceList(devices);
+void MainWindow::onDeviceUpdated(const BluetoothDevice &device) {
+  onDeviceFound(device);
+}
+
+void MainWindow::onDeviceRemoved(MacAddress mac) {
+  onDeviceLost(QString::fromStdString(mac.toString()));
+}
+
+void MainWindow::onDeviceFound(const BluetoothDevice &device) {
+  m_emptyState->setVisible(false);
+  m_deviceList->setVisible(true);
+  upsertDeviceRow(device);
+  if (m_startup.mark("first device"))
+    reportStartup();
+}
+
+void MainWindow::onDeviceLost(const QString &mac) {
+  m_deviceModel->remove(MacAddress::fromString(mac.toStdString()));
 }
 
 void MainWindow::onScanError(const QString &err) {
-  setScanning(false);
+  flushScanEvents();
   m_statusLabel->setText("Error: " + err);
 }
 
+void MainWindow::onScanStateChanged(ScanController::State state) {
+  switch (state) {
+  case ScanController::State::Idle:
+    flushScanEvents();
+    setScanning(false);
+    break;
+  case ScanController::State::Scanning:
+    // An Idle from the run this one replaced may have come in between
+    if (!m_isScanning)
+      setScanning(true);
+    m_progressBar->setVisible(true);
+    break;
+  case ScanController::State::Waiting:
+    // Still active: Stop ends continuous mode
+    m_progressBar->setVisible(false);
+    break;
+  }
+}
+
 void MainWindow::setScanning(bool scanning) {
   m_isScanning = scanning;
+  if (scanning) {
+    m_frameTimer->start();
+  } else {
+    m_frameTimer->stop();
+    auto stats = m_scanEvents->getStats();
+    m_statusLabel->setToolTip(
+        QString("%1 scan events: %2 merged, %3 dropped, %4 list updates")
+            .arg(stats.received)
+            .arg(stats.merged)
+            .arg(stats.dropped)
+            .arg(stats.flushes));
+  }
   m_progressBar->setVisible(scanning);
-  m_scanButton->setEnabled(!scanning);
-  m_scanButton->setText(scanning ? "Scanning..." : "Scan");
+  m_scanButton->setEnabled(true);
+  m_scanButton->setText(scanning ? "Stop" : "Scan");
+  m_extendButton->setVisible(scanning && !m_keepScanning->isChecked());
 }
 
 void MainWindow::updateDeviceList(const std::vector<BluetoothDevice> &devices) {
-  m_deviceList->clear();
+  m_deviceModel->setDevices(devices);
 
   if (devices.empty()) {
     m_emptyState->setVisible(true);
@@ -272,90 +558,100 @@ void MainWindow::updateDeviceList(const std::vector<BluetoothDevice> &devices) {
 
   m_emptyState->setVisible(false);
   m_deviceList->setVisible(true);
+  m_statusLabel->setText(QString("Found %1 devices").arg(devices.size()));
+}
 
-  for (const auto &device : devices) {
-    auto *item = new QListWidgetItem(m_deviceList);
-    auto *widget = new DeviceItemWidget(device);
-
-    item->setSizeHint(QSize(0, 72));
-
-    connect(widget, &DeviceItemWidget::connectClicked, this,
-            &MainWindow::connectDevice);
-    connect(widget, &DeviceItemWidget::disconnectClicked, this,
-            &MainWindow::disconnectDevice);
+void MainWindow::upsertDeviceRow(const BluetoothDevice &device) {
+  m_deviceModel->upsert(device);
+}
 
-    m_deviceList->addItem(item);
-    m_deviceList->setItemWidget(item, widget);
+void MainWindow::runAction(const QString &mac, const QString &status,
+                           std::function<bool(const CancelToken &)> action,
+                           std::function<void(bool)> done) {
+  if (!m_actions || !m_manager) {
+    log("Bluetooth is not available");
+    return;
   }
 
-  m_statusLabel->setText(QString("Found %1 devices").arg(devices.size()));
-}
-
-// Thread-safe helper
-template <typename Func>
-void runInThread(MainWindow *self, const QString &mac, Func func) {
-  QPointer<MainWindow> safeSelf(self);
-  std::thread([safeSelf, mac, func]() {
-    if (!safeSelf)
-      return;
-    try {
-      bool result = func();
-      // Check self again before posting event
-      // Note: invokeMethod takes the object as context, so if self dies, it
-      // *should* remain safe or just fail to queue But QPointer check inside
-      // the thread body before lambda creation is good. Be careful capturing
-      // safeSelf in lambda, it's a QPointer.
-      QMetaObject::invokeMethod(safeSelf, [safeSelf, result, mac]() {
-        if (safeSelf) {
-          if (result)
-            safeSelf->log("Action success: " + mac);
-          else
-            safeSelf->log("Action failed: " + mac);
+  QPointer<MainWindow> safeSelf(this);
+  auto id = m_actions->submit(
+      MacAddress::fromString(mac.toStdString()),
+      [safeSelf, mac, action, done](const CancelToken &cancel) {
+        if (cancel.isCancelled())
+          return;
+        bool result = false;
+        try {
+          result = action(cancel);
+        } catch (const std::exception &) {
         }
+        QMetaObject::invokeMethod(safeSelf, [safeSelf, result, mac, done]() {
+          if (!safeSelf)
+            return;
+          safeSelf->log((result ? "Action success: " : "Action failed: ") +
+                        mac);
+          if (done)
+            done(result);
+        });
       });
-    } catch (...) {
-    }
-  }).detach();
+  if (id == 0) {
+    log("Busy, try again: " + mac);
+    return;
+  }
+
+  auto stats = m_actions->getStats();
+  if (stats.queued > 1)
+    log(QString("%1 (%2 queued)").arg(status).arg(stats.queued));
+  else
+    log(status);
 }
 
 void MainWindow::log(const QString &msg) { m_statusLabel->setText(msg); }
 
 void MainWindow::connectDevice(const QString &mac) {
-  m_statusLabel->setText("Connecting " + mac + "...");
-  runInThread(this, mac, [this, mac]() {
-    return m_manager->connectDevice(mac.toStdString());
-  });
+  runAction(mac, "Connecting " + mac + "...",
+            [this, mac](const CancelToken &cancel) {
+              return m_manager->connectDevice(mac.toStdString(), cancel);
+            });
 }
 
 void MainWindow::disconnectDevice(const QString &mac) {
-  m_statusLabel->setText("Disconnecting " + mac + "...");
-  runInThread(this, mac, [this, mac]() {
-    return m_manager->disconnectDevice(mac.toStdString());
-  });
+  runAction(mac, "Disconnecting " + mac + "...",
+            [this, mac](const CancelToken &) {
+              return m_manager->disconnectDevice(mac.toStdString());
+            });
 }
 
 void MainWindow::removeDevice(const QString &mac) {
-  m_manager->removeDevice(mac.toStdString());
-  startScan();
+  // Whatever was still queued for a device being forgotten is moot
+  if (m_actions)
+    m_actions->cancelDevice(MacAddress::fromString(mac.toStdString()));
+  runAction(
+      mac, "Removing " + mac + "...",
+      [this, mac](const CancelToken &) {
+        return m_manager->removeDevice(mac.toStdString());
+      },
+      [this, mac](bool removed) {
+        // BlueZ forgot it; no need to scan again to find that out
+        if (removed)
+          onDeviceLost(mac);
+      });
 }
 
 void MainWindow::pairDevice(const QString &mac) {
-  m_statusLabel->setText("Pairing " + mac + "...");
-  runInThread(this, mac, [this, mac]() {
-    return m_manager->pairDevice(mac.toStdString());
-  });
+  runAction(mac, "Pairing " + mac + "...",
+            [this, mac](const CancelToken &cancel) {
+              return m_manager->pairDevice(mac.toStdString(), cancel);
+            });
 }
 
 void MainWindow::trustDevice(const QString &mac) {
-  m_statusLabel->setText("Trusting " + mac + "...");
-  runInThread(this, mac, [this, mac]() {
+  runAction(mac, "Trusting " + mac + "...", [this, mac](const CancelToken &) {
     return m_manager->trustDevice(mac.toStdString());
   });
 }
 
 void MainWindow::blockDevice(const QString &mac) {
-  m_statusLabel->setText("Blocking " + mac + "...");
-  runInThread(this, mac, [this, mac]() {
+  runAction(mac, "Blocking " + mac + "...", [this, mac](const CancelToken &) {
     return m_manager->blockDevice(mac.toStdString());
   });
 }
@@ -368,16 +664,11 @@ void MainWindow::showDeviceInfo(const QString &mac) {
 }
 
 void MainWindow::onContextMenuRequested(const QPoint &pos) {
-  auto *item = m_deviceList->itemAt(pos);
-  if (!item)
-    return;
-
-  auto *widget =
-      qobject_cast<DeviceItemWidget *>(m_deviceList->itemWidget(item));
-  if (!widget)
+  QModelIndex index = m_deviceList->indexAt(pos);
+  if (!index.isValid())
     return;
 
-  QString mac = widget->getMacAddress();
+  QString mac = index.data(DeviceListModel::MacRole).toString();
   QMenu contextMenu(this);
   contextMenu.setStyleSheet(
       "QMenu { background-color: #2a2a2a; color: #eee; border: 1px solid #444; "
@@ -2,48 +2,31 @@
 #define MAINWINDOW_H
 
 #include "../include/BluetoothManager.h"
+#include "../include/ScanCoalescer.h"
+#include "../include/ScanController.h"
+#include "../include/StartupTimer.h"
+#include "../include/TaskExecutor.h"
+#include "DeviceListModel.h"
+#include <QCheckBox>
 #include <QLabel>
-#include <QListWidget>
+#include <QListView>
 #include <QMainWindow>
 #include <QMenu>
 #include <QMouseEvent>
 #include <QPoint>
+#include <QPointer>
 #include <QProgressBar>
 #include <QPushButton>
-#include <QThread>
 #include <QTimer>
+#include <functional>
 #include <memory>
-#include <mutex>
 
 namespace ToothDroid {
 namespace GUI {
 
-// Worker thread for scanning to keep UI responsive
-class ScanWorker : public QObject {
-  Q_OBJECT
-public:
-  explicit ScanWorker(BluetoothManager *manager) : m_manager(manager) {}
-
-public slots:
-  void process() {
-    try {
-      // Scan for 8 seconds
-      auto devices = m_manager->scanDevices(8);
-      emit finished(devices);
-    } catch (const std::exception &e) {
-      emit error(QString::fromStdString(e.what()));
-    }
-  }
-
-signals:
-  void finished(std::vector<BluetoothDevice> devices);
-  void error(QString err);
-
-private:
-  BluetoothManager *m_manager;
-};
-
-class MainWindow : public QMainWindow {
+// Scan events reach the window through a ScanCoalescer that the frame
+// timer drains, so a burst of discoveries costs one list update per frame
+class MainWindow : public QMainWindow, public ScanObserver {
   Q_OBJECT
 
 public:
@@ -53,13 +36,25 @@ public:
   // Public for helper functions
   void log(const QString &msg);
 
+  // Coalesced scan events, on the GUI thread
+  void onDeviceAdded(const BluetoothDevice &device) override;
+  void onDeviceUpdated(const BluetoothDevice &device) override;
+  void onDeviceRemoved(MacAddress mac) override;
+
 protected:
   void mousePressEvent(QMouseEvent *event) override;
   void mouseMoveEvent(QMouseEvent *event) override;
+  void paintEvent(QPaintEvent *event) override;
 
 private slots:
   void startScan();
-  void onScanFinished(const std::vector<BluetoothDevice> &devices);
+  void stopScan();
+  void extendScan();
+  void onScanButtonClicked();
+  void onScanFinished(const std::vector<BluetoothDevice> &devices,
+                      bool complete);
+  void onDeviceFound(const BluetoothDevice &device);
+  void onDeviceLost(const QString &mac);
   void onScanError(const QString &err);
   void connectDevice(const QString &mac);
   void disconnectDevice(const QString &mac);
@@ -82,24 +77,51 @@ private slots:
 
 private:
   void setupUi();
+  // Backend setup runs on m_actions in stages; the window is usable and
+  // shows remembered devices meanwhile
+  void startBluetooth();
+  void onStartupStageDone();
+  void onBluetoothReady();
+  void reportStartup();
   void updateDeviceList(const std::vector<BluetoothDevice> &devices);
+  void upsertDeviceRow(const BluetoothDevice &device);
+  ScanController::Options scanOptions() const;
+  void onScanStateChanged(ScanController::State state);
   void setScanning(bool scanning);
+  void flushScanEvents();
+  void runAction(const QString &mac, const QString &status,
+                 std::function<bool(const CancelToken &)> action,
+                 std::function<void(bool)> done = nullptr);
 
   // Window dragging
   QPoint m_dragPosition;
 
   // UI Components
-  QListWidget *m_deviceList;
+  QListView *m_deviceList;
+  DeviceListModel *m_deviceModel;
   QPushButton *m_scanButton;
+  QPushButton *m_extendButton; // Shown during a one-shot scan
+  QCheckBox *m_keepScanning;   // Continuous discovery
   QProgressBar *m_progressBar;
   QLabel *m_statusLabel;
   QWidget *m_emptyState;
 
   // Bluetooth Logic
   std::unique_ptr<BluetoothManager> m_manager;
-  QThread *m_scanThread = nullptr;
-  ScanWorker *m_scanWorker = nullptr;
+  std::unique_ptr<TaskExecutor> m_actions; // Declared after the manager it uses
+  std::unique_ptr<ScanCoalescer> m_scanEvents; // Fed by the scan thread
+  QTimer *m_frameTimer;                        // Drains m_scanEvents
+  // Feeds m_scanEvents, so declared after it; created once Bluetooth is up
+  std::unique_ptr<ScanController> m_scanner;
   bool m_isScanning = false;
+  int m_initStages = 0; // Startup stages still running
+  QString m_initError;
+
+  // Process start to first paint, Bluetooth ready and first device;
+  // printed with --startup-timing or TOOTHDROID_STARTUP_TIMING
+  StartupTimer m_startup;
+  bool m_reportStartup = false;
+  bool m_startupReported = false;
 };
 
 } // namespace GUI
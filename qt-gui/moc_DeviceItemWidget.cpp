@@ -1,135 +0,0 @@
-/****************************************************************************
-** Meta object code from reading C++ file 'DeviceItemWidget.h'
-**
-** Created by: The Qt Meta Object Compiler version 69 (Qt 6.10.1)
-**
-** WARNING! All changes made in this file will be lost!
-*****************************************************************************/
-
-#include "DeviceItemWidget.h"
-#include <QtCore/qmetatype.h>
-
-#include <QtCore/qtmochelpers.h>
-
-#include <memory>
-
-
-#include <QtCore/qxptype_traits.h>
-#if !defined(Q_MOC_OUTPUT_REVISION)
-#error "The header file 'DeviceItemWidget.h' doesn't include <QObject>."
-#elif Q_MOC_OUTPUT_REVISION != 69
-#error "This file was generated using the moc from 6.10.1. It"
-#error "cannot be used with the include files from this version of Qt."
-#error "(The moc has changed too much.)"
-#endif
-
-#ifndef Q_CONSTINIT
-#define Q_CONSTINIT
-#endif
-
-QT_WARNING_PUSH
-QT_WARNING_DISABLE_DEPRECATED
-QT_WARNING_DISABLE_GCC("-Wuseless-cast")
-namespace {
-struct qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t {};
-} // unnamed namespace
-
-template <> constexpr inline auto ToothDroid::GUI::DeviceItemWidget::qt_create_metaobjectdata<qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>()
-{
-    namespace QMC = QtMocConstants;
-    QtMocHelpers::StringRefStorage qt_stringData {
-        "ToothDroid::GUI::DeviceItemWidget",
-        "connectClicked",
-        "",
-        "mac",
-        "disconnectClicked"
-    };
-
-    QtMocHelpers::UintData qt_methods {
-        // Signal 'connectClicked'
-        QtMocHelpers::SignalData<void(const QString &)>(1, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { QMetaType::QString, 3 },
-        }}),
-        // Signal 'disconnectClicked'
-        QtMocHelpers::SignalData<void(const QString &)>(4, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { QMetaType::QString, 3 },
-        }}),
-    };
-    QtMocHelpers::UintData qt_properties {
-    };
-    QtMocHelpers::UintData qt_enums {
-    };
-    return QtMocHelpers::metaObjectData<DeviceItemWidget, qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>(QMC::MetaObjectFlag{}, qt_stringData,
-            qt_methods, qt_properties, qt_enums);
-}
-Q_CONSTINIT const QMetaObject ToothDroid::GUI::DeviceItemWidget::staticMetaObject = { {
-    QMetaObject::SuperData::link<QWidget::staticMetaObject>(),
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>.stringdata,
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>.data,
-    qt_static_metacall,
-    nullptr,
-    qt_staticMetaObjectRelocatingContent<qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>.metaTypes,
-    nullptr
-} };
-
-void ToothDroid::GUI::DeviceItemWidget::qt_static_metacall(QObject *_o, QMetaObject::Call _c, int _id, void **_a)
-{
-    auto *_t = static_cast<DeviceItemWidget *>(_o);
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        switch (_id) {
-        case 0: _t->connectClicked((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 1: _t->disconnectClicked((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        default: ;
-        }
-    }
-    if (_c == QMetaObject::IndexOfMethod) {
-        if (QtMocHelpers::indexOfMethod<void (DeviceItemWidget::*)(const QString & )>(_a, &DeviceItemWidget::connectClicked, 0))
-            return;
-        if (QtMocHelpers::indexOfMethod<void (DeviceItemWidget::*)(const QString & )>(_a, &DeviceItemWidget::disconnectClicked, 1))
-            return;
-    }
-}
-
-const QMetaObject *ToothDroid::GUI::DeviceItemWidget::metaObject() const
-{
-    return QObject::d_ptr->metaObject ? QObject::d_ptr->dynamicMetaObject() : &staticMetaObject;
-}
-
-void *ToothDroid::GUI::DeviceItemWidget::qt_metacast(const char *_clname)
-{
-    if (!_clname) return nullptr;
-    if (!strcmp(_clname, qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI16DeviceItemWidgetE_t>.strings))
-        return static_cast<void*>(this);
-    return QWidget::qt_metacast(_clname);
-}
-
-int ToothDroid::GUI::DeviceItemWidget::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
-{
-    _id = QWidget::qt_metacall(_c, _id, _a);
-    if (_id < 0)
-        return _id;
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        if (_id < 2)
-            qt_static_metacall(this, _c, _id, _a);
-        _id -= 2;
-    }
-    if (_c == QMetaObject::RegisterMethodArgumentMetaType) {
-        if (_id < 2)
-            *reinterpret_cast<QMetaType *>(_a[0]) = QMetaType();
-        _id -= 2;
-    }
-    return _id;
-}
-
-// SIGNAL 0
-void ToothDroid::GUI::DeviceItemWidget::connectClicked(const QString & _t1)
-{
-    QMetaObject::activate<void>(this, &staticMetaObject, 0, nullptr, _t1);
-}
-
-// SIGNAL 1
-void ToothDroid::GUI::DeviceItemWidget::disconnectClicked(const QString & _t1)
-{
-    QMetaObject::activate<void>(this, &staticMetaObject, 1, nullptr, _t1);
-}
-QT_WARNING_POP
@@ -1,298 +0,0 @@
-/****************************************************************************
-** Meta object code from reading C++ file 'MainWindow.h'
-**
-** Created by: The Qt Meta Object Compiler version 69 (Qt 6.10.1)
-**
-** WARNING! All changes made in this file will be lost!
-*****************************************************************************/
-
-#include "MainWindow.h"
-#include <QtCore/qmetatype.h>
-
-#include <QtCore/qtmochelpers.h>
-
-#include <memory>
-
-
-#include <QtCore/qxptype_traits.h>
-#if !defined(Q_MOC_OUTPUT_REVISION)
-#error "The header file 'MainWindow.h' doesn't include <QObject>."
-#elif Q_MOC_OUTPUT_REVISION != 69
-#error "This file was generated using the moc from 6.10.1. It"
-#error "cannot be used with the include files from this version of Qt."
-#error "(The moc has changed too much.)"
-#endif
-
-#ifndef Q_CONSTINIT
-#define Q_CONSTINIT
-#endif
-
-QT_WARNING_PUSH
-QT_WARNING_DISABLE_DEPRECATED
-QT_WARNING_DISABLE_GCC("-Wuseless-cast")
-namespace {
-struct qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t {};
-} // unnamed namespace
-
-template <> constexpr inline auto ToothDroid::GUI::ScanWorker::qt_create_metaobjectdata<qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>()
-{
-    namespace QMC = QtMocConstants;
-    QtMocHelpers::StringRefStorage qt_stringData {
-        "ToothDroid::GUI::ScanWorker",
-        "finished",
-        "",
-        "std::vector<BluetoothDevice>",
-        "devices",
-        "error",
-        "err",
-        "process"
-    };
-
-    QtMocHelpers::UintData qt_methods {
-        // Signal 'finished'
-        QtMocHelpers::SignalData<void(std::vector<BluetoothDevice>)>(1, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { 0x80000000 | 3, 4 },
-        }}),
-        // Signal 'error'
-        QtMocHelpers::SignalData<void(QString)>(5, 2, QMC::AccessPublic, QMetaType::Void, {{
-            { QMetaType::QString, 6 },
-        }}),
-        // Slot 'process'
-        QtMocHelpers::SlotData<void()>(7, 2, QMC::AccessPublic, QMetaType::Void),
-    };
-    QtMocHelpers::UintData qt_properties {
-    };
-    QtMocHelpers::UintData qt_enums {
-    };
-    return QtMocHelpers::metaObjectData<ScanWorker, qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>(QMC::MetaObjectFlag{}, qt_stringData,
-            qt_methods, qt_properties, qt_enums);
-}
-Q_CONSTINIT const QMetaObject ToothDroid::GUI::ScanWorker::staticMetaObject = { {
-    QMetaObject::SuperData::link<QObject::staticMetaObject>(),
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>.stringdata,
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>.data,
-    qt_static_metacall,
-    nullptr,
-    qt_staticMetaObjectRelocatingContent<qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>.metaTypes,
-    nullptr
-} };
-
-void ToothDroid::GUI::ScanWorker::qt_static_metacall(QObject *_o, QMetaObject::Call _c, int _id, void **_a)
-{
-    auto *_t = static_cast<ScanWorker *>(_o);
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        switch (_id) {
-        case 0: _t->finished((*reinterpret_cast<std::add_pointer_t<std::vector<BluetoothDevice>>>(_a[1]))); break;
-        case 1: _t->error((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 2: _t->process(); break;
-        default: ;
-        }
-    }
-    if (_c == QMetaObject::IndexOfMethod) {
-        if (QtMocHelpers::indexOfMethod<void (ScanWorker::*)(std::vector<BluetoothDevice> )>(_a, &ScanWorker::finished, 0))
-            return;
-        if (QtMocHelpers::indexOfMethod<void (ScanWorker::*)(QString )>(_a, &ScanWorker::error, 1))
-            return;
-    }
-}
-
-const QMetaObject *ToothDroid::GUI::ScanWorker::metaObject() const
-{
-    return QObject::d_ptr->metaObject ? QObject::d_ptr->dynamicMetaObject() : &staticMetaObject;
-}
-
-void *ToothDroid::GUI::ScanWorker::qt_metacast(const char *_clname)
-{
-    if (!_clname) return nullptr;
-    if (!strcmp(_clname, qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10ScanWorkerE_t>.strings))
-        return static_cast<void*>(this);
-    return QObject::qt_metacast(_clname);
-}
-
-int ToothDroid::GUI::ScanWorker::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
-{
-    _id = QObject::qt_metacall(_c, _id, _a);
-    if (_id < 0)
-        return _id;
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        if (_id < 3)
-            qt_static_metacall(this, _c, _id, _a);
-        _id -= 3;
-    }
-    if (_c == QMetaObject::RegisterMethodArgumentMetaType) {
-        if (_id < 3)
-            *reinterpret_cast<QMetaType *>(_a[0]) = QMetaType();
-        _id -= 3;
-    }
-    return _id;
-}
-
-// SIGNAL 0
-void ToothDroid::GUI::ScanWorker::finished(std::vector<BluetoothDevice> _t1)
-{
-    QMetaObject::activate<void>(this, &staticMetaObject, 0, nullptr, _t1);
-}
-
-// SIGNAL 1
-void ToothDroid::GUI::ScanWorker::error(QString _t1)
-{
-    QMetaObject::activate<void>(this, &staticMetaObject, 1, nullptr, _t1);
-}
-namespace {
-struct qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t {};
-} // unnamed namespace
-
-template <> constexpr inline auto ToothDroid::GUI::MainWindow::qt_create_metaobjectdata<qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>()
-{
-    namespace QMC = QtMocConstants;
-    QtMocHelpers::StringRefStorage qt_stringData {
-        "ToothDroid::GUI::MainWindow",
-        "startScan",
-        "",
-        "onScanFinished",
-        "std::vector<BluetoothDevice>",
-        "devices",
-        "onScanError",
-        "err",
-        "connectDevice",
-        "mac",
-        "disconnectDevice",
-        "removeDevice",
-        "pairDevice",
-        "showAboutDialog",
-        "trustDevice",
-        "blockDevice",
-        "showDeviceInfo",
-        "minimizeWindow",
-        "maximizeWindow",
-        "closeWindow",
-        "onContextMenuRequested",
-        "QPoint",
-        "pos"
-    };
-
-    QtMocHelpers::UintData qt_methods {
-        // Slot 'startScan'
-        QtMocHelpers::SlotData<void()>(1, 2, QMC::AccessPrivate, QMetaType::Void),
-        // Slot 'onScanFinished'
-        QtMocHelpers::SlotData<void(const std::vector<BluetoothDevice> &)>(3, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { 0x80000000 | 4, 5 },
-        }}),
-        // Slot 'onScanError'
-        QtMocHelpers::SlotData<void(const QString &)>(6, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 7 },
-        }}),
-        // Slot 'connectDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(8, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'disconnectDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(10, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'removeDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(11, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'pairDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(12, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'showAboutDialog'
-        QtMocHelpers::SlotData<void()>(13, 2, QMC::AccessPrivate, QMetaType::Void),
-        // Slot 'trustDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(14, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'blockDevice'
-        QtMocHelpers::SlotData<void(const QString &)>(15, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'showDeviceInfo'
-        QtMocHelpers::SlotData<void(const QString &)>(16, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { QMetaType::QString, 9 },
-        }}),
-        // Slot 'minimizeWindow'
-        QtMocHelpers::SlotData<void()>(17, 2, QMC::AccessPrivate, QMetaType::Void),
-        // Slot 'maximizeWindow'
-        QtMocHelpers::SlotData<void()>(18, 2, QMC::AccessPrivate, QMetaType::Void),
-        // Slot 'closeWindow'
-        QtMocHelpers::SlotData<void()>(19, 2, QMC::AccessPrivate, QMetaType::Void),
-        // Slot 'onContextMenuRequested'
-        QtMocHelpers::SlotData<void(const QPoint &)>(20, 2, QMC::AccessPrivate, QMetaType::Void, {{
-            { 0x80000000 | 21, 22 },
-        }}),
-    };
-    QtMocHelpers::UintData qt_properties {
-    };
-    QtMocHelpers::UintData qt_enums {
-    };
-    return QtMocHelpers::metaObjectData<MainWindow, qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>(QMC::MetaObjectFlag{}, qt_stringData,
-            qt_methods, qt_properties, qt_enums);
-}
-Q_CONSTINIT const QMetaObject ToothDroid::GUI::MainWindow::staticMetaObject = { {
-    QMetaObject::SuperData::link<QMainWindow::staticMetaObject>(),
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>.stringdata,
-    qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>.data,
-    qt_static_metacall,
-    nullptr,
-    qt_staticMetaObjectRelocatingContent<qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>.metaTypes,
-    nullptr
-} };
-
-void ToothDroid::GUI::MainWindow::qt_static_metacall(QObject *_o, QMetaObject::Call _c, int _id, void **_a)
-{
-    auto *_t = static_cast<MainWindow *>(_o);
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        switch (_id) {
-        case 0: _t->startScan(); break;
-        case 1: _t->onScanFinished((*reinterpret_cast<std::add_pointer_t<std::vector<BluetoothDevice>>>(_a[1]))); break;
-        case 2: _t->onScanError((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 3: _t->connectDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 4: _t->disconnectDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 5: _t->removeDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 6: _t->pairDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 7: _t->showAboutDialog(); break;
-        case 8: _t->trustDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 9: _t->blockDevice((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 10: _t->showDeviceInfo((*reinterpret_cast<std::add_pointer_t<QString>>(_a[1]))); break;
-        case 11: _t->minimizeWindow(); break;
-        case 12: _t->maximizeWindow(); break;
-        case 13: _t->closeWindow(); break;
-        case 14: _t->onContextMenuRequested((*reinterpret_cast<std::add_pointer_t<QPoint>>(_a[1]))); break;
-        default: ;
-        }
-    }
-}
-
-const QMetaObject *ToothDroid::GUI::MainWindow::metaObject() const
-{
-    return QObject::d_ptr->metaObject ? QObject::d_ptr->dynamicMetaObject() : &staticMetaObject;
-}
-
-void *ToothDroid::GUI::MainWindow::qt_metacast(const char *_clname)
-{
-    if (!_clname) return nullptr;
-    if (!strcmp(_clname, qt_staticMetaObjectStaticContent<qt_meta_tag_ZN10ToothDroid3GUI10MainWindowE_t>.strings))
-        return static_cast<void*>(this);
-    return QMainWindow::qt_metacast(_clname);
-}
-
-int ToothDroid::GUI::MainWindow::qt_metacall(QMetaObject::Call _c, int _id, void **_a)
-{
-    _id = QMainWindow::qt_metacall(_c, _id, _a);
-    if (_id < 0)
-        return _id;
-    if (_c == QMetaObject::InvokeMetaMethod) {
-        if (_id < 15)
-            qt_static_metacall(this, _c, _id, _a);
-        _id -= 15;
-    }
-    if (_c == QMetaObject::RegisterMethodArgumentMetaType) {
-        if (_id < 15)
-            *reinterpret_cast<QMetaType *>(_a[0]) = QMetaType();
-        _id -= 15;
-    }
-    return _id;
-}
-QT_WARNING_POP
@@ -0,0 +1,291 @@
+#!/usr/bin/env python3
+"""Minimal org.bluez stand-in on the session bus for the D-Bus backend test.
+
+Usage (normally through tests/run-dbus-test.sh):
+    dbus-run-session -- python3 tests/fake_bluez.py READY_FILE
+
+Serves one adapter, /org/bluez/hci0, with one paired device known up
+front and five more that turn up once discovery starts. Needs dbus-python
+and PyGObject (python3-dbus, python3-gi). Touches READY_FILE once the
+org.bluez name is owned.
+
+Device behaviour, by last address byte:
+    00  Paired headset, present from the start
+    01  Pair asks the caller's agent for RequestConfirmation, after
+        PAIR_DELAY so two pairs can overlap
+    02  Connect never answers, like a device that stopped responding
+    03+ Connect succeeds after CONNECT_DELAY
+    04  Pair asks for RequestConfirmation like 01
+    05  Pair asks the caller's agent for RequestPinCode
+"""
+
+import sys
+
+import dbus
+import dbus.mainloop.glib
+import dbus.service
+from gi.repository import GLib
+
+SERVICE = "org.bluez"
+ADAPTER_PATH = "/org/bluez/hci0"
+ADAPTER_IFACE = "org.bluez.Adapter1"
+DEVICE_IFACE = "org.bluez.Device1"
+AGENT_MANAGER_IFACE = "org.bluez.AgentManager1"
+AGENT_IFACE = "org.bluez.Agent1"
+OBJECT_MANAGER_IFACE = "org.freedesktop.DBus.ObjectManager"
+PROPERTIES_IFACE = "org.freedesktop.DBus.Properties"
+
+DISCOVERABLE = 5        # Devices found by discovery
+DISCOVERY_INTERVAL = 20  # ms between two of them
+CONNECT_DELAY = 300      # ms a connect takes
+PAIR_DELAY = 200         # ms before a pair asks the agent
+
+AUDIO_UUIDS = [
+    "0000110b-0000-1000-8000-00805f9b34fb",
+    "00001108-0000-1000-8000-00805f9b34fb",
+]
+
+
+class BluezError(dbus.DBusException):
+    def __init__(self, name, message=""):
+        super().__init__(message or name)
+        self._dbus_error_name = "org.bluez.Error." + name
+
+
+class PropertyObject(dbus.service.Object):
+    """Object with one interface whose properties go through Properties."""
+
+    def __init__(self, bus, path, iface, props):
+        super().__init__(bus, path)
+        self.path = path
+        self.iface = iface
+        self.props = props
+
+    def set(self, name, value):
+        self.props[name] = value
+        self.PropertiesChanged(self.iface, {name: value}, [])
+
+    @dbus.service.method(PROPERTIES_IFACE, in_signature="ss",
+                         out_signature="v")
+    def Get(self, iface, name):
+        if iface != self.iface or name not in self.props:
+            raise BluezError("InvalidArguments", name)
+        return self.props[name]
+
+    @dbus.service.method(PROPERTIES_IFACE, in_signature="s",
+                         out_signature="a{sv}")
+    def GetAll(self, iface):
+        if iface != self.iface:
+            raise BluezError("InvalidArguments", iface)
+        return self.props
+
+    @dbus.service.method(PROPERTIES_IFACE, in_signature="ssv")
+    def Set(self, iface, name, value):
+        if iface != self.iface or name not in self.props:
+            raise BluezError("InvalidArguments", name)
+        self.set(name, value)
+
+    @dbus.service.signal(PROPERTIES_IFACE, signature="sa{sv}as")
+    def PropertiesChanged(self, iface, changed, invalidated):
+        pass
+
+
+class Root(dbus.service.Object):
+    def __init__(self, bus):
+        super().__init__(bus, "/")
+        self.objects = {}
+
+    def add(self, obj, announce=True):
+        self.objects[obj.path] = obj
+        if announce:
+            self.InterfacesAdded(obj.path, {obj.iface: obj.props})
+
+    def remove(self, path):
+        obj = self.objects.pop(path)
+        obj.remove_from_connection()
+        self.InterfacesRemoved(path, [obj.iface])
+
+    @dbus.service.method(OBJECT_MANAGER_IFACE, out_signature="a{oa{sa{sv}}}")
+    def GetManagedObjects(self):
+        return {path: {obj.iface: obj.props}
+                for path, obj in self.objects.items()}
+
+    @dbus.service.signal(OBJECT_MANAGER_IFACE, signature="oa{sa{sv}}")
+    def InterfacesAdded(self, path, interfaces):
+        pass
+
+    @dbus.service.signal(OBJECT_MANAGER_IFACE, signature="oas")
+    def InterfacesRemoved(self, path, interfaces):
+        pass
+
+
+class AgentManager(dbus.service.Object):
+    def __init__(self, bus):
+        super().__init__(bus, "/org/bluez")
+        self.agents = {}  # Sender -> agent object path
+
+    @dbus.service.method(AGENT_MANAGER_IFACE, in_signature="os",
+                         sender_keyword="sender")
+    def RegisterAgent(self, path, capability, sender=None):
+        if sender in self.agents:
+            raise BluezError("AlreadyExists")
+        self.agents[sender] = path
+
+    @dbus.service.method(AGENT_MANAGER_IFACE, in_signature="o",
+                         sender_keyword="sender")
+    def UnregisterAgent(self, path, sender=None):
+        if self.agents.get(sender) != path:
+            raise BluezError("DoesNotExist")
+        del self.agents[sender]
+
+    @dbus.service.method(AGENT_MANAGER_IFACE, in_signature="o")
+    def RequestDefaultAgent(self, path):
+        pass
+
+
+class Device(PropertyObject):
+    def __init__(self, bus, index, paired=False):
+        mac = "AA:BB:CC:00:00:%02X" % index
+        path = ADAPTER_PATH + "/dev_" + mac.replace(":", "_")
+        super().__init__(bus, path, DEVICE_IFACE, {
+            "Address": dbus.String(mac),
+            "Name": dbus.String("Device-%d" % index),
+            "Alias": dbus.String("Device-%d" % index),
+            "Icon": dbus.String("audio-headset"),
+            "Paired": dbus.Boolean(paired),
+            "Connected": dbus.Boolean(False),
+            "Trusted": dbus.Boolean(paired),
+            "Blocked": dbus.Boolean(False),
+            "RSSI": dbus.Int16(-40 - index),
+            "UUIDs": dbus.Array(AUDIO_UUIDS, signature="s"),
+        })
+        self.index = index
+
+    @dbus.service.method(DEVICE_IFACE, sender_keyword="sender",
+                         async_callbacks=("reply", "error"))
+    def Pair(self, sender=None, reply=None, error=None):
+        if self.props["Paired"]:
+            error(BluezError("AlreadyExists"))
+            return
+
+        def paired(*_):
+            self.set("Paired", dbus.Boolean(True))
+            reply()
+
+        if self.index not in (1, 4, 5):
+            paired()
+            return
+        agent = AGENTS.agents.get(sender)
+        if agent is None:
+            error(BluezError("AuthenticationFailed", "No agent"))
+            return
+
+        def ask():
+            handlers = dict(dbus_interface=AGENT_IFACE, reply_handler=paired,
+                            error_handler=lambda e: error(
+                                BluezError("AuthenticationRejected", str(e))))
+            remote = BUS.get_object(sender, agent)
+            if self.index == 5:
+                remote.RequestPinCode(dbus.ObjectPath(self.path), **handlers)
+            else:
+                remote.RequestConfirmation(dbus.ObjectPath(self.path),
+                                           dbus.UInt32(123456), **handlers)
+            return False
+
+        GLib.timeout_add(PAIR_DELAY, ask)
+
+    @dbus.service.method(DEVICE_IFACE)
+    def CancelPairing(self):
+        pass
+
+    @dbus.service.method(DEVICE_IFACE, async_callbacks=("reply", "error"))
+    def Connect(self, reply=None, error=None):
+        if self.index == 2:
+            return  # Never answers
+
+        def connected():
+            self.set("Connected", dbus.Boolean(True))
+            reply()
+            return False
+
+        GLib.timeout_add(CONNECT_DELAY, connected)
+
+    @dbus.service.method(DEVICE_IFACE)
+    def Disconnect(self):
+        if not self.props["Connected"]:
+            raise BluezError("NotConnected")
+        self.set("Connected", dbus.Boolean(False))
+
+
+class Adapter(PropertyObject):
+    def __init__(self, bus, root):
+        super().__init__(bus, ADAPTER_PATH, ADAPTER_IFACE, {
+            "Address": dbus.String("00:1A:7D:DA:71:13"),
+            "AddressType": dbus.String("public"),
+            "Name": dbus.String("fakehost"),
+            "Alias": dbus.String("fakehost"),
+            "Powered": dbus.Boolean(False),
+            "Discoverable": dbus.Boolean(False),
+            "Pairable": dbus.Boolean(True),
+            "Discovering": dbus.Boolean(False),
+        })
+        self.root = root
+        self.found = 0
+
+    def discover_next(self):
+        if not self.props["Discovering"]:
+            return False
+        if self.found < DISCOVERABLE:
+            self.found += 1
+            path = ADAPTER_PATH + "/dev_AA_BB_CC_00_00_%02X" % self.found
+            if path not in self.root.objects:
+                self.root.add(Device(BUS, self.found))
+            return True
+        # Everything is found; keep RSSI moving like a real scan
+        for obj in list(self.root.objects.values()):
+            if isinstance(obj, Device):
+                rssi = obj.props["RSSI"]
+                obj.set("RSSI", dbus.Int16(-40 if rssi < -80 else rssi - 1))
+        return True
+
+    @dbus.service.method(ADAPTER_IFACE)
+    def StartDiscovery(self):
+        if self.props["Discovering"]:
+            raise BluezError("InProgress")
+        self.set("Discovering", dbus.Boolean(True))
+        GLib.timeout_add(DISCOVERY_INTERVAL, self.discover_next)
+
+    @dbus.service.method(ADAPTER_IFACE)
+    def StopDiscovery(self):
+        if not self.props["Discovering"]:
+            raise BluezError("NotReady")
+        self.set("Discovering", dbus.Boolean(False))
+
+    @dbus.service.method(ADAPTER_IFACE, in_signature="a{sv}")
+    def SetDiscoveryFilter(self, filter):
+        pass
+
+    @dbus.service.method(ADAPTER_IFACE, in_signature="o")
+    def RemoveDevice(self, path):
+        if path not in self.root.objects:
+            raise BluezError("DoesNotExist")
+        self.root.remove(path)
+
+
+def main():
+    global BUS, AGENTS
+    dbus.mainloop.glib.DBusGMainLoop(set_as_default=True)
+    BUS = dbus.SessionBus()
+    root = Root(BUS)
+    AGENTS = AgentManager(BUS)
+    adapter = Adapter(BUS, root)
+    root.add(adapter, announce=False)
+    root.add(Device(BUS, 0, paired=True), announce=False)
+    name = dbus.service.BusName(SERVICE, BUS)  # noqa: F841 (keeps the name)
+    if len(sys.argv) > 1:
+        open(sys.argv[1], "w").close()
+    GLib.MainLoop().run()
+
+
+if __name__ == "__main__":
+    main()
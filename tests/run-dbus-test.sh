@@ -0,0 +1,33 @@
+#!/usr/bin/env bash
+#
+# Run tests/test_dbus_backend against tests/fake_bluez.py on a private
+# session bus, so nothing touches the real bluetoothd.
+#
+# Usage:
+#   tests/run-dbus-test.sh [test binary]
+#
+# Environment:
+#   PYTHON  Interpreter with dbus-python and PyGObject (default python3)
+
+set -euo pipefail
+
+here=$(cd "$(dirname "$0")" && pwd)
+test_binary=${1:-$here/test_dbus_backend}
+
+if [[ -z ${TOOTHDROID_IN_SESSION:-} ]]; then
+  TOOTHDROID_IN_SESSION=1 exec dbus-run-session -- "$0" "$test_binary"
+fi
+
+ready=$(mktemp -u)
+"${PYTHON:-python3}" "$here/fake_bluez.py" "$ready" &
+fake=$!
+trap 'kill $fake 2>/dev/null; rm -f "$ready"' EXIT
+
+for _ in $(seq 100); do
+  [[ -e $ready ]] && break
+  kill -0 $fake 2>/dev/null || { echo "fake org.bluez exited" >&2; exit 1; }
+  sleep 0.05
+done
+[[ -e $ready ]] || { echo "fake org.bluez did not start" >&2; exit 1; }
+
+TOOTHDROID_DBUS_BUS=session "$test_binary"
@@ -0,0 +1,192 @@
+/**
+ * @file test_dbus_backend.cpp
+ * @brief DBusBackend against the fake org.bluez in tests/fake_bluez.py
+ *
+ * Runs on a private session bus with TOOTHDROID_DBUS_BUS=session; use
+ *   make test-dbus
+ * which builds this and starts it through tests/run-dbus-test.sh.
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/DBusBackend.h"
+
+#ifndef TOOTHDROID_HAVE_SDBUS
+#error "The D-Bus test needs libsystemd; build with WITH_SDBUS=1"
+#endif
+
+using namespace ToothDroid;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+const std::string HEADSET = "AA:BB:CC:00:00:00";   // Paired from the start
+const std::string CONFIRMS = "AA:BB:CC:00:00:01";  // Pair needs the agent
+const std::string HANGS = "AA:BB:CC:00:00:02";     // Connect never answers
+const std::string CONNECTS = "AA:BB:CC:00:00:03";  // Connect takes 300 ms
+const std::string CONFIRMS_TOO = "AA:BB:CC:00:00:04";
+const std::string REMOVABLE = "AA:BB:CC:00:00:05"; // Pair asks for a PIN
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  std::printf("  %s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+  if (!ok)
+    failures++;
+}
+
+double millisSince(Clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(Clock::now() - start)
+      .count();
+}
+
+bool hasDevice(const std::vector<BluetoothDevice> &devices,
+               const std::string &mac) {
+  for (const auto &d : devices) {
+    if (d.macAddress.toString() == mac)
+      return true;
+  }
+  return false;
+}
+
+} // namespace
+
+int main() {
+  DBusBackend backend;
+  std::printf("adapter\n");
+  auto controllers = backend.listControllers();
+  check(controllers.size() == 1 &&
+            controllers[0].address.toString() == "00:1A:7D:DA:71:13",
+        "one controller listed");
+
+  std::vector<std::pair<std::string, std::string>> adapterChanges;
+  backend.watchAdapter([&](std::string_view property, std::string_view value) {
+    adapterChanges.emplace_back(std::string(property), std::string(value));
+  });
+  // Only called outside discovery
+  std::vector<DiscoveryEvent> deviceChanges;
+  check(backend.watchDevices(
+            [&](const DiscoveryEvent &e) { deviceChanges.push_back(e); }),
+        "watchDevices");
+  check(!backend.isPowered(), "starts powered off");
+  check(backend.setPowered(true).ok && backend.isPowered(), "powers on");
+  check(backend.adapterInfo().find("Powered: yes") != std::string::npos,
+        "adapterInfo shows Powered: yes");
+  bool sawPowered = false;
+  for (const auto &change : adapterChanges)
+    sawPowered |= change.first == "Powered" && change.second == "yes";
+  check(sawPowered, "watchAdapter reported Powered: yes");
+
+  std::printf("devices\n");
+  auto before = backend.snapshotDevices(false);
+  check(before.size() == 1 && before[0].macAddress.toString() == HEADSET &&
+            before[0].isPaired && before[0].supportsA2DP,
+        "snapshot has the paired headset only");
+  check(backend.deviceInfo(HEADSET).name == "Device-0", "deviceInfo");
+  check(backend.deviceInfo("AA:BB:CC:00:00:99").macAddress.isNull(),
+        "deviceInfo of an unknown device has no address");
+
+  std::printf("discovery\n");
+  check(backend.startDiscovery().ok, "startDiscovery");
+  size_t added = 0;
+  auto start = Clock::now();
+  while (added < 5 && millisSince(start) < 3000) {
+    backend.waitForEvents(std::chrono::milliseconds(200),
+                          [&](const DiscoveryEvent &e) {
+                            if (e.type == DiscoveryEvent::Type::Added)
+                              added++;
+                          });
+  }
+  check(added == 5, "five devices added (" + std::to_string(added) + ")");
+
+  // A continuous scan keeps one thread in waitForEvents; calls from other
+  // threads must still get through promptly
+  std::atomic<bool> scanning{true};
+  std::atomic<size_t> changes{0};
+  std::thread scanner([&] {
+    while (scanning) {
+      backend.waitForEvents(std::chrono::milliseconds(500),
+                            [&](const DiscoveryEvent &) { changes++; });
+    }
+  });
+
+  start = Clock::now();
+  bool connected = backend.connect(CONNECTS).ok;
+  double connectMs = millisSince(start);
+  check(connected && connectMs < 1000,
+        "connect during scan took " + std::to_string(int(connectMs)) + " ms");
+
+  start = Clock::now();
+  for (int i = 0; i < 20; i++)
+    backend.deviceInfo(HEADSET);
+  double infoMs = millisSince(start) / 20;
+  check(infoMs < 10,
+        "deviceInfo during scan took " + std::to_string(infoMs) + " ms");
+
+  // Both confirmations arrive while both pairs are in flight
+  BackendResult otherPair;
+  std::thread pairer([&] { otherPair = backend.pair(CONFIRMS_TOO); });
+  auto pairResult = backend.pair(CONFIRMS);
+  pairer.join();
+  check(pairResult.ok && otherPair.ok,
+        "two overlapping pairs confirmed through the agent (" +
+            pairResult.message + otherPair.message + ")");
+  check(backend.deviceInfo(CONFIRMS).isPaired &&
+            backend.deviceInfo(CONFIRMS_TOO).isPaired,
+        "both devices are paired afterwards");
+
+  check(!backend.pair(REMOVABLE).ok, "PIN request rejected without a PIN");
+  backend.setPinCode("1234");
+  check(backend.pair(REMOVABLE).ok, "PIN request answered once one is set");
+
+  CancelToken cancel = CancelToken::create();
+  std::thread canceller([cancel] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    cancel.cancel();
+  });
+  start = Clock::now();
+  bool hung = backend.connect(HANGS, cancel).ok;
+  double cancelMs = millisSince(start);
+  canceller.join();
+  check(!hung && cancelMs < 400, "cancelled connect returned after " +
+                                     std::to_string(int(cancelMs)) + " ms");
+
+  scanning = false;
+  scanner.join();
+  check(changes > 0, "scan thread kept receiving events");
+
+  check(deviceChanges.empty(), "watchDevices quiet while discovering");
+  check(backend.stopDiscovery().ok, "stopDiscovery");
+  auto after = backend.snapshotDevices(false);
+  check(after.size() == 6, "snapshot has all six devices");
+  check(backend.snapshotDevices(true).size() == 4, "four of them paired");
+
+  std::printf("device operations\n");
+  check(backend.setTrusted(CONNECTS, true).ok &&
+            backend.deviceInfo(CONNECTS).isTrusted,
+        "setTrusted");
+  check(backend.disconnect(CONNECTS).ok &&
+            !backend.deviceInfo(CONNECTS).isConnected,
+        "disconnect");
+  bool sawDisconnect = false;
+  for (const auto &e : deviceChanges) {
+    sawDisconnect |= e.mac.toString() == CONNECTS && e.connected &&
+                     !*e.connected && !e.paired;
+  }
+  check(sawDisconnect, "watchDevices reported the disconnect");
+  check(backend.remove(REMOVABLE).ok &&
+            !hasDevice(backend.snapshotDevices(false), REMOVABLE),
+        "remove");
+
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}
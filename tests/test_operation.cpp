@@ -0,0 +1,199 @@
+/**
+ * @file test_operation.cpp
+ * @brief Completion, cancellation and callback order of Operation/Promise
+ *
+ *   make test-operation
+ */
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "include/Operation.h"
+
+using namespace ToothDroid;
+
+namespace {
+
+int failures = 0;
+
+void check(bool ok, const std::string &what) {
+  std::printf("  %s %s\n", ok ? "ok  " : "FAIL", what.c_str());
+  if (!ok)
+    failures++;
+}
+
+// What get() does: the value, or the name of what it threw
+template <typename T> std::string outcome(const Operation<T> &op) {
+  try {
+    return "value " + std::to_string(op.get());
+  } catch (const OperationCancelled &) {
+    return "cancelled";
+  } catch (const std::exception &e) {
+    return std::string("error ") + e.what();
+  }
+}
+
+void completion() {
+  std::printf("completion\n");
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    check(!op.isReady(), "not ready before it completes");
+    check(!op.waitFor(std::chrono::milliseconds(10)),
+          "waitFor times out while running");
+    promise.setValue(42);
+    check(op.isReady() && outcome(op) == "value 42", "get() returns the value");
+  }
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    std::thread worker([&] {
+      std::this_thread::sleep_for(std::chrono::milliseconds(20));
+      promise.setValue(7);
+    });
+    check(outcome(op) == "value 7", "get() waits for another thread");
+    worker.join();
+  }
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    promise.run([](const CancelToken &) -> int {
+      throw std::runtime_error("no adapter");
+    });
+    check(outcome(op) == "error no adapter", "run() passes exceptions on");
+  }
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    promise.setValue(1);
+    promise.setValue(2);
+    promise.setError(std::make_exception_ptr(std::runtime_error("late")));
+    check(outcome(op) == "value 1", "only the first completion counts");
+  }
+}
+
+void cancellation() {
+  std::printf("cancellation\n");
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    op.cancel();
+    bool ran = false;
+    promise.run([&](const CancelToken &) {
+      ran = true;
+      return 1;
+    });
+    check(!ran && outcome(op) == "cancelled",
+          "cancelled before it runs: the work is skipped");
+  }
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    std::atomic<bool> running{false};
+    std::thread worker([&] {
+      promise.run([&](const CancelToken &cancel) {
+        running = true;
+        while (!cancel.isCancelled())
+          std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        return 3; // What it had achieved
+      });
+    });
+    while (!running)
+      std::this_thread::yield();
+    op.cancel();
+    check(op.waitFor(std::chrono::seconds(5)) && outcome(op) == "value 3",
+          "cancelled while running: completes with what it has");
+    worker.join();
+  }
+  {
+    auto promise = std::make_unique<Promise<int>>();
+    Operation<int> op = promise->operation();
+    bool called = false;
+    op.then([&](const Operation<int> &) { called = true; });
+    promise.reset(); // A queued task dropped before it ran
+    check(outcome(op) == "cancelled" && called,
+          "dropped promise cancels and runs continuations");
+  }
+}
+
+void callbackOrder() {
+  std::printf("callback order\n");
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    std::vector<int> order;
+    for (int i = 0; i < 3; i++)
+      op.then([&order, i](const Operation<int> &) { order.push_back(i); });
+    check(order.empty(), "continuations wait for completion");
+    promise.setValue(0);
+    check((order == std::vector<int>{0, 1, 2}),
+          "continuations run in the order they were added");
+    op.then([&order](const Operation<int> &) { order.push_back(3); });
+    check(order.size() == 4 && order.back() == 3,
+          "then() after completion runs right away");
+  }
+  {
+    Promise<int> promise;
+    Operation<int> op = promise.operation();
+    std::thread::id ranOn;
+    bool ready = false;
+    op.then([&](const Operation<int> &o) {
+      ranOn = std::this_thread::get_id();
+      ready = o.isReady();
+    });
+    std::thread::id worker;
+    std::thread t([&] {
+      worker = std::this_thread::get_id();
+      promise.setValue(1);
+    });
+    t.join();
+    check(ranOn == worker && ready,
+          "continuation runs on the completing thread, after completion");
+  }
+  {
+    EventLoop loop;
+    std::vector<std::unique_ptr<Promise<int>>> promises;
+    std::vector<int> delivered;
+    std::thread::id ranOn;
+    for (int i = 0; i < 4; i++) {
+      promises.push_back(std::make_unique<Promise<int>>());
+      promises.back()->operation().then(
+          loop, [&delivered, &ranOn](const Operation<int> &o) {
+            ranOn = std::this_thread::get_id();
+            delivered.push_back(o.get());
+          });
+    }
+    std::thread worker([&] {
+      for (int i : {2, 0, 3, 1})
+        promises[i]->setValue(i);
+    });
+    worker.join();
+    check(delivered.empty(), "loop continuations wait for the loop");
+    loop.runUntil([&] { return delivered.size() == 4; },
+                  std::chrono::seconds(5));
+    check((delivered == std::vector<int>{2, 0, 3, 1}),
+          "loop delivers in completion order");
+    check(ranOn == std::this_thread::get_id(),
+          "loop continuations run on the loop's thread");
+  }
+}
+
+} // namespace
+
+int main() {
+  completion();
+  cancellation();
+  callbackOrder();
+  if (failures > 0) {
+    std::printf("%d check(s) failed\n", failures);
+    return 1;
+  }
+  std::printf("all checks passed\n");
+  return 0;
+}